@@ -0,0 +1,579 @@
+// Suite de benchmarks de gsea:
+// 1. Algoritmos: MB/s y ratio de LZ77 (escaneo original, hash chain v1,
+//    v2 por niveles, LZ77+HUF) y de Vigenère sobre corpus deterministas.
+// 2. Escalado: process_file (por bloques) y process_directory (árbol de
+//    muchos archivos pequeños) de 1 a N hilos.
+// Uso: bench.exe [--csv <ruta>] [--json <ruta>] [--max-threads <n>]
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "../src/constantes.hpp"
+#include "../src/compress.hpp"
+#include "../src/crypto.hpp"
+#include "../src/dictionary.hpp"
+#include "../src/fs_utils.hpp"
+#include "../src/process.hpp"
+#include "../src/thread_pool.hpp"
+
+using namespace std;
+
+// =================================================================
+// IMPLEMENTACIÓN DE REFERENCIA (ESCANEO COMPLETO DE LA VENTANA)
+// =================================================================
+
+static FileData compress_lz77_scan(const FileData& input) {
+    if (input.empty()) return {};
+
+    FileData output;
+    size_t pos = 0;
+
+    while (pos < input.size()) {
+        size_t best_match_len = 0;
+        size_t best_match_offset = 0;
+
+        size_t start_window = (pos < WINDOW_SIZE) ? 0 : pos - WINDOW_SIZE;
+        size_t lookahead_limit = min(input.size() - pos, (size_t)LOOKAHEAD_SIZE);
+
+        for (size_t i = start_window; i < pos; ++i) {
+            size_t current_match_len = 0;
+            while (current_match_len < lookahead_limit && input[i + current_match_len] == input[pos + current_match_len]) {
+                current_match_len++;
+            }
+            if (current_match_len > best_match_len) {
+                best_match_len = current_match_len;
+                best_match_offset = pos - i;
+            }
+        }
+
+        if (best_match_len > 1) {
+            output.push_back(0x01);
+            output.push_back(static_cast<unsigned char>((best_match_offset >> 8) & 0xFF));
+            output.push_back(static_cast<unsigned char>(best_match_offset & 0xFF));
+            output.push_back(static_cast<unsigned char>(best_match_len));
+            pos += best_match_len;
+        } else {
+            output.push_back(0x00);
+            output.push_back(input[pos]);
+            pos++;
+        }
+    }
+    return output;
+}
+
+// =================================================================
+// GENERACIÓN DE CORPUS DETERMINISTAS
+// =================================================================
+
+static uint64_t next_random(uint64_t& state) {
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+static FileData make_text(size_t size) {
+    static const char* words[] = {
+        "el", "la", "de", "que", "y", "en", "un", "archivo", "sistema", "proceso",
+        "hilo", "memoria", "datos", "compresion", "clave", "directorio", "salida",
+        "entrada", "bloque", "ventana", "operativo", "kernel", "llamada", "buffer"
+    };
+    const size_t n_words = sizeof(words) / sizeof(words[0]);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    FileData data;
+    data.reserve(size);
+    while (data.size() < size) {
+        const char* w = words[next_random(state) % n_words];
+        for (const char* c = w; *c && data.size() < size; ++c) data.push_back(*c);
+        if (data.size() < size) data.push_back((next_random(state) % 12 == 0) ? '\n' : ' ');
+    }
+    return data;
+}
+
+static FileData make_binary(size_t size) {
+    // Registros de 16 bytes con campos crecientes y poco ruido
+    uint64_t state = 0xD1B54A32D192ED03ULL;
+    FileData data;
+    data.reserve(size);
+    uint32_t id = 0;
+    while (data.size() < size) {
+        unsigned char rec[16] = {0};
+        rec[0] = id & 0xFF; rec[1] = (id >> 8) & 0xFF; rec[2] = (id >> 16) & 0xFF;
+        rec[4] = 0x7F; rec[5] = 0x45;
+        rec[8] = static_cast<unsigned char>(next_random(state) % 4);
+        rec[12] = static_cast<unsigned char>(id % 7);
+        for (int i = 0; i < 16 && data.size() < size; ++i) data.push_back(rec[i]);
+        id++;
+    }
+    return data;
+}
+
+static FileData make_random(size_t size) {
+    // Alta entropía: se comporta como datos ya comprimidos (jpg, zip)
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    FileData data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = static_cast<unsigned char>(next_random(state) >> 56);
+    return data;
+}
+
+static FileData make_logs(size_t size) {
+    // Líneas de log con marca de tiempo creciente y campos variables
+    static const char* levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    static const char* paths[] = {"/api/v1/items", "/api/v1/users", "/login", "/static/app.js", "/health"};
+    uint64_t state = 0xA0761D6478BD642FULL;
+    uint64_t millis = 1700000000000ULL;
+    FileData data;
+    data.reserve(size + 256);
+    char line[256];
+    while (data.size() < size) {
+        millis += next_random(state) % 50;
+        int len = snprintf(line, sizeof(line), "%llu %s [worker-%d] path=%s status=%d latency_ms=%d id=%08llx\n",
+                           (unsigned long long)millis, levels[next_random(state) % 6], (int)(next_random(state) % 8),
+                           paths[next_random(state) % 5], next_random(state) % 10 ? 200 : 500,
+                           (int)(next_random(state) % 900), (unsigned long long)(next_random(state) & 0xFFFFFFFF));
+        data.insert(data.end(), line, line + len);
+    }
+    data.resize(size);
+    return data;
+}
+
+static FileData make_repetitive(size_t size) {
+    // Un bloque de 4 KiB repetido con mutaciones esporádicas
+    FileData pattern = make_random(4096);
+    uint64_t state = 0xE7037ED1A0B428DBULL;
+    FileData data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = pattern[i % pattern.size()];
+        if (next_random(state) % 1024 == 0) data[i] ^= 0x5A;
+    }
+    return data;
+}
+
+static vector<FileData> make_records(size_t count) {
+    // Registros JSON pequeños con los mismos campos y valores variables
+    static const char* roles[] = {"admin", "editor", "viewer", "guest"};
+    static const char* cities[] = {"Montevideo", "Buenos Aires", "Santiago", "Lima", "Bogotá"};
+    uint64_t state = 0x1D8E4E27C47D124FULL;
+    vector<FileData> records;
+    char line[512];
+    for (size_t i = 0; i < count; ++i) {
+        int len = snprintf(line, sizeof(line),
+                           "{\"id\": %zu, \"user\": \"user%llu\", \"email\": \"user%llu@example.com\", "
+                           "\"role\": \"%s\", \"city\": \"%s\", \"active\": %s, \"score\": %d, "
+                           "\"created_at\": \"2024-%02d-%02dT%02d:%02d:00Z\", \"tags\": [\"beta\", \"newsletter\"]}\n",
+                           i, (unsigned long long)(next_random(state) % 100000), (unsigned long long)(next_random(state) % 100000),
+                           roles[next_random(state) % 4], cities[next_random(state) % 5],
+                           next_random(state) % 3 ? "true" : "false", (int)(next_random(state) % 1000),
+                           (int)(1 + next_random(state) % 12), (int)(1 + next_random(state) % 28),
+                           (int)(next_random(state) % 24), (int)(next_random(state) % 60));
+        records.emplace_back(line, line + len);
+    }
+    return records;
+}
+
+// =================================================================
+// MEDICIÓN Y REPORTES
+// =================================================================
+
+// Una fila de resultados (se imprime y se exporta a CSV/JSON)
+struct Result {
+    string group;   // "algoritmo", "diccionario", "arena" o "escalado"
+    string corpus;
+    string method;
+    unsigned threads;
+    double comp_mbps;   // Etapa directa (comprimir/encriptar), en MB/s de entrada
+    double decomp_mbps; // Etapa inversa, en MB/s de datos originales (0 = no medida)
+    double ratio;       // Tamaño de salida / tamaño de entrada
+    bool ok;            // La etapa inversa restauró la entrada
+};
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-9);
+}
+
+template <typename Fn>
+static double measure_mbps(const FileData& input, FileData& output, Fn fn) {
+    auto start = chrono::steady_clock::now();
+    output = fn(input);
+    return (input.size() / (1024.0 * 1024.0)) / seconds_since(start);
+}
+
+static void print_header() {
+    cout << left << setw(12) << "corpus" << setw(24) << "metodo" << right << setw(7) << "hilos"
+         << setw(12) << "comp MB/s" << setw(12) << "desc MB/s" << setw(10) << "ratio" << setw(6) << "ok" << endl;
+}
+
+static void print_result(const Result& r) {
+    cout << fixed << setprecision(2);
+    cout << left << setw(12) << r.corpus << setw(24) << r.method << right << setw(7) << r.threads
+         << setw(12) << r.comp_mbps << setw(12) << r.decomp_mbps << setw(10) << r.ratio
+         << setw(6) << (r.ok ? "si" : "NO") << endl;
+}
+
+static bool write_csv(const string& path, const vector<Result>& results) {
+    ofstream out(path);
+    out << "grupo,corpus,metodo,hilos,comp_mbps,desc_mbps,ratio,ok\n";
+    for (const Result& r : results) {
+        out << r.group << ',' << r.corpus << ',' << r.method << ',' << r.threads << ','
+            << r.comp_mbps << ',' << r.decomp_mbps << ',' << r.ratio << ',' << (r.ok ? 1 : 0) << '\n';
+    }
+    return bool(out);
+}
+
+static bool write_json(const string& path, const vector<Result>& results) {
+    ofstream out(path);
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "  {\"grupo\": \"" << r.group << "\", \"corpus\": \"" << r.corpus << "\", \"metodo\": \""
+            << r.method << "\", \"hilos\": " << r.threads << ", \"comp_mbps\": " << r.comp_mbps
+            << ", \"desc_mbps\": " << r.decomp_mbps << ", \"ratio\": " << r.ratio
+            << ", \"ok\": " << (r.ok ? "true" : "false") << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    return bool(out);
+}
+
+// =================================================================
+// ARCHIVOS TEMPORALES PARA EL ESCALADO
+// =================================================================
+
+static uint64_t tree_bytes = 0;
+
+static int add_file_size(const char*, const struct stat* st, int type, struct FTW*) {
+    if (type == FTW_F) tree_bytes += st->st_size;
+    return 0;
+}
+
+static int remove_entry(const char* path, const struct stat*, int, struct FTW*) {
+    return remove(path);
+}
+
+// Suma los tamaños de los archivos de un árbol
+static uint64_t tree_size(const string& path) {
+    tree_bytes = 0;
+    nftw(path.c_str(), add_file_size, 16, FTW_PHYS);
+    return tree_bytes;
+}
+
+static void remove_tree(const string& path) {
+    nftw(path.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Árbol de muchos archivos pequeños (texto y logs de 1 a 16 KiB)
+static void make_small_files_tree(const string& root, size_t dirs, size_t files_per_dir) {
+    uint64_t state = 0x8EBC6AF09C88C6E3ULL;
+    FileData text = make_text(1 << 20);
+    FileData logs = make_logs(1 << 20);
+    for (size_t d = 0; d < dirs; ++d) {
+        string dir = root + "/d" + to_string(d);
+        make_directories(dir);
+        for (size_t f = 0; f < files_per_dir; ++f) {
+            const FileData& source = (f % 2) ? logs : text;
+            size_t len = 1024 + next_random(state) % (15 * 1024);
+            size_t start = next_random(state) % (source.size() - len);
+            write_file_posix(dir + "/f" + to_string(f) + ((f % 2) ? ".log" : ".txt"),
+                             ByteView(source.data() + start, len));
+        }
+    }
+}
+
+// Ejecuta fn con la salida estándar silenciada (process_* informa por cout)
+template <typename Fn>
+static double timed_quiet(Fn fn) {
+    streambuf* saved = cout.rdbuf(nullptr);
+    auto start = chrono::steady_clock::now();
+    fn();
+    double secs = seconds_since(start);
+    cout.rdbuf(saved);
+    cout.clear();
+    return secs;
+}
+
+// =================================================================
+// SUITES
+// =================================================================
+
+static void bench_algorithms(vector<Result>& results) {
+    const size_t size = 1 << 20;
+    struct Corpus { string name; FileData data; };
+    vector<Corpus> corpora = {
+        {"texto", make_text(size)},
+        {"logs", make_logs(size)},
+        {"binario", make_binary(size)},
+        {"aleatorio", make_random(size)},
+        {"repetitivo", make_repetitive(size)},
+    };
+    struct Method { string name; FileData (*compress)(const FileData&); };
+    vector<Method> methods = {
+        {"escaneo", [](const FileData& in) { return compress_lz77_scan(in); }},
+        {"hash-chain", [](const FileData& in) { return compress_lz77_v1(in); }},
+        {"v2 -1", [](const FileData& in) { return compress_lz77(in, 1); }},
+        {"v2 -3", [](const FileData& in) { return compress_lz77(in, 3); }},
+        {"v2 -5", [](const FileData& in) { return compress_lz77(in, 5); }},
+        {"v2 -7", [](const FileData& in) { return compress_lz77(in, 7); }},
+        {"v2 -9", [](const FileData& in) { return compress_lz77(in, 9); }},
+        {"v2+huf -5", [](const FileData& in) { return compress_lz77_huf(in, 5); }},
+        {"v2+huf -9", [](const FileData& in) { return compress_lz77_huf(in, 9); }},
+        // Con sonda de incompresibilidad (lo que usa el programa)
+        {"auto", [](const FileData& in) { return compress_selected(in, Config()); }},
+    };
+
+    for (const Corpus& c : corpora) {
+        for (const Method& m : methods) {
+            FileData packed, restored;
+            double comp_mbps = measure_mbps(c.data, packed, m.compress);
+            double decomp_mbps = measure_mbps(packed, restored, [](const FileData& in) { return decompress_lz77(in); });
+            // La velocidad de descompresión se expresa en bytes originales
+            decomp_mbps *= (double)c.data.size() / packed.size();
+            results.push_back({"algoritmo", c.name, m.name, 1, comp_mbps, decomp_mbps,
+                               (double)packed.size() / c.data.size(), restored == c.data});
+            print_result(results.back());
+        }
+    }
+
+    // Cifrado Vigenère (kernel elegido en tiempo de ejecución): con copia y en su lugar
+    FileData buffer = make_random(64 << 20);
+    const string key = "clave-de-prueba-123";
+    const string kernel = string("vigenere-") + vigenere_kernel_name();
+    FileData encrypted, decrypted;
+    double enc_mbps = measure_mbps(buffer, encrypted, [&](const FileData& in) { return encrypt_vigenere(in, key); });
+    double dec_mbps = measure_mbps(encrypted, decrypted, [&](const FileData& in) { return decrypt_vigenere(in, key); });
+    results.push_back({"algoritmo", "aleatorio", kernel, 1, enc_mbps, dec_mbps, 1.0, decrypted == buffer});
+    print_result(results.back());
+
+    FileData original = buffer;
+    double mb = buffer.size() / (1024.0 * 1024.0);
+    auto start = chrono::steady_clock::now();
+    encrypt_vigenere_in_place(buffer.data(), buffer.size(), key);
+    double enc_secs = seconds_since(start);
+    start = chrono::steady_clock::now();
+    decrypt_vigenere_in_place(buffer.data(), buffer.size(), key);
+    double dec_secs = seconds_since(start);
+    results.push_back({"algoritmo", "aleatorio", kernel + "-inplace", 1, mb / enc_secs, mb / dec_secs, 1.0,
+                       buffer == original});
+    print_result(results.back());
+
+    // ChaCha20 (kernel multibloque elegido en tiempo de ejecución), un hilo
+    const string chacha = string("chacha20-") + chacha20_kernel_name();
+    enc_mbps = measure_mbps(buffer, encrypted, [&](const FileData& in) { return encrypt_chacha20(in, key); });
+    dec_mbps = measure_mbps(encrypted, decrypted, [&](const FileData& in) { return decrypt_chacha20(in, key); });
+    results.push_back({"algoritmo", "aleatorio", chacha, 1, enc_mbps, dec_mbps,
+                       (double)encrypted.size() / buffer.size(), decrypted == buffer});
+    print_result(results.back());
+}
+
+// Comprime cada registro por separado (como un archivo) y mide la ida y vuelta
+static Result bench_records(const vector<FileData>& records, const string& method, const Dictionary* dict) {
+    size_t raw = 0, packed = 0;
+    vector<FileData> compressed(records.size());
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < records.size(); ++i) {
+        compressed[i] = compress_lz77(records[i], LZ77_DEFAULT_LEVEL, 0, dict);
+        raw += records[i].size();
+        packed += compressed[i].size();
+    }
+    double comp_secs = seconds_since(start);
+
+    bool ok = true;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < records.size(); ++i) ok &= decompress_lz77(compressed[i], dict) == records[i];
+    double decomp_secs = seconds_since(start);
+
+    double mb = raw / (1024.0 * 1024.0);
+    return {"diccionario", "registros", method, 1, mb / comp_secs, mb / decomp_secs, (double)packed / raw, ok};
+}
+
+static void bench_dictionary(vector<Result>& results) {
+    // Se entrena con la primera mitad y se mide sobre la segunda
+    vector<FileData> records = make_records(8000);
+    vector<FileData> training(records.begin(), records.begin() + records.size() / 2);
+    vector<FileData> measured(records.begin() + records.size() / 2, records.end());
+
+    results.push_back(bench_records(measured, "sin diccionario", nullptr));
+    print_result(results.back());
+    for (size_t kb : {16, 64}) {
+        shared_ptr<const Dictionary> dict = make_dictionary(build_dictionary(training, kb << 10));
+        results.push_back(bench_records(measured, "dict " + to_string(kb) + " KiB", dict.get()));
+        print_result(results.back());
+    }
+}
+
+/**
+ * Etapas de un archivo pequeño (comprimir + encriptar y la vuelta) repetidas
+ * sobre muchos trozos: con buffers nuevos en cada llamada, como antes del
+ * arena, o con compress_into/decrypt_selected_into y buffers reutilizados.
+ */
+static Result bench_chunks(const vector<FileData>& chunks, const Config& config, bool reuse) {
+    size_t raw = 0, packed = 0;
+    bool ok = true;
+    FileData stage1, stage2;
+    vector<FileData> sealed(chunks.size());
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (reuse) {
+            compress_into(chunks[i], config, stage1);
+        } else {
+            stage1 = compress_selected(chunks[i], config);
+        }
+        encrypt_selected_in_place(stage1, config);
+        raw += chunks[i].size();
+        packed += stage1.size();
+        // Se guarda solo lo necesario para la vuelta; el buffer de trabajo sigue siendo el mismo
+        sealed[i].assign(stage1.begin(), stage1.end());
+    }
+    double comp_secs = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (reuse) {
+            ok &= decrypt_selected_into(sealed[i], config, stage1) && decompress_lz77_into(stage1, nullptr, stage2);
+        } else {
+            stage1 = decrypt_selected(sealed[i], config);
+            stage2 = decompress_lz77(stage1);
+        }
+        ok &= stage2 == chunks[i];
+    }
+    double decomp_secs = seconds_since(start);
+
+    double mb = raw / (1024.0 * 1024.0);
+    return {"arena", "logs 4 KiB", reuse ? "buffers reutilizados" : "buffers nuevos", 1,
+            mb / comp_secs, mb / decomp_secs, (double)packed / raw, ok};
+}
+
+static void bench_arena(vector<Result>& results) {
+    const size_t CHUNK = 4 << 10;
+    FileData logs = make_logs(size_t(32) << 20);
+    vector<FileData> chunks;
+    for (size_t pos = 0; pos + CHUNK <= logs.size(); pos += CHUNK) {
+        chunks.emplace_back(logs.begin() + pos, logs.begin() + pos + CHUNK);
+    }
+
+    Config config;
+    config.level = 1;
+    config.key = "clave-benchmark";
+    for (bool reuse : {false, true}) {
+        results.push_back(bench_chunks(chunks, config, reuse));
+        print_result(results.back());
+    }
+}
+
+static void bench_scaling(vector<Result>& results, unsigned max_threads) {
+    char dir_template[] = "/tmp/gsea-bench-XXXXXX";
+    if (mkdtemp(dir_template) == nullptr) {
+        cerr << "ERROR: No se pudo crear el directorio temporal del benchmark." << endl;
+        return;
+    }
+    const string root = dir_template;
+
+    // Archivo grande (texto y logs) procesado por bloques de 1 MiB
+    FileData big = make_text(16 << 20);
+    FileData logs = make_logs(16 << 20);
+    big.insert(big.end(), logs.begin(), logs.end());
+    const string big_path = root + "/grande.txt";
+    write_file_posix(big_path, big);
+    double big_mb = big.size() / (1024.0 * 1024.0);
+
+    // Árbol de muchos archivos pequeños
+    const string tree_path = root + "/arbol";
+    make_small_files_tree(tree_path, 8, 250);
+    double tree_mb = tree_size(tree_path) / (1024.0 * 1024.0);
+
+    vector<unsigned> thread_counts;
+    for (unsigned t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    for (unsigned threads : thread_counts) {
+        Config config;
+        config.compress = true;
+        config.encrypt = true;
+        config.key = "clave-de-prueba-123";
+        config.block_size = size_t(1) << 20;
+        config.threads = threads;
+        ThreadPool pool(threads);
+        ThreadPool* file_pool = threads > 1 ? &pool : nullptr;
+
+        // process_file: contenedor por bloques, ida y vuelta
+        const string packed = root + "/grande.gs";
+        const string restored = root + "/grande.out";
+        double comp_secs = timed_quiet([&]() { process_file(big_path, packed, config, file_pool); });
+        Config back = config;
+        back.compress = back.encrypt = false;
+        back.decompress = back.decrypt = true;
+        back.block_size = 0;
+        double decomp_secs = timed_quiet([&]() { process_file(packed, restored, back, file_pool); });
+        InputFile check;
+        bool ok = check.open(restored) && check.view().size() == big.size() &&
+                  equal(big.begin(), big.end(), check.view().begin());
+        results.push_back({"escalado", "archivo", "process_file", threads, big_mb / comp_secs,
+                           big_mb / decomp_secs, (double)get_file_size(packed) / big.size(), ok});
+        print_result(results.back());
+
+        // ChaCha20 sobre un único buffer repartido entre hilos (el flujo de clave es direccionable)
+        FileData sealed, opened;
+        double seal_mbps = measure_mbps(big, sealed,
+                                        [&](const FileData& in) { return encrypt_chacha20(in, config.key, file_pool); });
+        double open_mbps = measure_mbps(sealed, opened,
+                                        [&](const FileData& in) { return decrypt_chacha20(in, config.key, file_pool); });
+        results.push_back({"escalado", "archivo", "chacha20", threads, seal_mbps, open_mbps,
+                           (double)sealed.size() / big.size(), opened == big});
+        print_result(results.back());
+
+        // process_directory: recorrido recursivo y un trabajo por archivo
+        Config dir_config = config;
+        dir_config.block_size = 0;
+        dir_config.recursive = true;
+        dir_config.input_path = tree_path;
+        dir_config.output_path = root + "/arbol-" + to_string(threads);
+        double dir_secs = timed_quiet([&]() { process_directory(dir_config, pool); });
+        double dir_ratio = tree_size(dir_config.output_path) / (tree_mb * 1024.0 * 1024.0);
+        results.push_back({"escalado", "arbol", "process_directory", threads, tree_mb / dir_secs, 0, dir_ratio, true});
+        print_result(results.back());
+        remove_tree(dir_config.output_path);
+    }
+
+    remove_tree(root);
+}
+
+int main(int argc, char* argv[]) {
+    string csv_path, json_path;
+    unsigned max_threads = ThreadPool::default_threads();
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--csv") csv_path = argv[i + 1];
+        else if (arg == "--json") json_path = argv[i + 1];
+        else if (arg == "--max-threads") max_threads = max(1, atoi(argv[i + 1]));
+    }
+
+    vector<Result> results;
+    cout << "=== Algoritmos (1 MiB por corpus) ===" << endl;
+    print_header();
+    bench_algorithms(results);
+
+    cout << "\n=== Diccionario (4000 registros JSON comprimidos uno por uno) ===" << endl;
+    print_header();
+    bench_dictionary(results);
+
+    cout << "\n=== Arena (8192 trozos de 4 KiB: comprimir + encriptar y la vuelta, nivel 1) ===" << endl;
+    print_header();
+    bench_arena(results);
+
+    cout << "\n=== Escalado (process_file 32 MiB por bloques, process_directory 2000 archivos) ===" << endl;
+    print_header();
+    bench_scaling(results, max_threads);
+
+    if (!csv_path.empty() && !write_csv(csv_path, results)) cerr << "ERROR: No se pudo escribir " << csv_path << endl;
+    if (!json_path.empty() && !write_json(json_path, results)) cerr << "ERROR: No se pudo escribir " << json_path << endl;
+    return 0;
+}
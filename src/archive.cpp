@@ -0,0 +1,437 @@
+#include "archive.hpp"
+#include "block.hpp"
+#include "bytes.hpp"
+#include "fs_utils.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+// Cabeceras POSIX para leer la cabecera sin mapear el archivo
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Constantes del formato del archivo sólido
+static const unsigned char ARCHIVE_MAGIC[4] = {'G', 'S', 'A', 'R'};
+static const unsigned char INDEX_MAGIC[4] = {'G', 'S', 'A', 'I'};
+static const unsigned char ARCHIVE_VERSION = 1;
+static const size_t ARCHIVE_HEADER_SIZE = 12;
+static const size_t ARCHIVE_FOOTER_SIZE = 20;
+
+namespace {
+
+// Índice completo: tabla de bloques y miembros en orden de empaquetado
+struct ArchiveIndex {
+    unsigned char flags = 0;
+    vector<BlockEntry> blocks;
+    vector<ArchiveMember> members;
+};
+
+// Extensión de una ruta (texto tras el último '.' del nombre), para agrupar
+string extension_of(const string& path) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return "";
+    return path.substr(dot + 1);
+}
+
+// Lista (ruta completa, ruta relativa) de los archivos a empaquetar; con -r omite exclude (el archivo de salida)
+vector<pair<string, string>> collect_files(const string& root, bool recursive, ThreadPool& pool,
+                                           const string& exclude) {
+    vector<pair<string, string>> files;
+    if (!recursive) {
+        for (const string& path : list_directory(root)) files.emplace_back(path, path.substr(root.size() + 1));
+        return files;
+    }
+
+    mutex mtx;
+    TaskGroup group(pool);
+    walk_directory_tree(root, group, [](const string&) { return true; },
+        [&](const string& path, const string& relative) {
+            lock_guard<mutex> lock(mtx);
+            files.emplace_back(path, relative);
+        },
+        exclude);
+    group.wait();
+    return files;
+}
+
+/**
+ * Escritor del archivo sólido: acumula bloques crudos, los codifica en
+ * paralelo de a una tanda (un bloque por hilo) y los escribe en orden,
+ * por lo que la memoria no depende del tamaño del directorio.
+ */
+class ArchiveWriter {
+public:
+    ArchiveWriter(int fd, const Config& config, ThreadPool& pool)
+        : fd(fd), config(config), pool(pool), wave(max(pool.size(), 1u)) {}
+
+    bool begin(uint32_t block_size) {
+        FileData header;
+        header.insert(header.end(), ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4);
+        header.push_back(ARCHIVE_VERSION);
+        header.push_back(block_flags(config));
+        header.push_back(0);
+        header.push_back(0);
+        put_u32(header, block_size);
+        return write(header);
+    }
+
+    // Agrega un bloque crudo; se escribe cuando se completa la tanda
+    bool add(FileData block) {
+        pending.push_back(move(block));
+        return pending.size() < wave || flush();
+    }
+
+    // Bloques escritos o pendientes (índice del próximo bloque)
+    size_t block_count() const { return table.size() + pending.size(); }
+
+    bool flush() {
+        vector<FileData> encoded(pending.size());
+        parallel_for(&pool, pending.size(), [&](size_t i) {
+            encoded[i] = encode_block(pending[i].data(), pending[i].size(), config);
+        });
+
+        for (size_t i = 0; i < pending.size(); ++i) {
+            BlockEntry entry{offset, static_cast<uint32_t>(pending[i].size()), static_cast<uint32_t>(encoded[i].size())};
+            FileData header;
+            write_block_header(header, entry.raw_size, entry.stored_size);
+            if (!write(header) || !write(encoded[i])) return false;
+            table.push_back(entry);
+        }
+        pending.clear();
+        return true;
+    }
+
+    // Escribe el índice (codificado como un bloque) y el pie
+    bool finish(const vector<ArchiveMember>& members) {
+        if (!flush()) return false;
+
+        FileData index;
+        put_varint(index, table.size());
+        for (const BlockEntry& entry : table) {
+            put_varint(index, entry.offset);
+            put_varint(index, entry.raw_size);
+            put_varint(index, entry.stored_size);
+        }
+        put_varint(index, members.size());
+        for (const ArchiveMember& member : members) {
+            put_varint(index, member.path.size());
+            index.insert(index.end(), member.path.begin(), member.path.end());
+            put_varint(index, member.block);
+            put_varint(index, member.offset);
+            put_varint(index, member.size);
+        }
+
+        uint64_t index_offset = offset;
+        FileData stored = encode_block(index.data(), index.size(), config);
+        FileData footer;
+        put_u64(footer, index_offset);
+        put_u32(footer, static_cast<uint32_t>(index.size()));
+        put_u32(footer, static_cast<uint32_t>(stored.size()));
+        footer.insert(footer.end(), INDEX_MAGIC, INDEX_MAGIC + 4);
+        return write(stored) && write(footer);
+    }
+
+private:
+    bool write(const FileData& data) {
+        if (!write_fully(fd, data.data(), data.size())) {
+            cerr << "ERROR ARCHIVO: Error de escritura." << endl;
+            return false;
+        }
+        offset += data.size();
+        return true;
+    }
+
+    int fd;
+    const Config& config;
+    ThreadPool& pool;
+    size_t wave;
+    uint64_t offset = 0;
+    vector<FileData> pending;
+    vector<BlockEntry> table;
+};
+
+// Lee y valida la cabecera, el pie y el índice del archivo sólido
+bool read_index(ByteView archive, const Config& config, ArchiveIndex& index) {
+    if (archive.size() < ARCHIVE_HEADER_SIZE + ARCHIVE_FOOTER_SIZE ||
+        memcmp(archive.data(), ARCHIVE_MAGIC, 4) != 0 || archive[4] != ARCHIVE_VERSION) {
+        cerr << "ERROR ARCHIVO: Cabecera de archivo sólido inválida." << endl;
+        return false;
+    }
+    index.flags = archive[5];
+    if (!check_block_flags(index.flags, config)) return false;
+
+    const unsigned char* footer = archive.data() + archive.size() - ARCHIVE_FOOTER_SIZE;
+    uint64_t index_offset = get_u64(footer);
+    uint32_t raw_size = get_u32(footer + 8);
+    uint32_t stored_size = get_u32(footer + 12);
+    // El índice es una "tabla" de stored_size bytes entre los bloques y el pie
+    if (memcmp(footer + 16, INDEX_MAGIC, 4) != 0 ||
+        !table_fits(archive.size(), ARCHIVE_HEADER_SIZE, ARCHIVE_FOOTER_SIZE, index_offset, stored_size, 1)) {
+        cerr << "ERROR ARCHIVO: Pie del archivo sólido inválido." << endl;
+        return false;
+    }
+
+    FileData raw;
+    if (!decode_block(archive.data() + index_offset, stored_size, raw_size, index.flags, config, raw)) {
+        cerr << "ERROR ARCHIVO: No se pudo leer el índice (¿clave incorrecta?)." << endl;
+        return false;
+    }
+
+    try {
+        ByteView in(raw);
+        size_t pos = 0;
+        uint64_t block_count = get_varint(in, pos);
+        if (block_count > raw.size()) throw runtime_error("Número de bloques inválido.");
+        // Inicio de cada bloque en el flujo concatenado de miembros
+        vector<uint64_t> block_start(block_count + 1, 0);
+        index.blocks.resize(block_count);
+        for (size_t i = 0; i < block_count; ++i) {
+            BlockEntry& entry = index.blocks[i];
+            entry.offset = get_varint(in, pos);
+            entry.raw_size = static_cast<uint32_t>(get_varint(in, pos));
+            entry.stored_size = static_cast<uint32_t>(get_varint(in, pos));
+            if (!block_fits(entry.offset, entry.stored_size, ARCHIVE_HEADER_SIZE, index_offset)) {
+                throw runtime_error("Bloque fuera de límites.");
+            }
+            block_start[i + 1] = block_start[i] + entry.raw_size;
+        }
+
+        uint64_t member_count = get_varint(in, pos);
+        if (member_count > raw.size()) throw runtime_error("Número de miembros inválido.");
+        index.members.resize(member_count);
+        uint64_t expected = 0;
+        for (ArchiveMember& member : index.members) {
+            uint64_t length = get_varint(in, pos);
+            if (length > raw.size() - pos) throw runtime_error("Ruta de miembro incompleta.");
+            member.path.assign(reinterpret_cast<const char*>(raw.data() + pos), length);
+            pos += length;
+            member.block = get_varint(in, pos);
+            member.offset = get_varint(in, pos);
+            member.size = get_varint(in, pos);
+            if (!is_safe_relative_path(member.path)) throw runtime_error("Ruta de miembro insegura: " + member.path);
+            // Los miembros ocupan el flujo de forma contigua y en orden. Un miembro empieza
+            // dentro de su bloque; solo uno vacío puede quedar justo al final de un bloque
+            // (o después del último, con block == block_count y offset 0)
+            if (member.block > block_count) throw runtime_error("Miembro fuera de orden: " + member.path);
+            uint64_t block_raw = member.block < block_count ? index.blocks[member.block].raw_size : 0;
+            if (member.offset > block_raw || (member.offset == block_raw && member.size > 0) ||
+                block_start[member.block] + member.offset != expected) {
+                throw runtime_error("Miembro fuera de orden: " + member.path);
+            }
+            if (member.size > block_start[block_count] - expected) {
+                throw runtime_error("Miembro fuera de los bloques: " + member.path);
+            }
+            expected += member.size;
+        }
+        if (expected != block_start[block_count]) throw runtime_error("Los miembros no cubren los bloques.");
+    } catch (const runtime_error& e) {
+        cerr << "ERROR ARCHIVO: Índice inválido: " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+// Decodifica el bloque i verificando que su cabecera coincida con la tabla
+bool decode_archive_block(ByteView archive, const ArchiveIndex& index, size_t i, const Config& config, FileData& out) {
+    const BlockEntry& entry = index.blocks[i];
+    const unsigned char* p = archive.data() + entry.offset;
+    if (get_u32(p) != entry.raw_size || get_u32(p + 4) != entry.stored_size) return false;
+    return decode_block(p + BLOCK_HEADER_SIZE, entry.stored_size, entry.raw_size, index.flags, config, out);
+}
+
+// Crea (o trunca) el archivo de un miembro, con sus directorios
+int open_member(const string& output_dir, const string& path) {
+    string full_path = output_dir + "/" + path;
+    size_t slash = full_path.find_last_of('/');
+    if (!make_directories(full_path.substr(0, slash))) return -1;
+    return open_output_fd(full_path);
+}
+
+} // namespace
+
+bool is_archive_file(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    unsigned char header[5];
+    bool result = read_fully(fd, header, sizeof(header)) == sizeof(header) &&
+                  memcmp(header, ARCHIVE_MAGIC, 4) == 0 && header[4] == ARCHIVE_VERSION;
+    close(fd);
+    return result;
+}
+
+bool create_archive(const string& input_dir, const string& output_path, const Config& config, ThreadPool& pool) {
+    vector<pair<string, string>> files = collect_files(input_dir, config.recursive, pool, output_path);
+    if (files.empty()) {
+        cerr << "ERROR ARCHIVO: No se encontraron archivos regulares en: " << input_dir << endl;
+        return false;
+    }
+
+    // Los archivos del mismo tipo quedan contiguos y comparten contexto
+    sort(files.begin(), files.end(), [](const pair<string, string>& a, const pair<string, string>& b) {
+        string ext_a = extension_of(a.second), ext_b = extension_of(b.second);
+        return ext_a != ext_b ? ext_a < ext_b : a.second < b.second;
+    });
+
+    size_t block_size = config.block_size ? config.block_size : static_cast<size_t>(ARCHIVE_BLOCK_MB) << 20;
+    int fd = open_output_fd(output_path);
+    if (fd < 0) return false;
+
+    ArchiveWriter writer(fd, config, pool);
+    bool ok = writer.begin(static_cast<uint32_t>(block_size));
+
+    vector<ArchiveMember> members;
+    FileData current;
+    current.reserve(block_size);
+    for (size_t f = 0; f < files.size() && ok; ++f) {
+        const string& path = files[f].first;
+        InputFile input;
+        ByteView data;
+        if (get_file_size(path) > 0) {
+            if (!input.open(path)) {
+                cerr << "ERROR ARCHIVO: Se omite el archivo ilegible: " << path << endl;
+                continue;
+            }
+            data = input.view();
+        }
+
+        members.push_back({files[f].second, writer.block_count(), current.size(), data.size()});
+
+        // El contenido se reparte en los bloques sólidos que haga falta
+        size_t pos = 0;
+        while (pos < data.size() && ok) {
+            size_t take = min(data.size() - pos, block_size - current.size());
+            current.insert(current.end(), data.begin() + pos, data.begin() + pos + take);
+            pos += take;
+            if (current.size() == block_size) {
+                ok = writer.add(move(current));
+                current = FileData();
+                current.reserve(block_size);
+            }
+        }
+    }
+    if (ok && !current.empty()) ok = writer.add(move(current));
+    ok = ok && writer.finish(members);
+
+    close_fd(fd);
+    if (ok) log_progress(config, "  [ARCHIVO] Miembros: ", members.size(), ", bloques: ", writer.block_count());
+    return ok;
+}
+
+bool extract_archive(const string& archive_path, const string& output_dir, const Config& config, ThreadPool& pool) {
+    InputFile input;
+    if (!input.open(archive_path)) return false;
+    ByteView archive = input.view();
+
+    ArchiveIndex index;
+    if (!read_index(archive, config, index) || !make_directories(output_dir)) return false;
+
+    // Miembro en escritura: descriptor y bytes que le faltan
+    size_t next = 0;
+    int fd = -1;
+    uint64_t remaining = 0;
+    bool ok = true;
+
+    // Abre el siguiente miembro con contenido, creando los vacíos que haya antes
+    auto open_next = [&]() {
+        while (next < index.members.size() && index.members[next].size == 0) {
+            int empty_fd = open_member(output_dir, index.members[next++].path);
+            if (empty_fd < 0) return false;
+            close_fd(empty_fd);
+        }
+        if (next == index.members.size()) return false;
+        remaining = index.members[next].size;
+        fd = open_member(output_dir, index.members[next++].path);
+        return fd >= 0;
+    };
+
+    // Los bloques se decodifican en tandas paralelas y se reparten en orden
+    size_t wave = max(pool.size(), 1u);
+    for (size_t first = 0; first < index.blocks.size() && ok; first += wave) {
+        size_t count = min(wave, index.blocks.size() - first);
+        vector<FileData> raw(count);
+        vector<char> good(count, 0);
+        parallel_for(&pool, count, [&](size_t i) {
+            good[i] = decode_archive_block(archive, index, first + i, config, raw[i]);
+        });
+
+        for (size_t i = 0; i < count && ok; ++i) {
+            if (!good[i]) {
+                cerr << "ERROR ARCHIVO: Falló la restauración del bloque " << first + i << "." << endl;
+                ok = false;
+                break;
+            }
+            size_t pos = 0;
+            while (pos < raw[i].size() && ok) {
+                if (fd < 0 && !open_next()) {
+                    ok = false;
+                    break;
+                }
+                size_t take = static_cast<size_t>(min<uint64_t>(remaining, raw[i].size() - pos));
+                ok = write_fully(fd, raw[i].data() + pos, take);
+                pos += take;
+                remaining -= take;
+                if (remaining == 0) {
+                    close_fd(fd);
+                    fd = -1;
+                }
+            }
+        }
+    }
+    if (fd >= 0) close_fd(fd);
+
+    // Miembros vacíos al final del archivo
+    if (ok) open_next();
+    if (ok) log_progress(config, "  [ARCHIVO] Miembros extraídos: ", index.members.size());
+    return ok && next == index.members.size();
+}
+
+bool extract_member(const string& archive_path, const string& member, const string& output_path, const Config& config) {
+    InputFile input;
+    if (!input.open(archive_path)) return false;
+    ByteView archive = input.view();
+
+    ArchiveIndex index;
+    if (!read_index(archive, config, index)) return false;
+
+    auto found = find_if(index.members.begin(), index.members.end(),
+                         [&member](const ArchiveMember& m) { return m.path == member; });
+    if (found == index.members.end()) {
+        cerr << "ERROR ARCHIVO: El miembro no existe en el archivo: " << member << endl;
+        return false;
+    }
+
+    int fd = open_output_fd(output_path);
+    if (fd < 0) return false;
+
+    // Solo se decodifican los bloques que contienen al miembro
+    bool ok = true;
+    uint64_t remaining = found->size;
+    uint64_t offset = found->offset;
+    for (size_t b = found->block; remaining > 0 && ok; ++b) {
+        FileData raw;
+        if (!decode_archive_block(archive, index, b, config, raw)) {
+            cerr << "ERROR ARCHIVO: Falló la restauración del bloque " << b << "." << endl;
+            ok = false;
+            break;
+        }
+        if (offset > raw.size()) {
+            cerr << "ERROR ARCHIVO: El miembro comienza fuera del bloque " << b << "." << endl;
+            ok = false;
+            break;
+        }
+        size_t take = static_cast<size_t>(min<uint64_t>(remaining, raw.size() - offset));
+        ok = write_fully(fd, raw.data() + offset, take);
+        remaining -= take;
+        offset = 0;
+    }
+
+    close_fd(fd);
+    return ok;
+}
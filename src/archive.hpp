@@ -0,0 +1,72 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Archivo sólido: empaqueta un directorio completo en un único contenedor.
+ * Los archivos se concatenan (agrupados por extensión para que los similares
+ * compartan contexto) y el flujo resultante se divide en bloques sólidos de
+ * tamaño fijo que se comprimen/encriptan de forma independiente con
+ * encode_block. Al final, un índice permite extraer un miembro decodificando
+ * solo los bloques que lo contienen.
+ *
+ * Formato (enteros little-endian):
+ * - Cabecera (12 bytes): ["GSAR"] [Versión (1)] [Flags (1)] [Reservado (2)] [Tamaño de bloque (4)]
+ * - Por bloque: [Tamaño original (4)] [Tamaño almacenado (4)] [Datos]
+ * - Índice: codificado como un bloque más (comprimido/encriptado según los flags).
+ *   Contenido (varint): [Número de bloques] y por bloque [Offset] [Original] [Almacenado];
+ *   [Número de miembros] y por miembro [Largo de ruta] [Ruta] [Bloque] [Offset en el bloque] [Tamaño]
+ * - Pie (20 bytes): [Offset del índice (8)] [Índice original (4)] [Índice almacenado (4)] ["GSAI"]
+ */
+
+// Miembro del archivo sólido
+struct ArchiveMember {
+    std::string path; // Ruta relativa al directorio empaquetado
+    uint64_t block;   // Bloque donde comienza su contenido
+    uint64_t offset;  // Offset dentro de ese bloque
+    uint64_t size;    // Tamaño original
+};
+
+/**
+ * Indica si el archivo en path es un archivo sólido (por su cabecera).
+ */
+bool is_archive_file(const std::string& path);
+
+/**
+ * Empaqueta los archivos de input_dir (y sus subdirectorios si config.recursive)
+ * en un archivo sólido, comprimiendo y/o encriptando sus bloques en paralelo.
+ * @param input_dir Directorio a empaquetar.
+ * @param output_path Ruta del archivo sólido.
+ * @param config Parámetros de la operación (block_size, compress, encrypt, key, ...).
+ * @param pool Pool donde se codifican los bloques.
+ * @return true si el archivo se escribió completo.
+ */
+bool create_archive(const std::string& input_dir, const std::string& output_path,
+                    const Config& config, ThreadPool& pool);
+
+/**
+ * Extrae todos los miembros de un archivo sólido bajo output_dir,
+ * recreando sus subdirectorios.
+ * @param archive_path Ruta del archivo sólido.
+ * @param output_dir Directorio de destino.
+ * @param config Parámetros de la operación (decompress, decrypt, key).
+ * @param pool Pool donde se decodifican los bloques.
+ * @return true si todos los miembros se extrajeron.
+ */
+bool extract_archive(const std::string& archive_path, const std::string& output_dir,
+                     const Config& config, ThreadPool& pool);
+
+/**
+ * Extrae un único miembro decodificando solo los bloques que lo contienen.
+ * @param archive_path Ruta del archivo sólido.
+ * @param member Ruta del miembro dentro del archivo.
+ * @param output_path Archivo de destino.
+ * @param config Parámetros de la operación (decompress, decrypt, key).
+ * @return true si el miembro existe y se extrajo.
+ */
+bool extract_member(const std::string& archive_path, const std::string& member,
+                    const std::string& output_path, const Config& config);
@@ -0,0 +1,54 @@
+#include "arena.hpp"
+#include <atomic>
+
+using namespace std;
+
+// Suma de los máximos de los arenas; cada uno suma solo lo que crece su propio máximo
+static atomic<uint64_t> total_peak{0};
+
+WorkerArena::~WorkerArena() {
+    // Al terminar el hilo (cuando se destruye su pool) el arena también cuenta su uso final
+    update_peak();
+}
+
+size_t WorkerArena::bytes() const {
+    return input.capacity() + scratch.capacity() + output.capacity() + window.capacity() +
+           (match_head.capacity() + match_prev.capacity()) * sizeof(uint32_t) +
+           sequences.capacity() * sizeof(Lz77Sequence) + literals.capacity();
+}
+
+size_t WorkerArena::update_peak() {
+    size_t current = bytes();
+    if (current > peak) {
+        total_peak.fetch_add(current - peak, memory_order_relaxed);
+        peak = current;
+    }
+    return current;
+}
+
+size_t WorkerArena::finish_file() {
+    size_t current = update_peak();
+    if (current > (size_t(ARENA_KEEP_MB) << 20)) {
+        // swap con un vector vacío devuelve la memoria (clear() la conservaría)
+        FileData().swap(input);
+        FileData().swap(scratch);
+        FileData().swap(output);
+        FileData().swap(window);
+        window_dict_id = 0;
+        window_dict_size = 0;
+        vector<uint32_t>().swap(match_head);
+        vector<uint32_t>().swap(match_prev);
+        vector<Lz77Sequence>().swap(sequences);
+        FileData().swap(literals);
+    }
+    return current;
+}
+
+WorkerArena& worker_arena() {
+    thread_local WorkerArena arena;
+    return arena;
+}
+
+uint64_t arena_peak_bytes() {
+    return total_peak.load(memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "entropy.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Buffers de trabajo por hilo. Cada hilo que procesa archivos tiene un
+ * arena propio cuyos buffers crecen hasta el máximo que necesitó algún
+ * archivo y se reutilizan en los siguientes: leer, comprimir, encriptar,
+ * etc. no piden memoria nueva en régimen estable (solo se limpian con
+ * clear(), que conserva la capacidad). Si un archivo grande lleva el arena
+ * por encima de ARENA_KEEP_MB, sus buffers se liberan al terminarlo.
+ *
+ * Las etapas alternan entre scratch y el buffer de salida del llamador
+ * (ping-pong): cada una lee la vista que dejó la anterior y escribe en el
+ * otro buffer. Un mismo buffer no se usa en dos lugares a la vez: input y
+ * scratch/output son de process.cpp, el resto de compress.cpp (una sola
+ * compresión o descompresión en curso por hilo).
+ */
+struct WorkerArena {
+    FileData input;   // Contenido de archivos pequeños (se leen en lugar de mapearse)
+    FileData scratch; // Salida intermedia de las etapas (ping-pong con el buffer del llamador)
+    FileData output;  // Resultado de process_file hasta que se escribe
+
+    FileData window;                     // Diccionario seguido de los datos a comprimir o decodificados
+    uint32_t window_dict_id = 0;         // Diccionario que ocupa el inicio de window
+    size_t window_dict_size = 0;
+    std::vector<uint32_t> match_head;    // Tablas del buscador de coincidencias LZ77
+    std::vector<uint32_t> match_prev;
+    std::vector<Lz77Sequence> sequences; // Secuencias de LZ77+HUF (compresión y descompresión)
+    FileData literals;
+
+    WorkerArena() = default;
+    ~WorkerArena();
+    WorkerArena(const WorkerArena&) = delete;
+    WorkerArena& operator=(const WorkerArena&) = delete;
+
+    /**
+     * @return Bytes reservados por los buffers (su capacidad, no su tamaño).
+     */
+    size_t bytes() const;
+
+    /**
+     * Actualiza el máximo del arena.
+     * @return Bytes reservados actualmente.
+     */
+    size_t update_peak();
+
+    /**
+     * Cierra el uso del arena para un archivo: actualiza el máximo y libera
+     * los buffers si superan ARENA_KEEP_MB.
+     * @return Bytes que tenía reservados el arena al terminar el archivo.
+     */
+    size_t finish_file();
+
+private:
+    size_t peak = 0;
+};
+
+/**
+ * @return Arena del hilo actual (se crea en el primer uso y se libera al terminar el hilo).
+ */
+WorkerArena& worker_arena();
+
+/**
+ * @return Suma de los máximos de todos los arenas creados (memoria de trabajo en el peor momento).
+ */
+uint64_t arena_peak_bytes();
@@ -0,0 +1,602 @@
+#include "batch.hpp"
+#include "cli.hpp"
+#include "dictionary.hpp"
+#include "fs_utils.hpp"
+#include "manifest.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// =================================================================
+// TRABAJOS
+// =================================================================
+
+// Resultado de un trabajo
+struct JobResult {
+    size_t id = 0; // Número de línea del trabajo
+    bool ok = false;
+    string error;
+    uint64_t queue_ns = 0;
+    uint64_t run_ns = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+};
+
+string result_line(const JobResult& result) {
+    ostringstream line;
+    line << "{\"trabajo\": " << result.id << ", \"ok\": " << (result.ok ? "true" : "false");
+    if (!result.error.empty()) line << ", \"error\": \"" << json_escape(result.error) << '"';
+    line << ", \"espera_ms\": " << result.queue_ns / 1e6 << ", \"tiempo_ms\": " << result.run_ns / 1e6
+         << ", \"bytes_entrada\": " << result.bytes_in << ", \"bytes_salida\": " << result.bytes_out << "}\n";
+    return line.str();
+}
+
+string summary_line(size_t jobs, size_t failed, uint64_t wall_ns) {
+    ostringstream line;
+    line << "{\"trabajos\": " << jobs << ", \"fallidos\": " << failed << ", \"tiempo_total_ms\": " << wall_ns / 1e6
+         << "}\n";
+    return line.str();
+}
+
+// Quita el fin de línea (y los espacios finales); false si la línea está vacía o es un comentario
+bool is_job_line(string& line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.pop_back();
+    size_t first = line.find_first_not_of(" \t");
+    return first != string::npos && line[first] != '#';
+}
+
+/**
+ * Ejecuta trabajos en un pool compartido. Los hilos del pool conservan su
+ * arena y sus cachés de claves entre trabajos; los diccionarios se cargan
+ * una vez y se vuelven a leer solo si su archivo cambia. Un trabajo que se
+ * reparte (un directorio, bloques o ChaCha20) usa el mismo pool en lugar de
+ * crear hilos propios.
+ */
+class JobRunner {
+public:
+    using Callback = function<void(const JobResult&)>;
+
+    explicit JobRunner(unsigned threads) : pool(threads) {}
+
+    /**
+     * Encola un trabajo.
+     * @param id Número de línea (se devuelve en el resultado).
+     * @param line Línea del trabajo.
+     * @param done Recibe el resultado en el hilo que ejecutó el trabajo.
+     */
+    void submit(size_t id, const string& line, Callback done) {
+        uint64_t queued_at = monotonic_ns();
+        pool.submit([this, id, line, done, queued_at]() {
+            JobResult result;
+            result.id = id;
+            uint64_t started = monotonic_ns();
+            result.queue_ns = started - queued_at;
+            run(line, result);
+            result.run_ns = monotonic_ns() - started;
+            done(result);
+        });
+    }
+
+    void wait() { pool.wait(); }
+
+    unsigned size() const { return pool.size(); }
+
+private:
+    void run(const string& line, JobResult& result) {
+        vector<string> args;
+        if (!split_job_line(line, args)) {
+            result.error = "Comilla sin cerrar.";
+            return;
+        }
+        Config config;
+        ArgsStatus status = parse_arguments(args, config, result.error);
+        if (status == ArgsStatus::Help) result.error = "La ayuda (-h) no es un trabajo.";
+        if (status != ArgsStatus::Ok) return;
+        if (!config.batch_path.empty() || !config.daemon_socket.empty() || !config.client_socket.empty() ||
+            config.shutdown_daemon || config.input_path == "-" || config.output_path == "-" ||
+            !config.stats_path.empty()) {
+            result.error = "Un trabajo no puede usar -i -, -o -, --stats ni las opciones de lote/servicio.";
+            return;
+        }
+
+        // Los mensajes de progreso se mezclarían con las respuestas
+        config.quiet = true;
+        // Un archivo usa un hilo (el paralelismo está entre trabajos) salvo que pida -j; un directorio, el pool completo
+        bool directory = is_directory(config.input_path);
+        if (config.threads == 0) config.threads = directory ? pool.size() : 1;
+        if (!config.dict_path.empty()) {
+            config.dictionary = dictionary(config.dict_path);
+            if (!config.dictionary) {
+                result.error = "No se pudo cargar el diccionario: " + config.dict_path;
+                return;
+            }
+        }
+
+        result.ok = run_operation(config, pool);
+        if (!result.ok) result.error = "Falló la operación (el detalle está en la salida de errores).";
+        if (!directory) result.bytes_in = get_file_size(config.input_path);
+        if (result.ok && !is_directory(config.output_path)) result.bytes_out = get_file_size(config.output_path);
+    }
+
+    shared_ptr<const Dictionary> dictionary(const string& path) {
+        uint64_t size;
+        int64_t mtime_ns;
+        if (!stat_file(path, size, mtime_ns)) return nullptr;
+        lock_guard<mutex> lock(dicts_mtx);
+        auto it = dicts.find(path);
+        if (it != dicts.end() && it->second.size == size && it->second.mtime_ns == mtime_ns) return it->second.dict;
+        shared_ptr<const Dictionary> dict = load_dictionary(path);
+        if (dict) dicts[path] = {size, mtime_ns, dict};
+        return dict;
+    }
+
+    struct CachedDictionary {
+        uint64_t size;
+        int64_t mtime_ns;
+        shared_ptr<const Dictionary> dict;
+    };
+    mutex dicts_mtx;
+    map<string, CachedDictionary> dicts;
+    // El pool se declara al final: se destruye primero, esperando los trabajos que usan lo anterior
+    ThreadPool pool;
+};
+
+// =================================================================
+// SOCKETS
+// =================================================================
+
+bool make_address(const string& path, sockaddr_un& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+int connect_socket(const string& path) {
+    sockaddr_un addr;
+    if (!make_address(path, addr)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// Sin SIGPIPE: si el otro extremo cerró, send falla con EPIPE
+bool send_all(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Lee líneas de un socket
+class LineReader {
+public:
+    enum Status { Line, End, Error, TooLong };
+
+    explicit LineReader(int fd) : fd(fd) {}
+
+    Status next(string& line) {
+        for (;;) {
+            size_t newline = buffer.find('\n', start);
+            if (newline != string::npos) {
+                line.assign(buffer, start, newline - start);
+                start = newline + 1;
+                return Line;
+            }
+            if (buffer.size() - start > JOB_LINE_MAX) return TooLong;
+            buffer.erase(0, start);
+            start = 0;
+
+            char chunk[4096];
+            ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) return Error;
+            if (got == 0) {
+                // Última línea sin '\n'
+                if (buffer.empty()) return End;
+                line.swap(buffer);
+                buffer.clear();
+                return Line;
+            }
+            buffer.append(chunk, static_cast<size_t>(got));
+        }
+    }
+
+private:
+    int fd;
+    string buffer;
+    size_t start = 0;
+};
+
+// =================================================================
+// SERVICIO
+// =================================================================
+
+// Estado compartido con el manejador de señales
+volatile sig_atomic_t stop_requested = 0;
+int listen_fd = -1;
+
+// shutdown despierta al accept bloqueado (en cualquier hilo) y es seguro en un manejador de señales
+void request_stop() {
+    stop_requested = 1;
+    if (listen_fd >= 0) shutdown(listen_fd, SHUT_RDWR);
+}
+
+void handle_stop_signal(int) {
+    request_stop();
+}
+
+// Conexión de un cliente; la comparten su hilo y los trabajos que envió
+struct Connection {
+    int fd;
+    mutex mtx; // Escritura en el socket y contadores
+    condition_variable done_cv;
+    size_t pending = 0;
+    size_t jobs = 0;
+    size_t failed = 0;
+    uint64_t started = monotonic_ns();
+
+    explicit Connection(int fd) : fd(fd) {}
+};
+
+class Daemon {
+public:
+    explicit Daemon(const Config& config) : config(config), runner(config.threads) {}
+
+    bool run() {
+        const string& path = config.daemon_socket;
+        sockaddr_un addr;
+        if (!make_address(path, addr)) {
+            cerr << "ERROR SERVICIO: Ruta de socket vacía o demasiado larga: " << path << endl;
+            return false;
+        }
+        // Un socket que responde es de un servicio en marcha; uno que no, quedó de un servicio terminado
+        int probe = connect_socket(path);
+        if (probe >= 0) {
+            close(probe);
+            cerr << "ERROR SERVICIO: Ya hay un servicio escuchando en: " << path << endl;
+            return false;
+        }
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                cerr << "ERROR SERVICIO: " << path << " existe y no es un socket." << endl;
+                return false;
+            }
+            unlink(path.c_str());
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            cerr << "ERROR SERVICIO: No se pudo crear el socket: " << strerror(errno) << endl;
+            return false;
+        }
+        // Solo el usuario que inició el servicio puede conectarse (los trabajos leen y escriben con sus permisos)
+        mode_t old_mask = umask(0177);
+        int bound = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        umask(old_mask);
+        if (bound != 0 || listen(fd, SOMAXCONN) != 0) {
+            cerr << "ERROR SERVICIO: No se pudo escuchar en " << path << ": " << strerror(errno) << endl;
+            close(fd);
+            return false;
+        }
+
+        listen_fd = fd;
+        stop_requested = 0;
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = handle_stop_signal;
+        sigemptyset(&action.sa_mask);
+        // Sin SA_RESTART: accept vuelve con EINTR
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        log_progress(config, "Servicio escuchando en ", path, " (", runner.size(), " hilos)");
+        while (!stop_requested) {
+            int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (stop_requested) break;
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                cerr << "ERROR SERVICIO: accept falló: " << strerror(errno) << endl;
+                break;
+            }
+            auto connection = make_shared<Connection>(client);
+            {
+                lock_guard<mutex> lock(connections_mtx);
+                open_fds.insert(client);
+                active++;
+            }
+            thread([this, connection]() { serve(connection); }).detach();
+        }
+
+        // Las conexiones abiertas dejan de leer; cada una responde lo que ya recibió
+        log_progress(config, "Deteniendo el servicio...");
+        {
+            unique_lock<mutex> lock(connections_mtx);
+            for (int client : open_fds) shutdown(client, SHUT_RD);
+            connections_cv.wait(lock, [this]() { return active == 0; });
+        }
+        runner.wait();
+
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        listen_fd = -1;
+        close(fd);
+        unlink(path.c_str());
+        log_progress(config, "Servicio detenido.");
+        return true;
+    }
+
+private:
+    void serve(shared_ptr<Connection> connection) {
+        LineReader reader(connection->fd);
+        string line;
+        size_t number = 0;
+        LineReader::Status status;
+        while ((status = reader.next(line)) == LineReader::Line) {
+            number++;
+            if (!is_job_line(line)) continue;
+
+            vector<string> args;
+            if (split_job_line(line, args) && args.size() == 1 && args[0] == "--shutdown") {
+                log_progress(config, "Orden de detener el servicio recibida.");
+                {
+                    lock_guard<mutex> lock(connection->mtx);
+                    send_all(connection->fd, "{\"detener\": true}\n");
+                }
+                request_stop();
+                break;
+            }
+
+            {
+                lock_guard<mutex> lock(connection->mtx);
+                connection->pending++;
+                connection->jobs++;
+            }
+            runner.submit(number, line, [connection](const JobResult& result) {
+                lock_guard<mutex> lock(connection->mtx);
+                if (!result.ok) connection->failed++;
+                send_all(connection->fd, result_line(result));
+                if (--connection->pending == 0) connection->done_cv.notify_all();
+            });
+        }
+
+        {
+            unique_lock<mutex> lock(connection->mtx);
+            if (status == LineReader::TooLong) {
+                // Sin forma de encontrar el inicio del trabajo siguiente: se cierra la conexión
+                JobResult result;
+                result.id = number + 1;
+                result.error = "Línea de más de " + to_string(JOB_LINE_MAX) + " bytes.";
+                connection->jobs++;
+                connection->failed++;
+                send_all(connection->fd, result_line(result));
+            }
+            connection->done_cv.wait(lock, [&connection]() { return connection->pending == 0; });
+            send_all(connection->fd, summary_line(connection->jobs, connection->failed,
+                                                  monotonic_ns() - connection->started));
+        }
+
+        lock_guard<mutex> lock(connections_mtx);
+        open_fds.erase(connection->fd);
+        close(connection->fd);
+        active--;
+        connections_cv.notify_all();
+    }
+
+    const Config& config;
+    mutex connections_mtx;
+    condition_variable connections_cv;
+    set<int> open_fds;
+    size_t active = 0;
+    JobRunner runner;
+};
+
+// =================================================================
+// CLIENTE
+// =================================================================
+
+// Entre comillas simples si hace falta (una comilla simple se escribe '\'')
+string quote_job_arg(const string& arg) {
+    if (!arg.empty() && arg.find_first_of(" \t'\"\\#") == string::npos) return arg;
+    string out = "'";
+    for (char c : arg) {
+        if (c == '\'') {
+            out += "'\\''";
+        } else {
+            out += c;
+        }
+    }
+    return out + "'";
+}
+
+// Las rutas relativas de -i, -o y --dict se resuelven contra el directorio del cliente
+string absolute_job_line(const string& line, const string& cwd) {
+    vector<string> args;
+    if (cwd.empty() || !split_job_line(line, args)) return line; // El servicio informa el error
+    string out;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const string& arg = args[i];
+        if ((arg == "-i" || arg == "-o" || arg == "--dict") && i + 1 < args.size()) {
+            string& value = args[i + 1];
+            if (!value.empty() && value[0] != '/' && value[0] != '-') value = cwd + "/" + value;
+        }
+        out += (i ? " " : "") + quote_job_arg(arg);
+    }
+    return out;
+}
+
+} // namespace
+
+bool split_job_line(const string& line, vector<string>& args) {
+    args.clear();
+    string current;
+    bool in_arg = false;
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quote == '\'') {
+            // Entre comillas simples todo es literal
+            if (c == '\'') {
+                quote = 0;
+            } else {
+                current += c;
+            }
+        } else if (quote == '"') {
+            if (c == '"') {
+                quote = 0;
+            } else if (c == '\\' && i + 1 < line.size() && (line[i + 1] == '"' || line[i + 1] == '\\')) {
+                current += line[++i];
+            } else {
+                current += c;
+            }
+        } else if (c == ' ' || c == '\t') {
+            if (in_arg) {
+                args.push_back(current);
+                current.clear();
+                in_arg = false;
+            }
+        } else {
+            in_arg = true;
+            if (c == '\'' || c == '"') {
+                quote = c;
+            } else if (c == '\\' && i + 1 < line.size()) {
+                current += line[++i];
+            } else {
+                current += c;
+            }
+        }
+    }
+    if (quote != 0) return false;
+    if (in_arg) args.push_back(current);
+    return true;
+}
+
+bool run_batch(const Config& config) {
+    ifstream file;
+    istream* in = &cin;
+    if (config.batch_path != "-") {
+        file.open(config.batch_path);
+        if (!file) {
+            cerr << "ERROR LOTE: No se pudo abrir el manifiesto: " << config.batch_path << endl;
+            return false;
+        }
+        in = &file;
+    }
+
+    uint64_t started = monotonic_ns();
+    mutex out_mtx;
+    atomic<size_t> failed{0};
+    auto report = [&](const JobResult& result) {
+        if (!result.ok) failed++;
+        lock_guard<mutex> lock(out_mtx);
+        cout << result_line(result) << flush;
+    };
+
+    JobRunner runner(config.threads);
+    size_t jobs = 0;
+    size_t number = 0;
+    string line;
+    while (getline(*in, line)) {
+        number++;
+        if (!is_job_line(line)) continue;
+        jobs++;
+        runner.submit(number, line, report);
+    }
+    runner.wait();
+    cout << summary_line(jobs, failed, monotonic_ns() - started) << flush;
+    return failed == 0;
+}
+
+bool run_daemon(const Config& config) {
+    Daemon daemon(config);
+    return daemon.run();
+}
+
+bool run_client(const Config& config) {
+    // Las líneas se envían todas (también comentarios y vacías) para que los números coincidan con el manifiesto
+    vector<string> lines;
+    if (!config.batch_path.empty()) {
+        ifstream file;
+        istream* in = &cin;
+        if (config.batch_path != "-") {
+            file.open(config.batch_path);
+            if (!file) {
+                cerr << "ERROR CLIENTE: No se pudo abrir el manifiesto: " << config.batch_path << endl;
+                return false;
+            }
+            in = &file;
+        }
+        char buffer[4096];
+        string cwd = getcwd(buffer, sizeof(buffer)) ? buffer : "";
+        string line;
+        while (getline(*in, line)) {
+            lines.push_back(is_job_line(line) ? absolute_job_line(line, cwd) : line);
+        }
+    }
+    if (config.shutdown_daemon) lines.push_back("--shutdown");
+
+    int fd = connect_socket(config.client_socket);
+    if (fd < 0) {
+        cerr << "ERROR CLIENTE: No se pudo conectar con el servicio en " << config.client_socket << ": "
+             << strerror(errno) << endl;
+        return false;
+    }
+
+    // Las respuestas se leen mientras se envían los trabajos (el servicio responde a medida que terminan)
+    bool failed = false;
+    bool finished = false;
+    thread reader_thread([&]() {
+        LineReader reader(fd);
+        string line;
+        while (reader.next(line) == LineReader::Line) {
+            cout << line << '\n' << flush;
+            if (line.find("\"ok\": false") != string::npos) failed = true;
+            if (line.find("\"trabajos\":") != string::npos) finished = true;
+        }
+    });
+    for (const string& line : lines) {
+        if (!send_all(fd, line + "\n")) break;
+    }
+    shutdown(fd, SHUT_WR);
+    reader_thread.join();
+    close(fd);
+
+    if (!finished) {
+        cerr << "ERROR CLIENTE: El servicio cerró la conexión sin terminar de responder." << endl;
+        return false;
+    }
+    return !failed;
+}
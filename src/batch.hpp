@@ -0,0 +1,60 @@
+#pragma once
+
+#include "constantes.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * Modo lote y servicio: muchos trabajos en un solo proceso. Los trabajos
+ * comparten un pool de -j hilos cuyos arenas y cachés de claves quedan
+ * calientes de un trabajo al siguiente, y los diccionarios se cargan una
+ * sola vez; así una secuencia de archivos pequeños no paga en cada uno el
+ * arranque del proceso, la creación de hilos ni la reserva de buffers.
+ *
+ * Trabajo: una línea con las mismas opciones que la línea de comandos
+ * (-c -i datos.txt -o datos.lz77 --dict d.dict). Se admiten comillas
+ * simples y dobles y la barra invertida como escape; las líneas vacías y
+ * las que empiezan con '#' se ignoran. Un trabajo no puede usar la
+ * entrada/salida estándar, --stats ni las opciones de lote/servicio. Las
+ * rutas relativas se resuelven contra el directorio del proceso que
+ * ejecuta el trabajo (--client las convierte en absolutas antes de enviarlas).
+ *
+ * Respuesta: una línea JSON por trabajo, en el orden en que terminan:
+ *   {"trabajo": <línea>, "ok": true|false, "error": "...", "espera_ms": ...,
+ *    "tiempo_ms": ..., "bytes_entrada": ..., "bytes_salida": ...}
+ * y al final un resumen {"trabajos": ..., "fallidos": ..., "tiempo_total_ms": ...}.
+ */
+
+/**
+ * Divide una línea de trabajo en argumentos.
+ * @param line Línea del manifiesto o del socket.
+ * @param args Recibe los argumentos.
+ * @return false si queda una comilla sin cerrar.
+ */
+bool split_job_line(const std::string& line, std::vector<std::string>& args);
+
+/**
+ * Ejecuta los trabajos de un manifiesto (--batch) y escribe las respuestas en la salida estándar.
+ * @param config config.batch_path es el manifiesto ("-" = entrada estándar); config.threads, el tamaño del pool.
+ * @return true si todos los trabajos terminaron bien.
+ */
+bool run_batch(const Config& config);
+
+/**
+ * Servicio (--daemon): acepta conexiones en un socket Unix y ejecuta los
+ * trabajos que llegan por ellas, respondiendo por la misma conexión. Cada
+ * conexión recibe su resumen al cerrar su escritura y terminar sus
+ * trabajos. La línea "--shutdown", SIGINT o SIGTERM detienen el servicio
+ * (se terminan los trabajos en curso y se elimina el socket).
+ * @param config config.daemon_socket es la ruta del socket.
+ * @return false si no se pudo abrir el socket.
+ */
+bool run_daemon(const Config& config);
+
+/**
+ * Cliente (--client): envía al servicio los trabajos de config.batch_path
+ * (y con config.shutdown_daemon, la orden de terminar) y escribe sus
+ * respuestas en la salida estándar.
+ * @return true si el servicio respondió y todos los trabajos terminaron bien.
+ */
+bool run_client(const Config& config);
@@ -0,0 +1,299 @@
+#include "block.hpp"
+#include "bytes.hpp"
+#include "compress.hpp"
+#include "crypto.hpp"
+#include "thread_pool.hpp"
+#include <iostream>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// Constantes del formato del contenedor
+static const unsigned char BLOCK_MAGIC[4] = {'G', 'S', 'B', 'K'};
+static const unsigned char TABLE_MAGIC[4] = {'G', 'S', 'B', 'T'};
+static const unsigned char BLOCK_VERSION = 1;
+
+// =================================================================
+// PRIMITIVAS DEL FORMATO
+// =================================================================
+
+bool is_block_container(const unsigned char* data, size_t size) {
+    return size >= BLOCK_CONTAINER_HEADER_SIZE &&
+           memcmp(data, BLOCK_MAGIC, 4) == 0 &&
+           data[4] == BLOCK_VERSION;
+}
+
+bool is_block_container(ByteView data) {
+    return is_block_container(data.data(), data.size());
+}
+
+unsigned char block_flags(const Config& config) {
+    unsigned char flags = 0;
+    if (config.compress) flags |= BLOCK_FLAG_COMPRESSED;
+    if (config.encrypt) flags |= BLOCK_FLAG_ENCRYPTED;
+    return flags;
+}
+
+void write_container_header(FileData& out, unsigned char flags, uint32_t block_size) {
+    out.insert(out.end(), BLOCK_MAGIC, BLOCK_MAGIC + 4);
+    out.push_back(BLOCK_VERSION);
+    out.push_back(flags);
+    out.push_back(0);
+    out.push_back(0);
+    put_u32(out, block_size);
+}
+
+void write_block_header(FileData& out, uint32_t raw_size, uint32_t stored_size) {
+    put_u32(out, raw_size);
+    put_u32(out, stored_size);
+}
+
+void write_container_trailer(FileData& out, const vector<BlockEntry>& table, uint64_t end_offset) {
+    write_block_header(out, 0, 0);
+    uint64_t table_offset = end_offset + BLOCK_HEADER_SIZE;
+    for (const BlockEntry& entry : table) {
+        put_u64(out, entry.offset);
+        put_u32(out, entry.raw_size);
+        put_u32(out, entry.stored_size);
+    }
+    put_u64(out, table_offset);
+    put_u32(out, static_cast<uint32_t>(table.size()));
+    out.insert(out.end(), TABLE_MAGIC, TABLE_MAGIC + 4);
+}
+
+FileData encode_block(const unsigned char* data, size_t size, const Config& config, bool* stored) {
+    // Cada etapa lee directamente de la anterior, sin copiar la entrada
+    ByteView current(data, size);
+    FileData block;
+    if (config.compress) {
+        block = compress_selected(current, config, stored);
+        current = block;
+    }
+    if (config.encrypt && config.compress) {
+        encrypt_selected_in_place(block, config);
+    } else if (config.encrypt) {
+        block = encrypt_selected(current, config);
+    } else if (!config.compress) {
+        block.assign(data, data + size);
+    }
+    return block;
+}
+
+uint64_t max_encoded_size(uint64_t raw_size) {
+    return max_compressed_size(raw_size) + CHACHA20_HEADER_SIZE;
+}
+
+bool decode_block(const unsigned char* payload, size_t stored_size, size_t raw_size,
+                  unsigned char flags, const Config& config, FileData& out) {
+    ByteView current(payload, stored_size);
+    if (flags & BLOCK_FLAG_ENCRYPTED) {
+        out = decrypt_selected(current, config);
+        if (out.empty() && stored_size > 0) return false;
+        current = out;
+    }
+    if (flags & BLOCK_FLAG_COMPRESSED) {
+        out = decompress_lz77(current, config.dictionary.get());
+    } else if (!(flags & BLOCK_FLAG_ENCRYPTED)) {
+        out.assign(payload, payload + stored_size);
+    }
+    return out.size() == raw_size;
+}
+
+bool check_block_flags(unsigned char flags, const Config& config) {
+    if ((flags & BLOCK_FLAG_ENCRYPTED) && (!config.decrypt || config.key.empty())) {
+        cerr << "ERROR BLOQUES: El contenedor está encriptado; se requiere -u y una clave (-k)." << endl;
+        return false;
+    }
+    if ((flags & BLOCK_FLAG_COMPRESSED) && !config.decompress) {
+        cerr << "ERROR BLOQUES: El contenedor está comprimido; se requiere -d." << endl;
+        return false;
+    }
+    return true;
+}
+
+// =================================================================
+// PROCESAMIENTO EN MEMORIA
+// =================================================================
+
+FileData build_blocks(ByteView input, const Config& config, ThreadPool* pool, StoreReport* report) {
+    size_t block_size = config.block_size;
+    if (input.empty() || block_size == 0) return {};
+
+    size_t count = (input.size() + block_size - 1) / block_size;
+    vector<FileData> encoded(count);
+    vector<char> stored(count, 0);
+
+    // 1. Comprimir/encriptar cada bloque de forma independiente
+    parallel_for(pool, count, [&](size_t i) {
+        size_t start = i * block_size;
+        size_t len = min(block_size, input.size() - start);
+        bool block_stored = false;
+        encoded[i] = encode_block(input.data() + start, len, config, &block_stored);
+        stored[i] = block_stored;
+    });
+
+    if (report && config.compress) {
+        for (char s : stored) (s ? report->stored : report->compressed)++;
+    }
+
+    // 2. Ensamblar el contenedor: cabecera, bloques, tabla y pie
+    size_t total = BLOCK_CONTAINER_HEADER_SIZE + (count + 1) * BLOCK_HEADER_SIZE +
+                   count * BLOCK_TABLE_ENTRY_SIZE + BLOCK_FOOTER_SIZE;
+    for (const FileData& block : encoded) total += block.size();
+
+    FileData output;
+    output.reserve(total);
+    write_container_header(output, block_flags(config), static_cast<uint32_t>(block_size));
+
+    vector<BlockEntry> table(count);
+    for (size_t i = 0; i < count; ++i) {
+        table[i].offset = output.size();
+        table[i].raw_size = static_cast<uint32_t>(min(block_size, input.size() - i * block_size));
+        table[i].stored_size = static_cast<uint32_t>(encoded[i].size());
+        write_block_header(output, table[i].raw_size, table[i].stored_size);
+        output.insert(output.end(), encoded[i].begin(), encoded[i].end());
+        FileData().swap(encoded[i]);
+    }
+
+    write_container_trailer(output, table, output.size());
+    return output;
+}
+
+bool table_fits(uint64_t file_size, uint64_t min_offset, uint64_t footer_size, uint64_t table_offset,
+                uint64_t count, uint64_t entry_size) {
+    if (entry_size == 0 || file_size < min_offset || file_size - min_offset < footer_size) return false;
+    uint64_t room = file_size - footer_size - min_offset;
+    if (count > room / entry_size) return false;
+    return table_offset == file_size - footer_size - count * entry_size;
+}
+
+bool block_fits(uint64_t offset, uint64_t stored_size, uint64_t data_start, uint64_t data_end) {
+    return offset >= data_start && data_end >= BLOCK_HEADER_SIZE && offset <= data_end - BLOCK_HEADER_SIZE &&
+           stored_size <= data_end - BLOCK_HEADER_SIZE - offset;
+}
+
+/**
+ * Lee y valida el pie y la tabla de bloques de un contenedor.
+ * @param raw_offsets Recibe el offset original de cada bloque y, al final, el tamaño total.
+ */
+static bool read_block_table(ByteView container, vector<BlockEntry>& table, vector<uint64_t>& raw_offsets) {
+    if (!is_block_container(container) ||
+        container.size() < BLOCK_CONTAINER_HEADER_SIZE + BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE) {
+        cerr << "ERROR BLOQUES: Cabecera de contenedor inválida." << endl;
+        return false;
+    }
+
+    const unsigned char* footer = container.data() + container.size() - BLOCK_FOOTER_SIZE;
+    if (memcmp(footer + 12, TABLE_MAGIC, 4) != 0) {
+        cerr << "ERROR BLOQUES: Pie del contenedor inválido." << endl;
+        return false;
+    }
+    uint64_t table_offset = get_u64(footer);
+    size_t count = get_u32(footer + 8);
+    // Antes de la tabla van al menos la cabecera y el marcador de fin
+    if (!table_fits(container.size(), BLOCK_CONTAINER_HEADER_SIZE + BLOCK_HEADER_SIZE, BLOCK_FOOTER_SIZE,
+                    table_offset, count, BLOCK_TABLE_ENTRY_SIZE)) {
+        cerr << "ERROR BLOQUES: Tabla de bloques fuera de límites." << endl;
+        return false;
+    }
+
+    size_t blocks_end = table_offset - BLOCK_HEADER_SIZE;
+    // Ningún bloque supera el tamaño de bloque de la cabecera (el último puede ser menor)
+    uint32_t block_size = get_u32(container.data() + 8);
+    table.resize(count);
+    raw_offsets.assign(count + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* p = container.data() + table_offset + i * BLOCK_TABLE_ENTRY_SIZE;
+        table[i].offset = get_u64(p);
+        table[i].raw_size = get_u32(p + 8);
+        table[i].stored_size = get_u32(p + 12);
+        if (!block_fits(table[i].offset, table[i].stored_size, BLOCK_CONTAINER_HEADER_SIZE, blocks_end) ||
+            table[i].raw_size > block_size) {
+            cerr << "ERROR BLOQUES: El bloque " << i << " excede el contenedor." << endl;
+            return false;
+        }
+        raw_offsets[i + 1] = raw_offsets[i] + table[i].raw_size;
+    }
+    return true;
+}
+
+/**
+ * Restaura en paralelo los bloques [first, last) del contenedor; para cada
+ * uno llama a place(i, datos) con el bloque ya desencriptado y descomprimido.
+ */
+static bool decode_block_span(ByteView container, const vector<BlockEntry>& table, size_t first, size_t last,
+                              const Config& config, ThreadPool* pool,
+                              const function<void(size_t, const FileData&)>& place) {
+    unsigned char flags = container[5];
+    atomic<bool> failed(false);
+    parallel_for(pool, last - first, [&](size_t k) {
+        if (failed) return;
+        size_t i = first + k;
+        FileData block;
+        const unsigned char* payload = container.data() + table[i].offset + BLOCK_HEADER_SIZE;
+        if (!decode_block(payload, table[i].stored_size, table[i].raw_size, flags, config, block)) {
+            cerr << "ERROR BLOQUES: Falló la restauración del bloque " << i << "." << endl;
+            failed = true;
+            return;
+        }
+        place(i, block);
+    });
+    return !failed;
+}
+
+FileData restore_blocks(ByteView container, const Config& config, ThreadPool* pool) {
+    // 1. Leer el pie y la tabla de bloques
+    vector<BlockEntry> table;
+    vector<uint64_t> raw_offsets;
+    if (!read_block_table(container, table, raw_offsets)) return {};
+    if (!check_block_flags(container[5], config)) return {};
+
+    // 2. Restaurar los bloques en paralelo directamente en su posición final
+    FileData output;
+    try {
+        output.resize(raw_offsets.back());
+    } catch (const bad_alloc&) {
+        cerr << "ERROR BLOQUES: Tamaño original demasiado grande (" << raw_offsets.back() << " bytes)." << endl;
+        return {};
+    }
+    bool ok = decode_block_span(container, table, 0, table.size(), config, pool,
+        [&](size_t i, const FileData& block) {
+            memcpy(output.data() + raw_offsets[i], block.data(), block.size());
+        });
+
+    if (!ok) return {};
+    return output;
+}
+
+FileData read_block_range(ByteView container, uint64_t offset, uint64_t length, const Config& config,
+                          ThreadPool* pool) {
+    vector<BlockEntry> table;
+    vector<uint64_t> raw_offsets;
+    if (!read_block_table(container, table, raw_offsets)) return {};
+    if (!check_block_flags(container[5], config)) return {};
+
+    uint64_t total = raw_offsets.back();
+    if (length == 0 || offset >= total) {
+        cerr << "ERROR BLOQUES: El rango comienza fuera del contenido (" << total << " bytes)." << endl;
+        return {};
+    }
+    uint64_t end = offset + min(length, total - offset);
+
+    // Tabla de búsqueda: primer y último bloque que cubren [offset, end)
+    size_t first = upper_bound(raw_offsets.begin(), raw_offsets.end(), offset) - raw_offsets.begin() - 1;
+    size_t last = lower_bound(raw_offsets.begin(), raw_offsets.end(), end) - raw_offsets.begin();
+
+    FileData output(end - offset);
+    bool ok = decode_block_span(container, table, first, last, config, pool,
+        [&](size_t i, const FileData& block) {
+            uint64_t from = max(offset, raw_offsets[i]);
+            uint64_t to = min(end, raw_offsets[i + 1]);
+            memcpy(output.data() + (from - offset), block.data() + (from - raw_offsets[i]), to - from);
+        });
+
+    if (!ok) return {};
+    return output;
+}
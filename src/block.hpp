@@ -0,0 +1,165 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "compress.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Contenedor por bloques para procesar un único archivo grande en paralelo.
+ * La entrada se divide en bloques independientes que se comprimen/encriptan
+ * por separado (la clave Vigenère se reinicia en cada bloque; con ChaCha20
+ * cada bloque lleva su propia cabecera y nonce). Un bloque
+ * incompresible se guarda como flujo LZ77 almacenado (ver store_lz77).
+ *
+ * Formato (enteros little-endian):
+ * - Cabecera (12 bytes): ["GSBK"] [Versión (1)] [Flags (1)] [Reservado (2)] [Tamaño de bloque (4)]
+ * - Por bloque: [Tamaño original (4)] [Tamaño almacenado (4)] [Datos]
+ * - Fin de bloques (8 bytes): [0 (4)] [0 (4)]
+ * - Tabla de bloques: por bloque [Offset de su cabecera (8)] [Tamaño original (4)] [Tamaño almacenado (4)]
+ * - Pie (16 bytes): [Offset de la tabla (8)] [Número de bloques (4)] ["GSBT"]
+ *
+ * La tabla permite restaurar los bloques en paralelo y leer un rango sin
+ * restaurar el resto (read_block_range: todos los bloques salvo el último
+ * tienen el tamaño original fijo de la cabecera); el marcador de fin
+ * permite leer el contenedor de forma secuencial (streaming).
+ */
+
+// Tamaños fijos de las partes del contenedor
+const size_t BLOCK_CONTAINER_HEADER_SIZE = 12;
+const size_t BLOCK_HEADER_SIZE = 8;
+const size_t BLOCK_TABLE_ENTRY_SIZE = 16;
+const size_t BLOCK_FOOTER_SIZE = 16;
+
+// Flags de la cabecera: etapas aplicadas a cada bloque
+const unsigned char BLOCK_FLAG_COMPRESSED = 0x01;
+const unsigned char BLOCK_FLAG_ENCRYPTED = 0x02;
+
+// Entrada de la tabla de bloques
+struct BlockEntry {
+    uint64_t offset;      // Offset de la cabecera del bloque en el contenedor
+    uint32_t raw_size;    // Tamaño original del bloque
+    uint32_t stored_size; // Tamaño almacenado (tras comprimir/encriptar)
+};
+
+/**
+ * Indica si los datos comienzan con la cabecera del contenedor por bloques.
+ * @param data Datos a inspeccionar.
+ * @param size Cantidad de bytes disponibles.
+ * @return true si es un contenedor por bloques.
+ */
+bool is_block_container(const unsigned char* data, size_t size);
+bool is_block_container(ByteView data);
+
+/**
+ * Calcula los flags del contenedor a partir de la configuración.
+ */
+unsigned char block_flags(const Config& config);
+
+/**
+ * Agrega la cabecera del contenedor a out.
+ */
+void write_container_header(FileData& out, unsigned char flags, uint32_t block_size);
+
+/**
+ * Agrega la cabecera de un bloque (o el marcador de fin si ambos tamaños son 0).
+ */
+void write_block_header(FileData& out, uint32_t raw_size, uint32_t stored_size);
+
+/**
+ * Agrega el marcador de fin, la tabla de bloques y el pie del contenedor.
+ * @param out Destino.
+ * @param table Entradas de los bloques escritos.
+ * @param end_offset Offset en el contenedor donde comienza el marcador de fin.
+ */
+void write_container_trailer(FileData& out, const std::vector<BlockEntry>& table, uint64_t end_offset);
+
+/**
+ * Comprime y/o encripta un bloque según config.compress / config.encrypt.
+ * @param data Inicio del bloque.
+ * @param size Tamaño del bloque.
+ * @param stored Si no es nulo, recibe true si el bloque se almacenó sin comprimir.
+ * @return Bloque almacenable.
+ */
+FileData encode_block(const unsigned char* data, size_t size, const Config& config, bool* stored = nullptr);
+
+/**
+ * Tamaño máximo que encode_block puede producir para un bloque de raw_size
+ * bytes (respaldo almacenado más la cabecera de ChaCha20). Permite rechazar
+ * un tamaño almacenado imposible antes de reservar memoria para leerlo.
+ */
+uint64_t max_encoded_size(uint64_t raw_size);
+
+/**
+ * Desencripta y/o descomprime un bloque según los flags del contenedor.
+ * @param payload Datos almacenados del bloque.
+ * @param stored_size Tamaño almacenado.
+ * @param raw_size Tamaño original esperado.
+ * @param flags Flags del contenedor.
+ * @param out Recibe los datos originales.
+ * @return true si el bloque se restauró correctamente.
+ */
+bool decode_block(const unsigned char* payload, size_t stored_size, size_t raw_size,
+                  unsigned char flags, const Config& config, FileData& out);
+
+/**
+ * Verifica que la configuración permita restaurar un contenedor con estos flags
+ * (clave y operaciones -u/-d), informando el error por cerr.
+ */
+bool check_block_flags(unsigned char flags, const Config& config);
+
+/**
+ * Divide la entrada en bloques y aplica compresión y/o encriptación
+ * (según config.compress / config.encrypt) a cada bloque en paralelo.
+ * @param input Datos originales.
+ * @param config Parámetros de la operación (block_size, key, ...).
+ * @param pool Pool donde se reparten los bloques (nulo = en el hilo actual).
+ * @param report Si no es nulo, acumula cuántos bloques se comprimieron o almacenaron.
+ * @return Contenedor por bloques, o vector vacío en caso de error.
+ */
+FileData build_blocks(ByteView input, const Config& config, ThreadPool* pool, StoreReport* report = nullptr);
+
+/**
+ * Valida la ubicación de una tabla al final de un archivo: count entradas
+ * de entry_size bytes que empiezan en table_offset, no antes de min_offset,
+ * y terminan justo antes del pie. Los valores vienen del archivo, así que se
+ * comparan con restas (una suma podría desbordar y dar el valor esperado).
+ * @param file_size Tamaño del archivo.
+ * @param min_offset Primer offset posible de la tabla (cabecera y datos obligatorios).
+ * @param footer_size Tamaño del pie.
+ * @return true si la tabla cabe exactamente entre min_offset y el pie.
+ */
+bool table_fits(uint64_t file_size, uint64_t min_offset, uint64_t footer_size, uint64_t table_offset,
+                uint64_t count, uint64_t entry_size);
+
+/**
+ * Valida, sin desbordamientos, que un bloque (cabecera de 8 bytes más
+ * stored_size bytes de datos) quede dentro de [data_start, data_end).
+ */
+bool block_fits(uint64_t offset, uint64_t stored_size, uint64_t data_start, uint64_t data_end);
+
+/**
+ * Restaura en paralelo los bloques de un contenedor (desencripta y descomprime
+ * según los flags del contenedor) y los concatena.
+ * @param container Contenedor por bloques.
+ * @param config Parámetros de la operación (key, decrypt, decompress).
+ * @param pool Pool donde se reparten los bloques (nulo = en el hilo actual).
+ * @return Datos originales, o vector vacío en caso de error.
+ */
+FileData restore_blocks(ByteView container, const Config& config, ThreadPool* pool);
+
+/**
+ * Lee un rango de bytes del contenido original de un contenedor por bloques
+ * sin restaurarlo completo: con la tabla de bloques (tabla de búsqueda) se
+ * ubican los bloques que cubren el rango y solo esos se desencriptan y
+ * descomprimen (en paralelo).
+ * @param container Contenedor por bloques.
+ * @param offset Offset del primer byte en el contenido original.
+ * @param length Cantidad de bytes; se recorta si excede el final.
+ * @param config Parámetros de la operación (key, decrypt, decompress).
+ * @param pool Pool donde se reparten los bloques (nulo = en el hilo actual).
+ * @return Bytes del rango, o vector vacío en caso de error.
+ */
+FileData read_block_range(ByteView container, uint64_t offset, uint64_t length, const Config& config,
+                          ThreadPool* pool);
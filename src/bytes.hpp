@@ -0,0 +1,55 @@
+#pragma once
+
+#include "constantes.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+// Utilidades para serializar enteros (little-endian y varint) dentro de FileData.
+
+inline void put_u32(FileData& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+}
+
+inline void put_u64(FileData& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+}
+
+inline uint32_t get_u32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t get_u64(const unsigned char* p) {
+    return uint64_t(get_u32(p)) | (uint64_t(get_u32(p + 4)) << 32);
+}
+
+// Entero sin signo de longitud variable (7 bits por byte, LSB primero)
+inline void put_varint(FileData& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+// Bytes que ocupa v codificado como varint
+inline size_t varint_size(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+// Lee un varint en pos (lanza std::runtime_error si está incompleto)
+inline uint64_t get_varint(ByteView in, size_t& pos) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) throw std::runtime_error("Entero variable incompleto.");
+        unsigned char b = in[pos++];
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    throw std::runtime_error("Entero variable demasiado largo.");
+}
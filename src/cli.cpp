@@ -0,0 +1,294 @@
+#include "cli.hpp"
+#include "archive.hpp"
+#include "dictionary.hpp"
+#include "fs_utils.hpp"
+#include "metrics.hpp"
+#include "process.hpp"
+#include "thread_pool.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+// =================================================================
+// PARSEO DE ARGUMENTOS
+// =================================================================
+
+// "-" es un valor válido (entrada/salida estándar); otro token que empiece con '-' es una opción
+static bool is_value(const vector<string>& args, size_t i) {
+    return i < args.size() && (args[i].empty() || args[i][0] != '-' || args[i].size() == 1);
+}
+
+ArgsStatus parse_arguments(const vector<string>& argv, Config& config, string& error) {
+    // 1. Recolección de argumentos en un mapa
+    map<string, string> args;
+    for (size_t i = 0; i < argv.size(); ++i) {
+        const string& arg = argv[i];
+        if (arg.empty() || arg[0] != '-') continue;
+        // Opciones cortas que esperan valor (-i, -o, -k, -j) y opciones largas con valor
+        // (--comp-alg, --enc-alg, --stats -) o sin valor (--stream)
+        if (arg == "-i" || arg == "-o" || arg == "-k" || arg == "-j" || arg.substr(0, 2) == "--") {
+            if (is_value(argv, i + 1)) {
+                args[arg] = argv[i + 1];
+                i++;
+            } else {
+                args[arg] = "";
+            }
+        } else {
+            // Opciones cortas sin valor o combinadas (-c, -d, -ce)
+            args[arg] = "";
+        }
+    }
+
+    // 2. Parsear Operaciones y Opciones
+    if (args.count("-h")) return ArgsStatus::Help;
+
+    if (args.count("-i")) config.input_path = args["-i"];
+    if (args.count("-o")) config.output_path = args["-o"];
+    if (args.count("-k")) config.key = args["-k"];
+    if (args.count("--comp-alg")) config.comp_alg = args["--comp-alg"];
+    if (args.count("--enc-alg")) config.enc_alg = args["--enc-alg"];
+    if (args.count("--stream")) config.stream = true;
+    if (args.count("--archive")) config.archive = true;
+    if (args.count("--member")) config.member = args["--member"];
+    if (args.count("--quiet")) config.quiet = true;
+    if (args.count("--incremental")) config.incremental = true;
+    if (args.count("--dedup")) config.dedup = true;
+    if (args.count("--io-uring")) config.io_uring = true;
+    if (args.count("--prune")) config.prune = true;
+    if (args.count("--stats")) config.stats_path = args["--stats"];
+    if (args.count("--train-dict")) config.train_dict = true;
+    if (args.count("--dict")) config.dict_path = args["--dict"];
+    if (args.count("--batch")) config.batch_path = args["--batch"];
+    if (args.count("--daemon")) config.daemon_socket = args["--daemon"];
+    if (args.count("--client")) config.client_socket = args["--client"];
+    if (args.count("--shutdown")) config.shutdown_daemon = true;
+    if (args.count("--range")) {
+        // Formato offset:len (en bytes)
+        const string& range = args["--range"];
+        size_t colon = range.find(':');
+        char* end = nullptr;
+        config.range_offset = strtoull(range.c_str(), &end, 10);
+        bool valid = colon != string::npos && end == range.c_str() + colon && range[0] != '-';
+        if (valid) {
+            config.range_length = strtoull(range.c_str() + colon + 1, &end, 10);
+            valid = *end == '\0' && range[colon + 1] != '-' && config.range_length > 0;
+        }
+        if (!valid) {
+            error = "--range debe tener el formato offset:len con len > 0.";
+            return ArgsStatus::Invalid;
+        }
+    }
+    if (config.input_path == "-" || config.output_path == "-") config.stream = true;
+    if (args.count("--chain")) config.chain_depth = atoi(args["--chain"].c_str());
+    for (int level = LZ77_MIN_LEVEL; level <= LZ77_MAX_LEVEL; ++level) {
+        if (args.count("-" + to_string(level))) config.level = level;
+    }
+    if (args.count("--level")) config.level = atoi(args["--level"].c_str());
+    int threads = args.count("-j") ? atoi(args["-j"].c_str()) : 0;
+    int max_inflight_mb = args.count("--max-inflight") ? atoi(args["--max-inflight"].c_str()) : DEFAULT_MAX_INFLIGHT_MB;
+    int queue_depth = args.count("--queue-depth") ? atoi(args["--queue-depth"].c_str()) : DEFAULT_QUEUE_DEPTH;
+    int block_size_mb = args.count("--block-size") ? atoi(args["--block-size"].c_str()) : 0;
+    int dict_size_kb = args.count("--dict-size") ? atoi(args["--dict-size"].c_str()) : DICT_DEFAULT_KB;
+
+    // Manejo de la cadena de operaciones combinadas (ej: -ce)
+    for (const auto& pair : args) {
+        // Las opciones largas (--comp-alg, --chain, ...) no son operaciones
+        if (pair.first.substr(0, 2) == "--") continue;
+        if (pair.first.find('-') != string::npos && pair.first.size() > 1) {
+            for (char op : pair.first.substr(1)) {
+                if (op == 'c') config.compress = true;
+                if (op == 'd') config.decompress = true;
+                if (op == 'e') config.encrypt = true;
+                if (op == 'u') config.decrypt = true;
+                if (op == 'r') config.recursive = true;
+            }
+        }
+    }
+
+    if (args.count("-j")) {
+        if (threads < 1) {
+            error = "El número de hilos (-j) debe ser un entero positivo.";
+            return ArgsStatus::Invalid;
+        }
+        config.threads = static_cast<unsigned>(threads);
+    }
+
+    // Modo lote / servicio: los trabajos traen sus propias rutas y operaciones
+    if (args.count("--batch") || args.count("--daemon") || args.count("--client") || config.shutdown_daemon) {
+        if ((args.count("--batch") && config.batch_path.empty()) ||
+            (args.count("--daemon") && config.daemon_socket.empty()) ||
+            (args.count("--client") && config.client_socket.empty())) {
+            error = "--batch requiere un manifiesto (o \"-\"); --daemon y --client, la ruta del socket.";
+            return ArgsStatus::Invalid;
+        }
+        // --batch o --daemon solos; --client con --batch y/o --shutdown
+        bool valid = !config.client_socket.empty()
+            ? config.daemon_socket.empty() && (!config.batch_path.empty() || config.shutdown_daemon)
+            : config.daemon_socket.empty() != config.batch_path.empty() && !config.shutdown_daemon;
+        if (!valid) {
+            error = "Use --batch <manifiesto>, --daemon <socket> o --client <socket> (con --batch y/o --shutdown).";
+            return ArgsStatus::Invalid;
+        }
+        if (!config.input_path.empty() || !config.output_path.empty() || config.compress || config.decompress ||
+            config.encrypt || config.decrypt || !config.stats_path.empty()) {
+            error = "En modo lote/servicio las operaciones y rutas van en cada trabajo (solo se admiten -j y --quiet).";
+            return ArgsStatus::Invalid;
+        }
+        return ArgsStatus::Ok;
+    }
+
+    // 3. Validar Argumentos
+    if (config.input_path.empty() || config.output_path.empty()) {
+        error = "Las rutas de entrada (-i) y salida (-o) son obligatorias.";
+        return ArgsStatus::Usage;
+    }
+
+    if (config.compress && config.decompress) {
+        error = "No se pueden especificar ambas operaciones de compresión y descompresión.";
+        return ArgsStatus::Invalid;
+    }
+    if (config.encrypt && config.decrypt) {
+        error = "No se pueden especificar ambas operaciones de encriptación y desencriptación.";
+        return ArgsStatus::Invalid;
+    }
+    if ((config.encrypt || config.decrypt) && config.key.empty()) {
+        error = "Se requiere una clave secreta (-k) para las operaciones de encriptación/desencriptación.";
+        return ArgsStatus::Invalid;
+    }
+
+    if (config.level < LZ77_MIN_LEVEL || config.level > LZ77_MAX_LEVEL) {
+        error = "El nivel de compresión debe estar entre " + to_string(LZ77_MIN_LEVEL) + " y " +
+                to_string(LZ77_MAX_LEVEL) + ".";
+        return ArgsStatus::Invalid;
+    }
+
+    if (args.count("--chain") && config.chain_depth < 1) {
+        error = "La profundidad de la cadena (--chain) debe ser un entero positivo.";
+        return ArgsStatus::Invalid;
+    }
+
+    if (max_inflight_mb < 0) {
+        error = "El límite de bytes en vuelo (--max-inflight) no puede ser negativo.";
+        return ArgsStatus::Invalid;
+    }
+    config.max_inflight = static_cast<size_t>(max_inflight_mb) << 20;
+
+    if (args.count("--queue-depth")) {
+        if (queue_depth < 1 || queue_depth > 4096) {
+            error = "La profundidad de cola (--queue-depth) debe estar entre 1 y 4096.";
+            return ArgsStatus::Invalid;
+        }
+        config.queue_depth = static_cast<unsigned>(queue_depth);
+    }
+
+    if (args.count("--stats") && config.stats_path.empty()) {
+        error = "--stats requiere una ruta de salida (o \"-\").";
+        return ArgsStatus::Invalid;
+    }
+
+    if (args.count("--block-size")) {
+        if (block_size_mb < BLOCK_SIZE_MIN_MB || block_size_mb > BLOCK_SIZE_MAX_MB) {
+            error = "El tamaño de bloque (--block-size) debe estar entre " + to_string(BLOCK_SIZE_MIN_MB) + " y " +
+                    to_string(BLOCK_SIZE_MAX_MB) + " MiB.";
+            return ArgsStatus::Invalid;
+        }
+        config.block_size = static_cast<size_t>(block_size_mb) << 20;
+    }
+
+    // 4. Validar Algoritmos Soportados
+    if ((config.compress || config.decompress) && config.comp_alg != COMP_ALG_LZ77 && config.comp_alg != COMP_ALG_LZ77_HUF) {
+        error = "El algoritmo de compresión '" + config.comp_alg + "' no es compatible. Se soporta " +
+                COMP_ALG_LZ77 + " y " + COMP_ALG_LZ77_HUF + ".";
+        return ArgsStatus::Invalid;
+    }
+    if ((config.encrypt || config.decrypt) && config.enc_alg != ENC_ALG_VIGENERE && config.enc_alg != ENC_ALG_CHACHA20) {
+        error = "El algoritmo de encriptación '" + config.enc_alg + "' no es compatible. Se soporta " +
+                ENC_ALG_VIGENERE + " y " + ENC_ALG_CHACHA20 + ".";
+        return ArgsStatus::Invalid;
+    }
+
+    bool input_is_directory = is_directory(config.input_path);
+    if (config.range_length > 0 && (!(config.decompress || config.decrypt) || config.compress || config.encrypt ||
+                                    config.input_path == "-" || input_is_directory)) {
+        error = "--range requiere un archivo de entrada y solo -d y/o -u.";
+        return ArgsStatus::Invalid;
+    }
+
+    if (config.archive && (!input_is_directory || !(config.compress || config.encrypt))) {
+        error = "--archive requiere un directorio de entrada y -c y/o -e.";
+        return ArgsStatus::Invalid;
+    }
+
+    if (config.io_uring && (!input_is_directory || config.archive || config.dedup ||
+                            config.incremental || config.stream)) {
+        error = "--io-uring requiere un directorio de entrada (sin --archive, --dedup, --incremental ni --stream).";
+        return ArgsStatus::Invalid;
+    }
+
+    if (config.dedup && (!input_is_directory || !(config.compress || config.encrypt) ||
+                         config.archive || config.incremental)) {
+        error = "--dedup requiere un directorio de entrada y -c y/o -e (sin --archive ni --incremental).";
+        return ArgsStatus::Invalid;
+    }
+
+    if ((config.incremental || config.prune) && (!input_is_directory || config.archive || !config.incremental)) {
+        error = "--incremental requiere un directorio de entrada (sin --archive); --prune requiere --incremental.";
+        return ArgsStatus::Invalid;
+    }
+
+    if (config.train_dict && (!input_is_directory || config.compress || config.decompress ||
+                              config.encrypt || config.decrypt)) {
+        error = "--train-dict requiere un directorio de entrada (-i), la ruta del diccionario (-o) y ninguna operación.";
+        return ArgsStatus::Invalid;
+    }
+    if (dict_size_kb < DICT_MIN_KB || dict_size_kb > DICT_MAX_KB) {
+        error = "El tamaño del diccionario (--dict-size) debe estar entre " + to_string(DICT_MIN_KB) + " y " +
+                to_string(DICT_MAX_KB) + " KiB.";
+        return ArgsStatus::Invalid;
+    }
+    config.dict_size = static_cast<size_t>(dict_size_kb) << 10;
+
+    if (args.count("--dict") && (config.dict_path.empty() || !(config.compress || config.decompress))) {
+        error = "--dict requiere la ruta del diccionario y -c o -d.";
+        return ArgsStatus::Invalid;
+    }
+
+    if (config.output_path == "-" && input_is_directory) {
+        error = "La salida estándar (-o -) no está disponible en modo directorio.";
+        return ArgsStatus::Invalid;
+    }
+
+    return ArgsStatus::Ok;
+}
+
+// =================================================================
+// EJECUCIÓN
+// =================================================================
+
+bool run_operation(const Config& config, ThreadPool& pool) {
+    // Operación (Archivo único vs. Directorio concurrente)
+    if (config.train_dict) {
+        return train_dictionary(config, pool);
+    } else if (is_directory(config.input_path)) {
+        return process_directory(config, pool);
+    } else if ((config.decrypt || config.decompress) && config.range_length == 0 && is_archive_file(config.input_path)) {
+        // Archivo sólido: se extrae completo en -o, o solo el miembro pedido
+        log_progress(config, "--- Modo Archivo Sólido: Extrayendo ", config.input_path, " ---");
+        bool ok = config.member.empty()
+            ? extract_archive(config.input_path, config.output_path, config, pool)
+            : extract_member(config.input_path, config.member, config.output_path, config);
+        if (!ok) {
+            cerr << "ERROR: Falló la extracción del archivo sólido: " << config.input_path << endl;
+            return false;
+        }
+        log_progress(config, "--- Extracción finalizada ---");
+        return true;
+    }
+    log_progress(config, "--- Modo Archivo Único: Iniciando procesamiento secuencial ---");
+    // Con un solo hilo (-j 1, o un archivo de un lote) todo corre en el hilo actual
+    bool ok = process_file(config.input_path, config.output_path, config, config.threads == 1 ? nullptr : &pool);
+    log_progress(config, "--- Procesamiento de archivo único finalizado ---");
+    return ok;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "thread_pool.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * Interpretación de los argumentos y ejecución de una operación. La usa el
+ * main de gsea y también el modo lote/servicio, donde cada trabajo es una
+ * línea con las mismas opciones que la línea de comandos.
+ */
+
+// Resultado de parse_arguments
+enum class ArgsStatus {
+    Ok,      // config lista para ejecutar
+    Help,    // Se pidió la ayuda (-h)
+    Usage,   // Faltan argumentos obligatorios (se muestra la ayuda con el error)
+    Invalid  // Combinación inválida (solo el error)
+};
+
+/**
+ * Interpreta y valida los argumentos. No carga el diccionario (queda su
+ * ruta en config.dict_path) ni tiene efectos sobre el proceso.
+ * @param args Argumentos sin el nombre del programa.
+ * @param config Recibe los parámetros de la operación.
+ * @param error Recibe el mensaje (sin el prefijo "ERROR: ") si no es Ok.
+ * @return Estado del análisis.
+ */
+ArgsStatus parse_arguments(const std::vector<std::string>& args, Config& config, std::string& error);
+
+/**
+ * Ejecuta la operación de config: entrenamiento de diccionario, directorio,
+ * extracción de un archivo sólido o archivo único.
+ * @param pool Pool donde se reparte el trabajo; en modo lote es el compartido
+ *        por todos los trabajos (solo se esperan los de esta operación).
+ * @return true si la operación terminó sin errores.
+ */
+bool run_operation(const Config& config, ThreadPool& pool);
@@ -1,43 +1,914 @@
 #include "compress.hpp"
+#include "arena.hpp"
+#include "bytes.hpp"
+#include "entropy.hpp"
+#include "hash.hpp"
 #include <iostream>
 #include <algorithm>
 #include <stdexcept>
+#include <cstdint>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <new>
 
 using namespace std;
 
-FileData compress_lz77(const FileData& input) {
-    if (input.empty()) return {};
+// =================================================================
+// BUSCADOR DE COINCIDENCIAS (HASH CHAIN)
+// =================================================================
+
+namespace {
+
+// Tamaño máximo de la tabla de hash de prefijos de 3 bytes (en bits)
+const int HASH_BITS = 17;
+const int MIN_HASH_BITS = 10;
+// Longitud mínima que puede encontrar el buscador (tamaño del prefijo)
+const size_t MIN_MATCH = 3;
+
+// Hash de un prefijo de 3 bytes con la cantidad de bits indicada
+inline size_t hash3(const unsigned char* p, int bits) {
+    uint32_t v = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+    return (v * 2654435761u) >> (32 - bits);
+}
+
+/**
+ * Motor de búsqueda de coincidencias basado en una tabla de hash de
+ * prefijos de 3 bytes y cadenas de posiciones anteriores.
+ * head[h] guarda la última posición con hash h y prev[] (un anillo del
+ * tamaño de la ventana) enlaza cada posición con la anterior de igual hash.
+ * Como solo se siguen candidatos dentro de la ventana, una entrada del
+ * anillo nunca se lee después de haber sido reutilizada.
+ *
+ * Las posiciones se guardan como (pos + 1) en 32 bits (0 = vacío) para
+ * reducir a la mitad la memoria de las tablas; la distancia se calcula en
+ * aritmética módulo 2^32, válida porque la ventana es mucho menor que 4 GiB.
+ * Las tablas se dimensionan según la entrada para no pagar su costo en
+ * archivos pequeños y son las del arena del hilo: entre archivos solo se
+ * limpian, sin volver a reservarse.
+ *
+ * Con diccionario, input es el diccionario seguido de los datos y start el
+ * inicio de los datos: las tablas propias solo registran posiciones desde
+ * start y, al agotar su cadena, la búsqueda sigue por el índice del
+ * diccionario (compartido y de solo lectura), así el costo por archivo no
+ * depende del tamaño del diccionario.
+ */
+class MatchFinder {
+public:
+    MatchFinder(ByteView input, size_t window, size_t max_len, int max_chain,
+                size_t start = 0, const Dictionary* dict = nullptr)
+        : data(input.data()), size(input.size()), window(window), max_len(max_len),
+          max_chain(max_chain < 1 ? 1 : max_chain), dict(dict), next_insert(start),
+          head(worker_arena().match_head), prev(worker_arena().match_prev) {
+        // El anillo debe cubrir toda la ventana sin pisar posiciones aún alcanzables;
+        // si la entrada es más corta que la ventana basta con cubrir la entrada
+        size_t needed = min(window, size - start);
+        ring = 1;
+        while (ring < needed) ring <<= 1;
+        prev.assign(ring, 0);
+
+        hash_bits = MIN_HASH_BITS;
+        while (hash_bits < HASH_BITS && (size_t(1) << hash_bits) < 2 * (size - start)) hash_bits++;
+        head.assign(size_t(1) << hash_bits, 0);
+    }
+
+    // Registra la posición pos en la tabla de hash
+    void insert(size_t pos) {
+        if (pos + MIN_MATCH > size) return;
+        uint32_t& slot = head[hash(pos)];
+        prev[pos & (ring - 1)] = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+    }
+
+    // Registra en orden todas las posiciones pendientes hasta end (exclusivo)
+    void insert_until(size_t end) {
+        for (; next_insert < end; ++next_insert) insert(next_insert);
+    }
+
+    // Omite posiciones sin registrarlas (los saltos de los niveles rápidos)
+    void skip_to(size_t pos) {
+        if (pos > next_insert) next_insert = pos;
+    }
+
+    /**
+     * Busca la coincidencia más larga para pos dentro de la ventana.
+     * @param offset Recibe la distancia hacia atrás de la coincidencia.
+     * @return Longitud de la coincidencia (0 si no hay).
+     */
+    size_t find(size_t pos, size_t& offset) const {
+        if (pos + MIN_MATCH > size) return 0;
+
+        size_t limit = min(size - pos, max_len);
+        size_t best_len = 0;
+        const unsigned char* cur = data + pos;
 
+        for_each_candidate(pos, [&](size_t cand, uint32_t dist) {
+            const unsigned char* ref = data + cand;
+            // Descarte rápido: el byte que mejoraría la coincidencia debe coincidir
+            if (ref[best_len] == cur[best_len] && ref[0] == cur[0]) {
+                size_t len = 0;
+                while (len < limit && ref[len] == cur[len]) len++;
+                if (len > best_len) {
+                    best_len = len;
+                    offset = dist;
+                    if (len == limit) return false;
+                }
+            }
+            return true;
+        });
+        return best_len >= MIN_MATCH ? best_len : 0;
+    }
+
+    /**
+     * Como find, pero guarda cada mejora de longitud encontrada en la cadena:
+     * matches queda ordenado por longitud creciente y, para cada longitud,
+     * con el offset más cercano (el más barato de codificar).
+     * @param stop Longitud a partir de la cual se deja de buscar.
+     */
+    void find_all(size_t pos, size_t stop, vector<pair<uint32_t, uint32_t>>& matches) const {
+        matches.clear();
+        if (pos + MIN_MATCH > size) return;
+
+        size_t limit = min(size - pos, max_len);
+        size_t best_len = MIN_MATCH - 1;
+        const unsigned char* cur = data + pos;
+
+        for_each_candidate(pos, [&](size_t cand, uint32_t dist) {
+            const unsigned char* ref = data + cand;
+            if (ref[best_len] == cur[best_len] && ref[0] == cur[0]) {
+                size_t len = 0;
+                while (len < limit && ref[len] == cur[len]) len++;
+                if (len > best_len) {
+                    best_len = len;
+                    matches.push_back({static_cast<uint32_t>(len), dist});
+                    if (len == limit || len >= stop) return false;
+                }
+            }
+            return true;
+        });
+    }
+
+private:
+    size_t hash(size_t pos) const {
+        return hash3(data + pos, hash_bits);
+    }
+
+    /**
+     * Recorre los candidatos de pos de más cercano a más lejano: primero la
+     * cadena propia y después la del diccionario, hasta max_chain en total.
+     * visit(cand, dist) devuelve false para terminar la búsqueda.
+     */
+    template <class Visit>
+    void for_each_candidate(size_t pos, Visit&& visit) const {
+        const uint32_t tag = static_cast<uint32_t>(pos + 1);
+        uint32_t stored = head[hash(pos)];
+        uint32_t last_dist = 0;
+        int depth = 0;
+        for (; depth < max_chain && stored != 0; ++depth) {
+            // Las distancias crecen a lo largo de la cadena; si no, la entrada es vieja
+            uint32_t dist = tag - stored;
+            if (dist <= last_dist || dist > window || dist > pos) return;
+            last_dist = dist;
+
+            size_t cand = pos - dist;
+            if (!visit(cand, dist)) return;
+            stored = prev[cand & (ring - 1)];
+        }
+        if (dict == nullptr || depth == max_chain) return;
+
+        // El índice del diccionario guarda (posición + 1) sin anillo: la cadena siempre retrocede
+        stored = dict->head[hash3(data + pos, dict->hash_bits)];
+        for (; depth < max_chain && stored != 0; ++depth) {
+            uint32_t dist = tag - stored;
+            if (dist > window) return;
+            size_t cand = stored - 1;
+            if (!visit(cand, dist)) return;
+            stored = dict->prev[cand];
+        }
+    }
+
+    const unsigned char* data;
+    size_t size;
+    size_t window;
+    size_t max_len;
+    int max_chain;
+    const Dictionary* dict;
+    size_t ring;
+    int hash_bits;
+    size_t next_insert;
+    vector<uint32_t>& head;
+    vector<uint32_t>& prev;
+};
+
+// =================================================================
+// UTILIDADES DEL FORMATO V2
+// =================================================================
+
+const unsigned char V2_MAGIC[3] = {'G', 'L', 'Z'};
+const size_t V2_HEADER_SIZE = 5;
+// Flag de cabecera: sigue el tamaño original (varint) tras la cabecera
+const unsigned char V2_FLAG_CONTENT_SIZE = 0x01;
+// Flag de cabecera: el cuerpo son los bytes originales sin comprimir
+const unsigned char V2_FLAG_STORED = 0x02;
+// Flag de cabecera: tras el tamaño original sigue el id del diccionario (4 bytes)
+const unsigned char V2_FLAG_DICT = 0x04;
+
+// Sonda de incompresibilidad: hasta PROBE_SAMPLES ventanas de PROBE_WINDOW
+// bytes repartidas uniformemente; entradas menores a PROBE_MIN_SIZE no se sondean
+const size_t PROBE_WINDOW = 4096;
+const size_t PROBE_SAMPLES = 16;
+const size_t PROBE_MIN_SIZE = 16384;
+// Umbrales: entropía de orden 0 (bits/byte) y fracción de posiciones con repetición
+const double PROBE_MIN_ENTROPY = 7.8;
+const double PROBE_MAX_MATCH_DENSITY = 0.02;
+
+// Una coincidencia conviene solo si es más corta que sus literales, contando
+// el byte extra que cuesta cortar una corrida de literales
+bool worth_match(size_t length, size_t offset) {
+    return length >= varint_size(length - LZ77_V2_MIN_MATCH) + varint_size(offset - 1) + 1;
+}
+
+// =================================================================
+// NIVELES DE COMPRESIÓN
+// =================================================================
+
+// Estrategias de búsqueda, de la más rápida a la que mejor comprime
+enum class Strategy {
+    Fast,    // Un solo candidato y registro parcial de las coincidencias
+    Greedy,  // Toma la coincidencia más larga de la posición actual
+    Lazy,    // Posterga una coincidencia si la siguiente posición tiene una mejor
+    Optimal  // Programación dinámica sobre todos los candidatos (costo en bits)
+};
+
+/**
+ * Parámetros de cada nivel. Se leen como constantes en tiempo de compilación
+ * (parse_level<Level>), así cada nivel es una instanciación propia sin
+ * ramas por estrategia dentro del bucle principal.
+ * - chain: candidatos revisados por posición (si no se fuerza con --chain).
+ * - skip_trigger: tras 2^skip_trigger posiciones seguidas sin coincidencia el
+ *   paso crece en 1 (datos incompresibles se recorren rápido).
+ * - lazy_steps: posiciones siguientes evaluadas antes de aceptar una coincidencia.
+ * - nice: longitud que se acepta de inmediato sin seguir buscando ni postergar.
+ */
+struct LevelParams {
+    Strategy strategy;
+    int chain;
+    int skip_trigger;
+    int lazy_steps;
+    size_t nice;
+};
+
+constexpr LevelParams LEVEL_PARAMS[LZ77_MAX_LEVEL + 1] = {
+    {Strategy::Greedy, 64, 5, 0, LZ77_V2_MAX_MATCH},  // 0: sin uso
+    {Strategy::Fast, 1, 3, 0, LZ77_V2_MAX_MATCH},
+    {Strategy::Fast, 2, 4, 0, LZ77_V2_MAX_MATCH},
+    {Strategy::Greedy, 8, 5, 0, LZ77_V2_MAX_MATCH},
+    {Strategy::Lazy, 8, 5, 1, 32},
+    {Strategy::Lazy, 16, 5, 1, 64},
+    {Strategy::Lazy, 32, 6, 2, 128},
+    {Strategy::Optimal, 16, 6, 0, 64},
+    {Strategy::Optimal, 32, 7, 0, 128},
+    {Strategy::Optimal, 128, 8, 0, 256},
+};
+
+// Posiciones resueltas por cada pasada de programación dinámica
+const size_t OPTIMAL_BLOCK = 4096;
+
+// Costo aproximado en bits de cada token v2 para el parseo óptimo: un literal
+// cuesta su byte más el flag y la cantidad si abre una corrida nueva; una
+// coincidencia, su flag y sus dos varint
+uint32_t literal_cost(bool opens_run) {
+    return opens_run ? 8 + 1 + 8 : 8;
+}
+
+uint32_t match_cost(size_t length, size_t offset) {
+    return 1 + 8 * static_cast<uint32_t>(varint_size(length - LZ77_V2_MIN_MATCH) + varint_size(offset - 1));
+}
+
+/**
+ * Escribe tokens v2 agrupando sus flags de a 8 en un byte de control.
+ */
+class TokenWriter {
+public:
+    explicit TokenWriter(FileData& out) : out(out) {}
+
+    void literals(const unsigned char* data, size_t count) {
+        next_flag(false);
+        put_varint(out, count - 1);
+        out.insert(out.end(), data, data + count);
+    }
+
+    void match(size_t length, size_t offset) {
+        next_flag(true);
+        put_varint(out, length - LZ77_V2_MIN_MATCH);
+        put_varint(out, offset - 1);
+    }
+
+private:
+    void next_flag(bool is_match) {
+        if (bit == 8) {
+            control_pos = out.size();
+            out.push_back(0);
+            bit = 0;
+        }
+        if (is_match) out[control_pos] |= static_cast<unsigned char>(1 << bit);
+        bit++;
+    }
+
+    FileData& out;
+    size_t control_pos = 0;
+    int bit = 8;
+};
+
+// Versión del flujo según su cabecera (0 si no tiene cabecera, es decir v1)
+unsigned char stream_version(ByteView input) {
+    if (input.size() >= V2_HEADER_SIZE && input[0] == V2_MAGIC[0] &&
+        input[1] == V2_MAGIC[1] && input[2] == V2_MAGIC[2]) {
+        return input[3];
+    }
+    return 0;
+}
+
+// Decodifica un flujo v1 (tokens de 2 y 4 bytes sin cabecera)
+FileData decompress_v1(ByteView input, size_t& input_pos) {
     FileData output;
-    size_t pos = 0;
+    while (input_pos < input.size()) {
+        unsigned char flag = input[input_pos++];
+        
+        if (flag == 0x00) {
+            // LITERAL: [Flag 0x00] [Byte Literal]
+            if (input_pos >= input.size()) throw runtime_error("Estructura de literal incompleta.");
+            output.push_back(input[input_pos++]);
+
+        } else if (flag == 0x01) {
+            // MATCH: [Flag 0x01] [Offset MSB] [Offset LSB] [Length]
+            if (input_pos + 2 >= input.size()) throw runtime_error("Estructura de match incompleta (Offset).");
+            
+            // Leer Offset (2 bytes)
+            size_t offset = (input[input_pos] << 8) | input[input_pos + 1];
+            input_pos += 2;
+            
+            if (input_pos >= input.size()) throw runtime_error("Estructura de match incompleta (Length).");
+            unsigned char length = input[input_pos++];
+
+            if (offset == 0 || length == 0) throw runtime_error("Match con Offset o Longitud cero.");
+
+            // Copiar bytes del buffer de salida (manejo de superposición)
+            size_t start_copy = output.size() - offset;
+
+            if (start_copy >= output.size()) throw runtime_error("Offset fuera de límites.");
+
+            for (size_t i = 0; i < length; ++i) {
+                // Copia secuencial para manejar la superposición
+                output.push_back(output[start_copy + i]);
+            }
+        } else {
+            throw runtime_error("Bandera de token desconocida.");
+        }
+    }
+    return output;
+}
+
+// Holgura al final del buffer de salida para las copias anchas
+const size_t WILD_COPY_SLACK = 32;
+
+/**
+ * Copia una coincidencia de length bytes desde op - offset hacia op.
+ * Con offset >= 16 copia bloques de 16 bytes y con offset >= 8 bloques de
+ * 8 bytes (cada bloque solo lee bytes ya escritos); patrones más cortos se
+ * copian byte a byte (offset 1 es una corrida y se resuelve con memset).
+ * Puede escribir hasta 15 bytes más allá de op + length (ver WILD_COPY_SLACK).
+ */
+inline void copy_match(unsigned char* op, size_t offset, size_t length) {
+    const unsigned char* src = op - offset;
+    unsigned char* end = op + length;
+    if (offset >= 16) {
+        while (op < end) {
+            memcpy(op, src, 16);
+            op += 16;
+            src += 16;
+        }
+    } else if (offset >= 8) {
+        while (op < end) {
+            memcpy(op, src, 8);
+            op += 8;
+            src += 8;
+        }
+    } else if (offset == 1) {
+        memset(op, *src, length);
+    } else {
+        while (op < end) *op++ = *src++;
+    }
+}
+
+/**
+ * Buffer del arena del hilo cuyos primeros bytes son el contenido del
+ * diccionario. El prefijo se copia una sola vez por diccionario; el llamador
+ * agrega sus datos detrás (entrada a comprimir o salida a decodificar) sin
+ * tocar el prefijo.
+ */
+FileData& dictionary_buffer(const Dictionary* dict) {
+    WorkerArena& arena = worker_arena();
+    // El id es un hash del contenido: alcanza para saber si el prefijo sigue siendo válido
+    if (arena.window_dict_size != dict->content.size() || arena.window_dict_id != dict->id) {
+        arena.window.assign(dict->content.begin(), dict->content.end());
+        arena.window_dict_id = dict->id;
+        arena.window_dict_size = dict->content.size();
+    }
+    arena.window.resize(arena.window_dict_size);
+    return arena.window;
+}
+
+/**
+ * Lee el id de diccionario de la cabecera y verifica que coincida con dict.
+ * @return Cantidad de bytes del diccionario que preceden a la salida.
+ */
+size_t read_dictionary_id(ByteView input, size_t& input_pos, const Dictionary* dict) {
+    if (input.size() - input_pos < 4) throw runtime_error("Id de diccionario incompleto.");
+    uint32_t id = get_u32(input.data() + input_pos);
+    input_pos += 4;
+    if (dict == nullptr || dict->id != id) {
+        char hex[9];
+        snprintf(hex, sizeof(hex), "%08x", id);
+        throw runtime_error(string("Se requiere el diccionario ") + hex + " (--dict).");
+    }
+    return dict->content.size();
+}
+
+/**
+ * Valida el tamaño original declarado en la cabecera antes de reservar la
+ * salida: viene del flujo, así que no puede desbordar la suma con el
+ * diccionario y la holgura ni superar lo que el flujo podría producir.
+ * @param content_size Tamaño declarado (sin el diccionario).
+ * @param base Bytes del diccionario que preceden a la salida.
+ * @param max_output Máximo que pueden producir los datos del flujo.
+ * @return Tamaño del buffer de salida sin la holgura (base + content_size).
+ */
+size_t checked_output_size(size_t content_size, size_t base, size_t max_output) {
+    if (content_size > SIZE_MAX - WILD_COPY_SLACK - base) throw runtime_error("Tamaño declarado fuera de rango.");
+    if (content_size > max_output) throw runtime_error("El tamaño declarado excede lo que el flujo puede producir.");
+    return base + content_size;
+}
+
+// Producto a * b saturado en SIZE_MAX
+inline size_t saturating_mul(size_t a, size_t b) {
+    return (b != 0 && a > SIZE_MAX / b) ? SIZE_MAX : a * b;
+}
+
+// Decodifica un flujo v2 (cabecera + grupos de flags) en result
+void decompress_v2(ByteView input, size_t& input_pos, const Dictionary* dict, FileData& result) {
+    unsigned char flags = input[4];
+    if (flags & ~(V2_FLAG_CONTENT_SIZE | V2_FLAG_STORED | V2_FLAG_DICT)) throw runtime_error("Flags de cabecera desconocidos.");
+    input_pos = V2_HEADER_SIZE;
+
+    // Con el tamaño original en la cabecera la salida se reserva una sola vez
+    bool known_size = flags & V2_FLAG_CONTENT_SIZE;
+    size_t content_size = known_size ? get_varint(input, input_pos) : input.size() * 2;
+
+    // Con diccionario la salida empieza con su contenido, así las referencias lo alcanzan
+    size_t base = 0;
+    if (flags & V2_FLAG_DICT) {
+        if (!known_size || (flags & V2_FLAG_STORED)) throw runtime_error("Cabecera con diccionario inválida.");
+        base = read_dictionary_id(input, input_pos, dict);
+    }
+
+    if (flags & V2_FLAG_STORED) {
+        // Bloque almacenado: el cuerpo es exactamente el contenido original
+        if (!known_size || content_size != input.size() - input_pos) {
+            throw runtime_error("Bloque almacenado con tamaño inconsistente.");
+        }
+        result.assign(input.begin() + input_pos, input.end());
+        input_pos = input.size();
+        return;
+    }
+
+    // Cada coincidencia ocupa al menos 2 bytes (dos varints) y produce a lo sumo LZ77_V2_MAX_MATCH
+    if (known_size) {
+        content_size = checked_output_size(content_size, base,
+                                           saturating_mul(input.size() - input_pos, LZ77_V2_MAX_MATCH / 2));
+    }
+
+    // Con diccionario se decodifica detrás de él en el buffer del hilo y se copia solo lo nuevo
+    FileData& output = base > 0 ? dictionary_buffer(dict) : result;
+    output.resize(content_size + WILD_COPY_SLACK);
+    size_t out_pos = base;
+
+    while (input_pos < input.size()) {
+        unsigned char control = input[input_pos++];
+
+        for (int bit = 0; bit < 8 && input_pos < input.size(); ++bit) {
+            size_t length;
+            size_t offset = 0;
+            bool is_match = control & (1 << bit);
+            if (is_match) {
+                // MATCH: [Longitud - MIN (varint)] [Offset - 1 (varint)]
+                length = get_varint(input, input_pos) + LZ77_V2_MIN_MATCH;
+                offset = get_varint(input, input_pos) + 1;
+                // Un varint de 2^64 - 1 da la vuelta: offset 0 copiaría la salida sobre sí misma
+                if (length < LZ77_V2_MIN_MATCH || length > LZ77_V2_MAX_MATCH) {
+                    throw runtime_error("Longitud de match fuera de rango.");
+                }
+                if (offset == 0 || offset > out_pos) throw runtime_error("Offset fuera de límites.");
+            } else {
+                // LITERALES: [Cantidad - 1 (varint)] [Bytes]
+                length = get_varint(input, input_pos) + 1;
+                if (length > input.size() - input_pos) throw runtime_error("Literales incompletos.");
+            }
+
+            // Un único control de límites por token
+            if (length > content_size - out_pos) {
+                if (known_size) throw runtime_error("La salida excede el tamaño declarado.");
+                content_size = max(content_size * 2, out_pos + length);
+                output.resize(content_size + WILD_COPY_SLACK);
+            }
+
+            if (is_match) {
+                copy_match(output.data() + out_pos, offset, length);
+            } else {
+                memcpy(output.data() + out_pos, input.data() + input_pos, length);
+                input_pos += length;
+            }
+            out_pos += length;
+        }
+    }
+
+    if (known_size && out_pos != content_size) throw runtime_error("La salida no coincide con el tamaño declarado.");
+    if (base > 0) {
+        result.assign(output.begin() + base, output.begin() + out_pos);
+    } else {
+        output.resize(out_pos);
+    }
+}
+
+/**
+ * Entrega a sink las corridas de literales y las coincidencias en orden.
+ */
+template <class Sink>
+class TokenEmitter {
+public:
+    TokenEmitter(ByteView input, Sink& sink, size_t start) : input(input), sink(sink), literal_start(start) {}
+
+    // Coincidencia en pos; los bytes desde el último token quedan como literales
+    void match(size_t pos, size_t length, size_t offset) {
+        if (pos > literal_start) sink.literals(input.data() + literal_start, pos - literal_start);
+        sink.match(length, offset);
+        literal_start = pos + length;
+    }
+
+    void finish() {
+        if (input.size() > literal_start) sink.literals(input.data() + literal_start, input.size() - literal_start);
+    }
+
+private:
+    ByteView input;
+    Sink& sink;
+    size_t literal_start;
+};
+
+// Estrategias rápida, voraz y perezosa: recorrido de una pasada desde start
+template <int Level, class Sink>
+void parse_single_pass(ByteView input, size_t start, MatchFinder& finder, TokenEmitter<Sink>& emit) {
+    constexpr LevelParams P = LEVEL_PARAMS[Level];
+    size_t pos = start;
+    size_t misses = 0;
+
+    auto best_at = [&](size_t at, size_t& offset) {
+        size_t length = finder.find(at, offset);
+        return (length > 0 && worth_match(length, offset)) ? length : 0;
+    };
 
     while (pos < input.size()) {
-        size_t best_match_len = 0;
-        size_t best_match_offset = 0;
+        finder.insert_until(pos);
+        size_t offset = 0;
+        size_t length = best_at(pos, offset);
 
-        // Definir la ventana de búsqueda y el buffer de búsqueda
-        size_t start_window = (pos < WINDOW_SIZE) ? 0 : pos - WINDOW_SIZE;
-        size_t lookahead_limit = min(input.size() - pos, (size_t)LOOKAHEAD_SIZE);
+        if (length == 0) {
+            // Sin coincidencia: las posiciones saltadas no se registran
+            finder.insert_until(pos + 1);
+            pos += 1 + (misses++ >> P.skip_trigger);
+            finder.skip_to(pos);
+            continue;
+        }
 
-        // Buscar la coincidencia más larga en la ventana
-        for (size_t i = start_window; i < pos; ++i) {
-            size_t current_match_len = 0;
-            size_t current_offset = pos - i;
+        if constexpr (P.strategy == Strategy::Lazy) {
+            // Si la posición siguiente ofrece una coincidencia más larga, la
+            // actual se emite como literal y se evalúa la siguiente
+            for (int step = 0; step < P.lazy_steps && length < P.nice; ++step) {
+                finder.insert_until(pos + 1);
+                size_t next_offset = 0;
+                size_t next_length = best_at(pos + 1, next_offset);
+                if (next_length <= length) break;
+                pos++;
+                length = next_length;
+                offset = next_offset;
+            }
+        }
+
+        emit.match(pos, length, offset);
+        if constexpr (P.strategy == Strategy::Fast) {
+            // Solo el inicio y el final de la coincidencia entran en la tabla
+            finder.insert_until(pos + 1);
+            finder.skip_to(pos + length - 2);
+        }
+        pos += length;
+        finder.insert_until(pos);
+        misses = 0;
+    }
+}
+
+/**
+ * Parseo casi óptimo: para cada bloque de OPTIMAL_BLOCK posiciones calcula
+ * con programación dinámica el camino de tokens de menor costo en bits,
+ * considerando todas las longitudes de cada candidato de la cadena. Una
+ * coincidencia de al menos P.nice bytes se acepta directamente (corta el
+ * bloque), lo que mantiene acotado el costo en datos muy repetitivos.
+ */
+template <int Level, class Sink>
+void parse_optimal(ByteView input, size_t start, MatchFinder& finder, TokenEmitter<Sink>& emit) {
+    constexpr LevelParams P = LEVEL_PARAMS[Level];
+    const uint32_t INF = UINT32_MAX;
+
+    // Para cada posición del bloque: costo mínimo y último token del camino
+    // (longitud 0 = literal)
+    vector<uint32_t> price(OPTIMAL_BLOCK + 1);
+    vector<uint32_t> from_length(OPTIMAL_BLOCK + 1);
+    vector<uint32_t> from_offset(OPTIMAL_BLOCK + 1);
+    vector<pair<uint32_t, uint32_t>> matches;
+    vector<size_t> path;
+    size_t pos = start;
+    // El bloque anterior terminó en coincidencia (o es el inicio): el primer
+    // literal abre una corrida
+    bool after_match = true;
+    // Como en las estrategias de una pasada, las zonas sin coincidencias se
+    // recorren con paso creciente (solo se evalúan como literales)
+    size_t misses = 0;
+    size_t next_search = 0;
 
-            // Comparar hasta el límite del buffer
-            while (current_match_len < lookahead_limit && input[i + current_match_len] == input[pos + current_match_len]) {
-                current_match_len++;
+    while (pos < input.size()) {
+        size_t count = min(OPTIMAL_BLOCK, input.size() - pos);
+        fill(price.begin(), price.begin() + count + 1, INF);
+        price[0] = 0;
+
+        size_t end = count;
+        size_t long_length = 0;
+        size_t long_offset = 0;
+        for (size_t i = 0; i < count; ++i) {
+            finder.insert_until(pos + i);
+
+            bool opens_run = i == 0 ? after_match : from_length[i] != 0;
+            uint32_t with_literal = price[i] + literal_cost(opens_run);
+            if (with_literal < price[i + 1]) {
+                price[i + 1] = with_literal;
+                from_length[i + 1] = 0;
+            }
+
+            if (pos + i < next_search) continue;
+            finder.find_all(pos + i, P.nice, matches);
+            if (matches.empty()) {
+                finder.insert_until(pos + i + 1);
+                next_search = pos + i + 1 + (misses++ >> P.skip_trigger);
+                finder.skip_to(next_search);
+                continue;
+            }
+            misses = 0;
+            if (matches.back().first >= P.nice) {
+                end = i;
+                long_length = matches.back().first;
+                long_offset = matches.back().second;
+                break;
             }
 
-            // Actualizar la mejor coincidencia
-            if (current_match_len > best_match_len) {
-                best_match_len = current_match_len;
-                best_match_offset = current_offset;
+            // Cada longitud entre la del candidato anterior y la del actual
+            // se alcanza con el offset del actual (el más cercano que la logra)
+            size_t shorter = LZ77_V2_MIN_MATCH - 1;
+            for (const auto& m : matches) {
+                size_t longest = min<size_t>(m.first, count - i);
+                for (size_t len = shorter + 1; len <= longest; ++len) {
+                    uint32_t cost = price[i] + match_cost(len, m.second);
+                    if (cost < price[i + len]) {
+                        price[i + len] = cost;
+                        from_length[i + len] = static_cast<uint32_t>(len);
+                        from_offset[i + len] = m.second;
+                    }
+                }
+                shorter = m.first;
             }
         }
 
-        // Si se encuentra una coincidencia significativa (longitud > 1)
-        if (best_match_len > 1) {
+        // Reconstruir el camino desde el final del bloque
+        path.clear();
+        for (size_t i = end; i > 0; i -= from_length[i] ? from_length[i] : 1) {
+            if (from_length[i]) path.push_back(i);
+        }
+        for (size_t k = path.size(); k-- > 0;) {
+            size_t length = from_length[path[k]];
+            emit.match(pos + path[k] - length, length, from_offset[path[k]]);
+        }
+        after_match = end == 0 ? after_match : from_length[end] != 0;
+        pos += end;
+
+        if (long_length > 0) {
+            emit.match(pos, long_length, long_offset);
+            pos += long_length;
+            after_match = true;
+        }
+    }
+}
+
+/**
+ * Recorre la entrada desde start con la estrategia del nivel Level y entrega
+ * los tokens a sink (formato v2 o LZ77+HUF). Los bytes anteriores a start
+ * son el diccionario: solo sirven como referencia.
+ */
+template <int Level, class Sink>
+void parse_level(ByteView input, size_t start, const Dictionary* dict, int max_chain, Sink& sink) {
+    constexpr LevelParams P = LEVEL_PARAMS[Level];
+    MatchFinder finder(input, LZ77_V2_WINDOW_SIZE, LZ77_V2_MAX_MATCH, max_chain > 0 ? max_chain : P.chain,
+                       start, dict);
+    TokenEmitter<Sink> emit(input, sink, start);
+
+    if constexpr (P.strategy == Strategy::Optimal) {
+        parse_optimal<Level>(input, start, finder, emit);
+    } else {
+        parse_single_pass<Level>(input, start, finder, emit);
+    }
+    emit.finish();
+}
+
+// Elige la instanciación del nivel pedido
+template <class Sink>
+void parse_lz77(ByteView input, size_t start, const Dictionary* dict, int level, int max_chain, Sink& sink) {
+    switch (level) {
+        case 1: parse_level<1>(input, start, dict, max_chain, sink); break;
+        case 2: parse_level<2>(input, start, dict, max_chain, sink); break;
+        case 3: parse_level<3>(input, start, dict, max_chain, sink); break;
+        case 4: parse_level<4>(input, start, dict, max_chain, sink); break;
+        case 6: parse_level<6>(input, start, dict, max_chain, sink); break;
+        case 7: parse_level<7>(input, start, dict, max_chain, sink); break;
+        case 8: parse_level<8>(input, start, dict, max_chain, sink); break;
+        case 9: parse_level<9>(input, start, dict, max_chain, sink); break;
+        // Nivel 5 (predeterminado) y valores fuera de rango
+        default: parse_level<LZ77_DEFAULT_LEVEL>(input, start, dict, max_chain, sink); break;
+    }
+}
+
+/**
+ * Prepara la entrada para parse_lz77: sin diccionario (o si la entrada supera
+ * la ventana) se usa tal cual; si no, se copia detrás del diccionario en un
+ * buffer del hilo que conserva el diccionario entre llamadas.
+ * @param start Recibe la posición donde empiezan los datos.
+ * @return Diccionario a usar (nulo si no se usa).
+ */
+const Dictionary* with_dictionary(ByteView input, const Dictionary* dict, ByteView& joined_view, size_t& start) {
+    joined_view = input;
+    start = 0;
+    if (dict == nullptr || dict->content.empty() || input.size() > LZ77_V2_WINDOW_SIZE) return nullptr;
+
+    FileData& joined = dictionary_buffer(dict);
+    joined.insert(joined.end(), input.begin(), input.end());
+    joined_view = joined;
+    start = dict->content.size();
+    return dict;
+}
+
+/**
+ * Acumula las secuencias y los literales para la etapa de entropía.
+ */
+class SequenceCollector {
+public:
+    // Los vectores son los del arena del hilo: se limpian sin liberar su capacidad
+    SequenceCollector() : sequences(worker_arena().sequences), literal_data(worker_arena().literals) {
+        sequences.clear();
+        literal_data.clear();
+    }
+
+    void literals(const unsigned char* data, size_t count) {
+        literal_data.insert(literal_data.end(), data, data + count);
+        pending_run += count;
+        // Las corridas muy largas se dividen en secuencias sin coincidencia
+        while (pending_run > HUF_MAX_LITERAL_RUN) {
+            sequences.push_back({HUF_MAX_LITERAL_RUN, 0, 0});
+            pending_run -= HUF_MAX_LITERAL_RUN;
+        }
+    }
+
+    void match(size_t length, size_t offset) {
+        sequences.push_back({static_cast<uint32_t>(pending_run), static_cast<uint32_t>(length), static_cast<uint32_t>(offset)});
+        pending_run = 0;
+    }
+
+    void finish() {
+        if (pending_run > 0) sequences.push_back({static_cast<uint32_t>(pending_run), 0, 0});
+        pending_run = 0;
+    }
+
+    vector<Lz77Sequence>& sequences;
+    FileData& literal_data;
+
+private:
+    size_t pending_run = 0;
+};
+
+// Cabecera común de v2 y LZ77+HUF: ["GLZ"] [Versión] [Flags] [Tamaño original (varint)] [Id de diccionario (4)]
+void write_header(FileData& out, unsigned char version, size_t content_size, const Dictionary* dict) {
+    out.insert(out.end(), V2_MAGIC, V2_MAGIC + 3);
+    out.push_back(version);
+    out.push_back(dict ? V2_FLAG_CONTENT_SIZE | V2_FLAG_DICT : V2_FLAG_CONTENT_SIZE);
+    put_varint(out, content_size);
+    if (dict) put_u32(out, dict->id);
+}
+
+// Decodifica un flujo LZ77+HUF en result: flujos de entropía y luego ejecución de las secuencias
+void decompress_huf(ByteView input, size_t& input_pos, const Dictionary* dict, FileData& result) {
+    unsigned char flags = input[4];
+    if (flags != V2_FLAG_CONTENT_SIZE && flags != (V2_FLAG_CONTENT_SIZE | V2_FLAG_DICT)) {
+        throw runtime_error("Flags de cabecera inválidos.");
+    }
+    input_pos = V2_HEADER_SIZE;
+    size_t content_size = get_varint(input, input_pos);
+    size_t base = (flags & V2_FLAG_DICT) ? read_dictionary_id(input, input_pos, dict) : 0;
+
+    vector<Lz77Sequence>& sequences = worker_arena().sequences;
+    FileData& literals = worker_arena().literals;
+    decode_sequences_huf(input, input_pos, sequences, literals);
+
+    // Cada secuencia produce a lo sumo su corrida de literales más LZ77_V2_MAX_MATCH
+    content_size = checked_output_size(content_size, base,
+                                       literals.size() + saturating_mul(sequences.size(), LZ77_V2_MAX_MATCH));
+
+    // Con diccionario se decodifica detrás de él en el buffer del hilo y se copia solo lo nuevo
+    FileData& output = base > 0 ? dictionary_buffer(dict) : result;
+    output.resize(content_size + WILD_COPY_SLACK);
+    size_t out_pos = base;
+    size_t literal_pos = 0;
+    for (const Lz77Sequence& s : sequences) {
+        if (s.literal_run > literals.size() - literal_pos || s.literal_run > content_size - out_pos) {
+            throw runtime_error("Corrida de literales fuera de límites.");
+        }
+        memcpy(output.data() + out_pos, literals.data() + literal_pos, s.literal_run);
+        out_pos += s.literal_run;
+        literal_pos += s.literal_run;
+
+        if (s.match_length) {
+            if (s.offset == 0 || s.offset > out_pos || s.match_length > content_size - out_pos) {
+                throw runtime_error("Coincidencia fuera de límites.");
+            }
+            copy_match(output.data() + out_pos, s.offset, s.match_length);
+            out_pos += s.match_length;
+        }
+    }
+
+    if (out_pos != content_size) throw runtime_error("La salida no coincide con el tamaño declarado.");
+    if (base > 0) {
+        result.assign(output.begin() + base, output.begin() + out_pos);
+    } else {
+        output.resize(out_pos);
+    }
+}
+
+} // namespace
+
+// =================================================================
+// DICCIONARIO
+// =================================================================
+
+shared_ptr<const Dictionary> make_dictionary(FileData content) {
+    auto dict = make_shared<Dictionary>();
+    dict->content = move(content);
+    dict->id = static_cast<uint32_t>(hash64(dict->content));
+
+    // Mismo hash que el buscador; las cadenas enlazan cada posición con la anterior de igual prefijo
+    size_t size = dict->content.size();
+    dict->hash_bits = MIN_HASH_BITS;
+    while (dict->hash_bits < HASH_BITS && (size_t(1) << dict->hash_bits) < 2 * size) dict->hash_bits++;
+    dict->head.assign(size_t(1) << dict->hash_bits, 0);
+    dict->prev.assign(size, 0);
+    for (size_t pos = 0; pos + MIN_MATCH <= size; ++pos) {
+        uint32_t& slot = dict->head[hash3(dict->content.data() + pos, dict->hash_bits)];
+        dict->prev[pos] = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+    }
+    return dict;
+}
+
+// =================================================================
+// COMPRESIÓN
+// =================================================================
+
+FileData compress_lz77_v1(ByteView input, int max_chain) {
+    if (input.empty()) return {};
+
+    FileData output;
+    output.reserve(input.size() + input.size() / 2);
+    MatchFinder finder(input, WINDOW_SIZE, LOOKAHEAD_SIZE, max_chain);
+    size_t pos = 0;
+
+    while (pos < input.size()) {
+        size_t best_match_offset = 0;
+        size_t best_match_len = finder.find(pos, best_match_offset);
+
+        // Si se encuentra una coincidencia significativa (longitud >= MIN_MATCH)
+        if (best_match_len > 0) {
             // MATCH Token (4 bytes): [Flag 0x01] [Offset MSB] [Offset LSB] [Length]
             output.push_back(0x01); // Flag de coincidencia
 
@@ -48,63 +919,180 @@ FileData compress_lz77(const FileData& input) {
             // Longitud de 1 byte
             output.push_back(static_cast<unsigned char>(best_match_len));
 
+            // Registrar todas las posiciones cubiertas por la coincidencia
+            for (size_t i = 0; i < best_match_len; ++i) {
+                finder.insert(pos + i);
+            }
             pos += best_match_len; // Avanzar la posición por la longitud de la coincidencia
         } else {
             // LITERAL Token (2 bytes): [Flag 0x00] [Byte Literal]
             output.push_back(0x00); // Flag literal
             output.push_back(input[pos]); // Byte literal
 
+            finder.insert(pos);
             pos++; // Avanzar la posición por 1 (el byte literal)
         }
     }
     return output;
 }
 
-FileData decompress_lz77(const FileData& input) {
-    if (input.empty()) return {};
+// Escribe en output el flujo v2 de una entrada no vacía (output conserva su capacidad)
+static void lz77_into(ByteView input, int level, int max_chain, const Dictionary* dict, FileData& output) {
+    ByteView joined;
+    size_t start;
+    dict = with_dictionary(input, dict, joined, start);
+
+    output.clear();
+    output.reserve(input.size() + input.size() / 64 + 16);
+    write_header(output, LZ77_V2_VERSION, input.size(), dict);
+
+    TokenWriter writer(output);
+    parse_lz77(joined, start, dict, level, max_chain, writer);
+}
+
+// Escribe en output el flujo LZ77+HUF de una entrada no vacía
+static void lz77_huf_into(ByteView input, int level, int max_chain, const Dictionary* dict, FileData& output) {
+    ByteView joined;
+    size_t start;
+    dict = with_dictionary(input, dict, joined, start);
 
+    SequenceCollector collector;
+    parse_lz77(joined, start, dict, level, max_chain, collector);
+    collector.finish();
+
+    output.clear();
+    output.reserve(input.size() / 2 + 64);
+    write_header(output, LZ77_HUF_VERSION, input.size(), dict);
+    encode_sequences_huf(collector.sequences, collector.literal_data, output);
+}
+
+// Escribe en output el flujo almacenado (flag 0x02) de una entrada no vacía
+static void store_into(ByteView input, FileData& output) {
+    output.clear();
+    output.reserve(V2_HEADER_SIZE + varint_size(input.size()) + input.size());
+    output.insert(output.end(), V2_MAGIC, V2_MAGIC + 3);
+    output.push_back(LZ77_V2_VERSION);
+    output.push_back(V2_FLAG_CONTENT_SIZE | V2_FLAG_STORED);
+    put_varint(output, input.size());
+    output.insert(output.end(), input.begin(), input.end());
+}
+
+FileData compress_lz77(ByteView input, int level, int max_chain, const Dictionary* dict) {
     FileData output;
-    size_t input_pos = 0;
+    if (!input.empty()) lz77_into(input, level, max_chain, dict, output);
+    return output;
+}
+
+FileData compress_lz77_huf(ByteView input, int level, int max_chain, const Dictionary* dict) {
+    FileData output;
+    if (!input.empty()) lz77_huf_into(input, level, max_chain, dict, output);
+    return output;
+}
+
+bool looks_incompressible(ByteView input) {
+    if (input.size() < PROBE_MIN_SIZE) return false;
+
+    size_t samples = min(PROBE_SAMPLES, input.size() / PROBE_WINDOW);
+    size_t stride = input.size() / samples;
+    size_t histogram[256] = {0};
+    size_t repeats = 0;
+    size_t positions = 0;
+    // Última posición vista de cada hash de 4 bytes (se reinicia por ventana)
+    uint16_t last[1 << 12];
+
+    for (size_t s = 0; s < samples; ++s) {
+        const unsigned char* window = input.data() + s * stride;
+        memset(last, 0, sizeof(last));
+        for (size_t i = 0; i < PROBE_WINDOW; ++i) histogram[window[i]]++;
+        for (size_t i = 0; i + 4 <= PROBE_WINDOW; ++i) {
+            uint32_t v;
+            memcpy(&v, window + i, 4);
+            uint16_t& slot = last[(v * 2654435761u) >> 20];
+            // slot guarda (posición + 1); 0 = vacío
+            if (slot != 0 && memcmp(window + slot - 1, window + i, 4) == 0) repeats++;
+            slot = static_cast<uint16_t>(i + 1);
+            positions++;
+        }
+    }
+
+    double total = static_cast<double>(samples * PROBE_WINDOW);
+    double entropy = 0;
+    for (size_t count : histogram) {
+        if (count == 0) continue;
+        double p = count / total;
+        entropy -= p * log2(p);
+    }
+    return entropy >= PROBE_MIN_ENTROPY && repeats < PROBE_MAX_MATCH_DENSITY * positions;
+}
+
+FileData store_lz77(ByteView input) {
+    FileData output;
+    if (!input.empty()) store_into(input, output);
+    return output;
+}
+
+size_t max_compressed_size(size_t input_size) {
+    return V2_HEADER_SIZE + varint_size(input_size) + input_size;
+}
+
+void compress_into(ByteView input, const Config& config, FileData& output, bool* stored) {
+    output.clear();
+    if (stored) *stored = false;
+    if (input.empty()) return;
 
+    // La sonda evita recorrer entradas ya comprimidas o encriptadas
+    bool store = looks_incompressible(input);
+    if (!store) {
+        const Dictionary* dict = config.dictionary.get();
+        if (config.comp_alg == COMP_ALG_LZ77_HUF) {
+            lz77_huf_into(input, config.level, config.chain_depth, dict, output);
+        } else {
+            lz77_into(input, config.level, config.chain_depth, dict, output);
+        }
+        // Si la sonda no lo detectó pero el resultado crece, se almacena igual
+        store = output.size() > max_compressed_size(input.size());
+    }
+    if (store) store_into(input, output);
+    if (stored) *stored = store;
+}
+
+FileData compress_selected(ByteView input, const Config& config, bool* stored) {
+    FileData output;
+    compress_into(input, config, output, stored);
+    return output;
+}
+
+// =================================================================
+// DESCOMPRESIÓN
+// =================================================================
+
+bool decompress_lz77_into(ByteView input, const Dictionary* dict, FileData& output) {
+    output.clear();
+    if (input.empty()) return false;
+
+    size_t input_pos = 0;
     try {
-        while (input_pos < input.size()) {
-            unsigned char flag = input[input_pos++];
-            
-            if (flag == 0x00) {
-                // LITERAL: [Flag 0x00] [Byte Literal]
-                if (input_pos >= input.size()) throw runtime_error("Estructura de literal incompleta.");
-                output.push_back(input[input_pos++]);
-
-            } else if (flag == 0x01) {
-                // MATCH: [Flag 0x01] [Offset MSB] [Offset LSB] [Length]
-                if (input_pos + 2 >= input.size()) throw runtime_error("Estructura de match incompleta (Offset).");
-                
-                // Leer Offset (2 bytes)
-                size_t offset = (input[input_pos] << 8) | input[input_pos + 1];
-                input_pos += 2;
-                
-                if (input_pos >= input.size()) throw runtime_error("Estructura de match incompleta (Length).");
-                unsigned char length = input[input_pos++];
-
-                if (offset == 0 || length == 0) throw runtime_error("Match con Offset o Longitud cero.");
-
-                // Copiar bytes del buffer de salida (manejo de superposición)
-                size_t start_copy = output.size() - offset;
-
-                if (start_copy >= output.size()) throw runtime_error("Offset fuera de límites.");
-
-                for (size_t i = 0; i < length; ++i) {
-                    // Copia secuencial para manejar la superposición
-                    output.push_back(output[start_copy + i]);
-                }
-            } else {
-                throw runtime_error("Bandera de token desconocida.");
-            }
+        // Los flujos v1 comienzan con una bandera 0x00/0x01, nunca con la cabecera "GLZ"
+        switch (stream_version(input)) {
+            case 0: output = decompress_v1(input, input_pos); break;
+            case LZ77_V2_VERSION: decompress_v2(input, input_pos, dict, output); break;
+            case LZ77_HUF_VERSION: decompress_huf(input, input_pos, dict, output); break;
+            default: throw runtime_error("Versión de formato desconocida.");
         }
     } catch (const runtime_error& e) {
         cerr << "ERROR LZ77 DECOMPRESSION: Falló en la posición " << input_pos << ": " << e.what() << endl;
-        return {};
+        output.clear();
+        return false;
+    } catch (const bad_alloc&) {
+        cerr << "ERROR LZ77 DECOMPRESSION: Tamaño declarado demasiado grande." << endl;
+        output.clear();
+        return false;
     }
+    return !output.empty();
+}
 
+FileData decompress_lz77(ByteView input, const Dictionary* dict) {
+    FileData output;
+    decompress_lz77_into(input, dict, output);
     return output;
-}
\ No newline at end of file
+}
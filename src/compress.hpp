@@ -1,20 +1,145 @@
 #pragma once
 
 #include "constantes.hpp"
+#include <memory>
 
 /**
- * Comprime los datos usando el algoritmo LZ77.
+ * Diccionario compartido para archivos pequeños y parecidos: su contenido
+ * precede a cada entrada en la ventana, así las primeras coincidencias ya
+ * tienen contra qué compararse. El índice de prefijos de 3 bytes se construye
+ * una sola vez (make_dictionary) y lo comparten todos los hilos en lectura.
+ */
+struct Dictionary {
+    uint32_t id = 0;            // Identificador guardado en cada flujo comprimido
+    FileData content;           // Bytes del diccionario (lo más frecuente al final)
+    int hash_bits = 0;          // Bits del índice
+    std::vector<uint32_t> head; // Última posición + 1 de cada hash
+    std::vector<uint32_t> prev; // Posición anterior + 1 con el mismo hash (0 = fin)
+};
+
+/**
+ * Crea un diccionario: calcula su id (hash del contenido) y su índice.
+ * @param content Bytes del diccionario (hasta DICT_MAX_KB KiB).
+ * @return Diccionario listo para compartir entre hilos.
+ */
+std::shared_ptr<const Dictionary> make_dictionary(FileData content);
+
+/**
+ * Comprime los datos usando el algoritmo LZ77 (formato v2).
+ * Formato:
+ * - Cabecera (5 bytes): ["GLZ"] [Versión 2] [Flags], seguida del tamaño
+ *   original (varint) si el flag 0x01 está activo (siempre en archivos nuevos)
+ *   y del id del diccionario (4 bytes) si el flag 0x04 está activo
+ * - Grupos: [Byte de control] seguido de hasta 8 tokens; el bit i (LSB primero)
+ *   indica si el token i es una coincidencia (1) o una corrida de literales (0).
+ * - Corrida de literales: [Cantidad - 1 (varint)] [Bytes]
+ * - Coincidencia: [Longitud - 3 (varint)] [Offset - 1 (varint)], offset hasta 1 MiB
+ * Los varint usan 7 bits por byte (LSB primero, bit alto = continúa).
+ * Las coincidencias se buscan con una tabla de hash de prefijos de 3 bytes
+ * encadenada, por lo que el costo depende de los datos y no del tamaño de la ventana.
+ * El nivel elige la estrategia: 1-2 un solo candidato por posición, 3 voraz,
+ * 4-6 evaluación perezosa y 7-9 parseo casi óptimo por costo en bits.
+ * Todos los niveles producen el mismo formato.
+ * @param input Datos binarios a comprimir.
+ * @param level Nivel de compresión (LZ77_MIN_LEVEL a LZ77_MAX_LEVEL).
+ * @param max_chain Máximo de candidatos revisados por posición; 0 usa el del nivel.
+ * @param dict Diccionario precargado en la ventana (solo en entradas de hasta 1 MiB).
+ * @return Datos comprimidos.
+ */
+FileData compress_lz77(ByteView input, int level = LZ77_DEFAULT_LEVEL, int max_chain = 0,
+                       const Dictionary* dict = nullptr);
+
+/**
+ * Comprime con LZ77 y luego codifica las secuencias con Huffman (LZ77+HUF).
+ * Mismo encabezado que v2 con versión 3; el cuerpo son cuatro flujos Huffman
+ * independientes (literales, corridas, longitudes y offsets), ver entropy.hpp.
+ * @param input Datos binarios a comprimir.
+ * @param level Nivel de compresión (LZ77_MIN_LEVEL a LZ77_MAX_LEVEL).
+ * @param max_chain Máximo de candidatos revisados por posición; 0 usa el del nivel.
+ * @param dict Diccionario precargado en la ventana (solo en entradas de hasta 1 MiB).
+ * @return Datos comprimidos.
+ */
+FileData compress_lz77_huf(ByteView input, int level = LZ77_DEFAULT_LEVEL, int max_chain = 0,
+                           const Dictionary* dict = nullptr);
+
+/**
+ * Estima, sobre ventanas muestreadas de la entrada, si vale la pena
+ * comprimirla: se considera incompresible si la entropía de orden 0 es
+ * casi 8 bits/byte y casi no hay secuencias de 4 bytes repetidas
+ * (JPEG, ZIP, datos encriptados). El costo no depende del tamaño de la entrada.
+ * @param input Datos a inspeccionar.
+ * @return true si conviene almacenarla sin comprimir.
+ */
+bool looks_incompressible(ByteView input);
+
+/**
+ * Almacena los datos sin comprimir en un flujo v2 con el flag 0x02
+ * (cabecera + tamaño original + bytes). decompress_lz77 lo restaura.
+ * @param input Datos originales.
+ * @return Flujo almacenado.
+ */
+FileData store_lz77(ByteView input);
+
+/**
+ * Tamaño máximo de la salida de compress_selected para una entrada de
+ * input_size bytes: si comprimir la haría crecer, se almacena.
+ */
+size_t max_compressed_size(size_t input_size);
+
+// Decisiones comprimir/almacenar tomadas para un archivo (por bloque o fragmento)
+struct StoreReport {
+    size_t compressed = 0; // Bloques comprimidos
+    size_t stored = 0;     // Bloques almacenados sin comprimir
+};
+
+/**
+ * Comprime con el algoritmo elegido en config.comp_alg (LZ77 o LZ77+HUF),
+ * con el nivel y la profundidad de cadena de config. Si la sonda detecta
+ * datos incompresibles, o si el resultado sería mayor que la entrada, los
+ * datos se almacenan sin comprimir (store_lz77).
+ * @param input Datos binarios a comprimir.
+ * @param config Parámetros de la operación.
+ * @param stored Si no es nulo, recibe true cuando se almacenó sin comprimir.
+ * @return Datos comprimidos o almacenados.
+ */
+FileData compress_selected(ByteView input, const Config& config, bool* stored = nullptr);
+
+/**
+ * Como compress_selected, pero escribe en output reutilizando su capacidad:
+ * con un buffer que ya creció (el arena del hilo) no se reserva memoria.
+ * @param input Datos binarios a comprimir.
+ * @param config Parámetros de la operación.
+ * @param output Recibe los datos comprimidos o almacenados (vacío si input lo está).
+ * @param stored Si no es nulo, recibe true cuando se almacenó sin comprimir.
+ */
+void compress_into(ByteView input, const Config& config, FileData& output, bool* stored = nullptr);
+
+/**
+ * Comprime los datos en el formato LZ77 v1 (heredado, sin cabecera).
  * Formato de Token:
  * - Literal (2 bytes): [Flag 0x00] [Byte Literal]
  * - Coincidencia (4 bytes): [Flag 0x01] [Offset (2 bytes)] [Longitud (1 byte)]
  * @param input Datos binarios a comprimir.
+ * @param max_chain Máximo de candidatos revisados por posición.
  * @return Datos comprimidos.
  */
-FileData compress_lz77(const FileData& input);
+FileData compress_lz77_v1(ByteView input, int max_chain = LZ77_DEFAULT_CHAIN);
 
 /**
- * Descomprime los datos comprimidos con LZ77.
+ * Descomprime los datos comprimidos con LZ77 (detecta v1, v2 o LZ77+HUF por la cabecera).
+ * En v2 la salida se reserva una vez con el tamaño de la cabecera y las
+ * coincidencias se copian en bloques de 8/16 bytes.
  * @param input Datos binarios comprimidos.
+ * @param dict Diccionario con el que se comprimió (obligatorio si la cabecera tiene un id).
  * @return Datos descomprimidos o vacío en caso de error.
  */
-FileData decompress_lz77(const FileData& input);
+FileData decompress_lz77(ByteView input, const Dictionary* dict = nullptr);
+
+/**
+ * Como decompress_lz77, pero escribe en output reutilizando su capacidad.
+ * @param input Datos binarios comprimidos.
+ * @param dict Diccionario con el que se comprimió (obligatorio si la cabecera tiene un id).
+ * @param output Recibe los datos descomprimidos (vacío en caso de error).
+ * @return true si la descompresión terminó bien.
+ */
+bool decompress_lz77_into(ByteView input, const Dictionary* dict, FileData& output);
@@ -2,17 +2,88 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
 
 // Tipo para datos de archivo (byte sin signo)
 using FileData = std::vector<unsigned char>;
 
+// Vista de solo lectura sobre un rango de bytes (equivalente a std::span<const unsigned char>).
+// Permite que las etapas lean directamente de un archivo mapeado sin copiarlo.
+class ByteView {
+public:
+    ByteView() = default;
+    ByteView(const unsigned char* data, size_t size) : ptr(data), len(size) {}
+    ByteView(const FileData& data) : ptr(data.data()), len(data.size()) {}
+
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const unsigned char* begin() const { return ptr; }
+    const unsigned char* end() const { return ptr + len; }
+    const unsigned char& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    const unsigned char* ptr = nullptr;
+    size_t len = 0;
+};
+
 // Definiciones de algoritmos soportados
 const std::string COMP_ALG_LZ77 = "LZ77";
+const std::string COMP_ALG_LZ77_HUF = "LZ77+HUF"; // LZ77 seguido de codificación Huffman
 const std::string ENC_ALG_VIGENERE = "Vigenere";
+const std::string ENC_ALG_CHACHA20 = "ChaCha20"; // Cifrado de flujo en modo contador (clave derivada con SHA-256)
 
-// Constantes para LZ77
+// Constantes para LZ77 v1 (formato heredado)
 const int WINDOW_SIZE = 1024; // Tamaño máximo de la ventana de búsqueda
 const int LOOKAHEAD_SIZE = 255; // Tamaño máximo de la coincidencia (limitado por 1 byte de longitud)
+const int LZ77_DEFAULT_CHAIN = 64; // Candidatos revisados por posición en la cadena de hash (v1)
+
+// Constantes para LZ77 v2
+const unsigned char LZ77_V2_VERSION = 2;
+const size_t LZ77_V2_WINDOW_SIZE = size_t(1) << 20; // Ventana de 1 MiB
+const size_t LZ77_V2_MIN_MATCH = 3;
+const size_t LZ77_V2_MAX_MATCH = 65536;
+const unsigned char LZ77_HUF_VERSION = 3; // Mismo encabezado que v2, cuerpo con entropía
+
+// Niveles de compresión (-1 rápido ... -9 mejor relación)
+const int LZ77_MIN_LEVEL = 1;
+const int LZ77_MAX_LEVEL = 9;
+const int LZ77_DEFAULT_LEVEL = 5;
+
+// Constantes para el modo por bloques (tamaños en MiB)
+const int BLOCK_SIZE_MIN_MB = 1;
+const int BLOCK_SIZE_MAX_MB = 256;
+
+// Tamaño predeterminado de fragmento en modo streaming (MiB)
+const int STREAM_CHUNK_MB = 1;
+
+// Tamaño predeterminado de los bloques sólidos del modo archivo (MiB)
+const int ARCHIVE_BLOCK_MB = 4;
+
+// Límite predeterminado de bytes de entrada en vuelo en modo directorio (MiB)
+const int DEFAULT_MAX_INFLIGHT_MB = 1024;
+
+// Operaciones de E/S en vuelo predeterminadas del backend io_uring
+const int DEFAULT_QUEUE_DEPTH = 64;
+
+// Archivos de hasta este tamaño se leen en el arena del hilo en lugar de mapearse (KiB)
+const int SMALL_FILE_READ_KB = 64;
+
+// Memoria de trabajo que un hilo conserva entre archivos (MiB); lo que la supera se libera
+const int ARENA_KEEP_MB = 64;
+
+// Largo máximo de una línea de trabajo recibida por el socket del servicio (bytes)
+const size_t JOB_LINE_MAX = 64 << 10;
+
+// Tamaño de los diccionarios entrenados con --train-dict (KiB)
+const int DICT_MIN_KB = 1;
+const int DICT_MAX_KB = 512;
+const int DICT_DEFAULT_KB = 64;
+
+// Diccionario compartido de compresión (ver compress.hpp)
+struct Dictionary;
 
 // Estructura para contener los parámetros de la operación
 struct Config {
@@ -25,4 +96,30 @@ struct Config {
     std::string key;
     std::string comp_alg = COMP_ALG_LZ77;
     std::string enc_alg = ENC_ALG_VIGENERE;
+    int level = LZ77_DEFAULT_LEVEL; // Nivel de compresión (1-9)
+    int chain_depth = 0; // Profundidad de la cadena de hash; 0 usa la del nivel
+    size_t block_size = 0; // Bytes por bloque; 0 desactiva el modo por bloques
+    bool stream = false; // Pipeline por fragmentos con memoria acotada (-i - / -o -)
+    bool recursive = false; // Recorrer subdirectorios en modo directorio (-r)
+    bool archive = false; // Empaquetar el directorio en un único archivo sólido (--archive)
+    std::string member; // Miembro a extraer de un archivo sólido (--member); vacío = todos
+    uint64_t range_offset = 0; // Inicio del rango a extraer (--range offset:len)
+    uint64_t range_length = 0; // Bytes del rango; 0 = contenido completo
+    bool dedup = false; // Deduplicar fragmentos entre archivos en modo directorio (--dedup)
+    bool incremental = false; // Omitir archivos sin cambios según el manifiesto de la salida (--incremental)
+    bool prune = false; // Con --incremental, eliminar las salidas de entradas borradas (--prune)
+    bool quiet = false; // Sin mensajes de progreso por archivo (--quiet); los errores se siguen mostrando
+    std::string stats_path; // Resumen de métricas por etapa (--stats); vacío = desactivado
+    bool io_uring = false; // E/S asíncrona con io_uring en modo directorio (--io-uring)
+    unsigned queue_depth = DEFAULT_QUEUE_DEPTH; // Operaciones de E/S en vuelo con io_uring (--queue-depth)
+    bool train_dict = false; // Entrenar un diccionario con el directorio de entrada y guardarlo en -o (--train-dict)
+    size_t dict_size = static_cast<size_t>(DICT_DEFAULT_KB) << 10; // Tamaño del diccionario a entrenar (--dict-size)
+    std::string dict_path; // Ruta del diccionario (--dict); vacío = sin diccionario
+    std::shared_ptr<const Dictionary> dictionary; // Diccionario cargado de dict_path; nulo = sin diccionario
+    unsigned threads = 0; // Hilos de trabajo; 0 usa hardware_concurrency
+    size_t max_inflight = static_cast<size_t>(DEFAULT_MAX_INFLIGHT_MB) << 20; // Bytes de entrada en vuelo; 0 = sin límite
+    std::string batch_path; // Manifiesto de trabajos a ejecutar en lote (--batch); "-" = entrada estándar
+    std::string daemon_socket; // Socket Unix en el que el servicio recibe trabajos (--daemon)
+    std::string client_socket; // Socket Unix del servicio al que se envían trabajos (--client)
+    bool shutdown_daemon = false; // Con --client, pedir al servicio que termine (--shutdown)
 };
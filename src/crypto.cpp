@@ -1,49 +1,686 @@
 #include "crypto.hpp"
+#include "hash.hpp"
+#include "thread_pool.hpp"
+#include <iostream>
+#include <random>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <sys/random.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GSEA_X86 1
+#endif
 
 using namespace std;
 
-// Convierte la clave a un vector de bytes sin signo
-static vector<unsigned char> prepare_key(const string& key) {
-    vector<unsigned char> prepared_key;
-    for (char c : key) {
-        prepared_key.push_back(static_cast<unsigned char>(c));
+// =================================================================
+// CLAVE PREPARADA
+// =================================================================
+
+// Ancho máximo de registro soportado (AVX-512: 64 bytes)
+static const size_t MAX_LANES = 64;
+
+/**
+ * Clave expandida para los kernels vectoriales: el patrón contiene la clave
+ * repetida key_len * MAX_LANES bytes (múltiplo de la clave y de cualquier
+ * ancho de registro), empezando en la posición de clave 0. Para desencriptar
+ * se guarda la clave negada, de modo que ambas operaciones son una suma.
+ */
+struct PreparedKey {
+    string key;
+    bool decrypt = false;
+    size_t key_len = 0;
+    vector<unsigned char> pattern;
+};
+
+// Devuelve la clave preparada, reutilizándola entre llamadas del mismo hilo
+static const PreparedKey& prepare_key(const string& key, bool decrypt) {
+    thread_local PreparedKey cached;
+    if (cached.key_len != 0 && cached.decrypt == decrypt && cached.key == key) {
+        return cached;
+    }
+
+    cached.key = key;
+    cached.decrypt = decrypt;
+    cached.key_len = key.size();
+    cached.pattern.resize(key.size() * MAX_LANES);
+    for (size_t i = 0; i < cached.pattern.size(); ++i) {
+        unsigned char k = static_cast<unsigned char>(key[i % key.size()]);
+        cached.pattern[i] = decrypt ? static_cast<unsigned char>(-k) : k;
+    }
+    return cached;
+}
+
+// =================================================================
+// KERNELS
+// =================================================================
+
+// dst[i] = src[i] + pattern[(start + i) % period]; dst y src pueden coincidir
+using VigenereKernel = void (*)(unsigned char* dst, const unsigned char* src, size_t n,
+                                const unsigned char* pattern, size_t period, size_t start);
+
+static void kernel_scalar(unsigned char* dst, const unsigned char* src, size_t n,
+                          const unsigned char* pattern, size_t period, size_t start) {
+    size_t k = start;
+    for (size_t i = 0; i < n; ++i) {
+        // Encriptación binaria: C = (P + K) mod 256 (K negada al desencriptar)
+        dst[i] = static_cast<unsigned char>(src[i] + pattern[k]);
+        if (++k == period) k = 0;
     }
-    return prepared_key;
 }
 
-FileData encrypt_vigenere(const FileData& input, const string& key) {
-    if (input.empty() || key.empty()) return input;
+#ifdef GSEA_X86
 
-    FileData output = input;
-    vector<unsigned char> prepared_key = prepare_key(key);
-    size_t key_len = prepared_key.size();
+// Como period es múltiplo del ancho, k avanza de a un registro y vuelve a 0 sin cortes
+static void kernel_sse2(unsigned char* dst, const unsigned char* src, size_t n,
+                        const unsigned char* pattern, size_t period, size_t start) {
+    size_t i = 0;
+    size_t k = start;
+    if (k % 16 == 0) {
+        for (; i + 16 <= n; i += 16) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + k));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi8(d, key));
+            k += 16;
+            if (k == period) k = 0;
+        }
+    }
+    kernel_scalar(dst + i, src + i, n - i, pattern, period, k);
+}
 
-    for (size_t i = 0; i < input.size(); ++i) {
-        unsigned char plain_byte = input[i];
-        unsigned char key_byte = prepared_key[i % key_len];
+__attribute__((target("avx2")))
+static void kernel_avx2(unsigned char* dst, const unsigned char* src, size_t n,
+                        const unsigned char* pattern, size_t period, size_t start) {
+    size_t i = 0;
+    size_t k = start;
+    if (k % 32 == 0) {
+        for (; i + 32 <= n; i += 32) {
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + k));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi8(d, key));
+            k += 32;
+            if (k == period) k = 0;
+        }
+    }
+    kernel_scalar(dst + i, src + i, n - i, pattern, period, k);
+}
 
-        // Encriptación binaria: C = (P + K) mod 256
-        output[i] = static_cast<unsigned char>(plain_byte + key_byte);
+__attribute__((target("avx512f,avx512bw")))
+static void kernel_avx512(unsigned char* dst, const unsigned char* src, size_t n,
+                          const unsigned char* pattern, size_t period, size_t start) {
+    size_t i = 0;
+    size_t k = start;
+    if (k % 64 == 0) {
+        for (; i + 64 <= n; i += 64) {
+            __m512i d = _mm512_loadu_si512(src + i);
+            __m512i key = _mm512_loadu_si512(pattern + k);
+            _mm512_storeu_si512(dst + i, _mm512_add_epi8(d, key));
+            k += 64;
+            if (k == period) k = 0;
+        }
     }
+    kernel_scalar(dst + i, src + i, n - i, pattern, period, k);
+}
+
+#endif
+
+struct KernelInfo {
+    VigenereKernel fn;
+    const char* name;
+};
+
+// Selecciona una sola vez el mejor kernel disponible en esta CPU (cpuid)
+static const KernelInfo& select_kernel() {
+    static const KernelInfo info = []() -> KernelInfo {
+#ifdef GSEA_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw")) return {kernel_avx512, "avx512"};
+        if (__builtin_cpu_supports("avx2")) return {kernel_avx2, "avx2"};
+        return {kernel_sse2, "sse2"};
+#else
+        return {kernel_scalar, "escalar"};
+#endif
+    }();
+    return info;
+}
+
+/**
+ * Aplica la clave sobre n bytes empezando en la posición key_offset del flujo.
+ * Los bytes hasta la siguiente frontera de registro se procesan con el kernel
+ * escalar para que el kernel vectorial comience alineado con el patrón.
+ */
+static void apply_key(unsigned char* dst, const unsigned char* src, size_t n,
+                      const string& key, bool decrypt, uint64_t key_offset) {
+    const PreparedKey& prepared = prepare_key(key, decrypt);
+    const unsigned char* pattern = prepared.pattern.data();
+    size_t period = prepared.pattern.size();
+    size_t start = static_cast<size_t>(key_offset % prepared.key_len);
+
+    // start < key_len, por lo que las posiciones múltiplos de MAX_LANES están en el patrón
+    size_t head = min(n, (MAX_LANES - start % MAX_LANES) % MAX_LANES);
+    kernel_scalar(dst, src, head, pattern, period, start);
+    select_kernel().fn(dst + head, src + head, n - head, pattern, period, (start + head) % period);
+}
+
+// =================================================================
+// API PÚBLICA
+// =================================================================
+
+FileData encrypt_vigenere(ByteView input, const string& key) {
+    if (input.empty() || key.empty()) return FileData(input.begin(), input.end());
+
+    FileData output(input.size());
+    apply_key(output.data(), input.data(), input.size(), key, false, 0);
+    return output;
+}
+
+FileData decrypt_vigenere(ByteView input, const string& key) {
+    if (input.empty() || key.empty()) return FileData(input.begin(), input.end());
+
+    FileData output(input.size());
+    apply_key(output.data(), input.data(), input.size(), key, true, 0);
     return output;
 }
 
-FileData decrypt_vigenere(const FileData& input, const string& key) {
-    if (input.empty() || key.empty()) return input;
+void encrypt_vigenere_in_place(unsigned char* data, size_t size, const string& key, uint64_t key_offset) {
+    if (size == 0 || key.empty()) return;
+    apply_key(data, data, size, key, false, key_offset);
+}
+
+void decrypt_vigenere_in_place(unsigned char* data, size_t size, const string& key, uint64_t key_offset) {
+    if (size == 0 || key.empty()) return;
+    apply_key(data, data, size, key, true, key_offset);
+}
+
+const char* vigenere_kernel_name() {
+    return select_kernel().name;
+}
+
+// =================================================================
+// CHACHA20
+// =================================================================
 
-    FileData output = input;
-    vector<unsigned char> prepared_key = prepare_key(key);
-    size_t key_len = prepared_key.size();
+static const unsigned char CHACHA20_MAGIC[4] = {'G', 'S', 'C', 'H'};
+static const unsigned char CHACHA20_VERSION = 2;        // Clave derivada con PBKDF2 y la sal del nonce
+static const unsigned char CHACHA20_VERSION_SHA256 = 1; // Anterior: SHA-256 de la clave, sin sal (solo se lee)
 
-    for (size_t i = 0; i < input.size(); ++i) {
-        unsigned char cipher_byte = input[i];
-        unsigned char key_byte = prepared_key[i % key_len];
+// El nonce es la sal de la clave derivada (8 bytes) seguida de un contador (4 bytes)
+static const size_t CHACHA20_SALT_SIZE = 8;
 
-        // Desencriptación binaria: P = (C - K) mod 256
-        output[i] = static_cast<unsigned char>(cipher_byte - key_byte);
+// Claves derivadas que se conservan en el proceso (una por clave de texto y sal)
+static const size_t DERIVED_KEY_CACHE = 64;
+
+// Tramo mínimo por hilo al repartir un buffer (múltiplo de 64)
+static const size_t CHACHA20_SEGMENT = 1 << 20;
+
+static inline uint32_t load_le32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline uint32_t rotl32(uint32_t v, int c) {
+    return (v << c) | (v >> (32 - c));
+}
+
+static inline void quarter_round(uint32_t* x, int a, int b, int c, int d) {
+    x[a] += x[b]; x[d] = rotl32(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = rotl32(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = rotl32(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = rotl32(x[b] ^ x[c], 7);
+}
+
+// Estado inicial: constantes, clave, contador de bloque y nonce
+static void init_state(uint32_t state[16], const unsigned char key[32], const unsigned char nonce[12],
+                       uint32_t counter) {
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) state[4 + i] = load_le32(key + 4 * i);
+    state[12] = counter;
+    for (int i = 0; i < 3; ++i) state[13 + i] = load_le32(nonce + 4 * i);
+}
+
+// Bloque de flujo de clave (64 bytes) para el contador de state[12]
+static void chacha20_block(const uint32_t state[16], unsigned char out[64]) {
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        quarter_round(x, 0, 4, 8, 12);
+        quarter_round(x, 1, 5, 9, 13);
+        quarter_round(x, 2, 6, 10, 14);
+        quarter_round(x, 3, 7, 11, 15);
+        quarter_round(x, 0, 5, 10, 15);
+        quarter_round(x, 1, 6, 11, 12);
+        quarter_round(x, 2, 7, 8, 13);
+        quarter_round(x, 3, 4, 9, 14);
+    }
+    for (int i = 0; i < 16; ++i) {
+        uint32_t v = x[i] + state[i];
+        out[4 * i] = static_cast<unsigned char>(v);
+        out[4 * i + 1] = static_cast<unsigned char>(v >> 8);
+        out[4 * i + 2] = static_cast<unsigned char>(v >> 16);
+        out[4 * i + 3] = static_cast<unsigned char>(v >> 24);
     }
+}
+
+// Combina blocks bloques completos de data con el flujo de clave; avanza state[12]
+using ChaChaKernel = void (*)(unsigned char* data, size_t blocks, uint32_t state[16]);
+
+static void chacha_scalar(unsigned char* data, size_t blocks, uint32_t state[16]) {
+    unsigned char stream[64];
+    for (size_t i = 0; i < blocks; ++i) {
+        chacha20_block(state, stream);
+        for (int j = 0; j < 64; ++j) data[64 * i + j] ^= stream[j];
+        state[12]++;
+    }
+}
+
+#ifdef GSEA_X86
+
+// Cada registro guarda la misma palabra del estado para 4 bloques consecutivos
+template <int C>
+static inline __m128i rotl_sse2(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi32(v, C), _mm_srli_epi32(v, 32 - C));
+}
+
+static inline void quarter_round_sse2(__m128i& a, __m128i& b, __m128i& c, __m128i& d) {
+    a = _mm_add_epi32(a, b); d = rotl_sse2<16>(_mm_xor_si128(d, a));
+    c = _mm_add_epi32(c, d); b = rotl_sse2<12>(_mm_xor_si128(b, c));
+    a = _mm_add_epi32(a, b); d = rotl_sse2<8>(_mm_xor_si128(d, a));
+    c = _mm_add_epi32(c, d); b = rotl_sse2<7>(_mm_xor_si128(b, c));
+}
+
+static inline void xor_store_sse2(unsigned char* p, __m128i k) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_xor_si128(d, k));
+}
+
+static void chacha_sse2(unsigned char* data, size_t blocks, uint32_t state[16]) {
+    size_t i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m128i s[16], x[16];
+        for (int j = 0; j < 16; ++j) s[j] = _mm_set1_epi32(static_cast<int>(state[j]));
+        s[12] = _mm_add_epi32(s[12], _mm_set_epi32(3, 2, 1, 0));
+        for (int j = 0; j < 16; ++j) x[j] = s[j];
+
+        for (int r = 0; r < 10; ++r) {
+            quarter_round_sse2(x[0], x[4], x[8], x[12]);
+            quarter_round_sse2(x[1], x[5], x[9], x[13]);
+            quarter_round_sse2(x[2], x[6], x[10], x[14]);
+            quarter_round_sse2(x[3], x[7], x[11], x[15]);
+            quarter_round_sse2(x[0], x[5], x[10], x[15]);
+            quarter_round_sse2(x[1], x[6], x[11], x[12]);
+            quarter_round_sse2(x[2], x[7], x[8], x[13]);
+            quarter_round_sse2(x[3], x[4], x[9], x[14]);
+        }
+
+        // Transpuesta 4x4 por grupo de palabras: de "palabra por registro" a "bloque por registro"
+        unsigned char* out = data + 64 * i;
+        for (int g = 0; g < 4; ++g) {
+            __m128i a = _mm_add_epi32(x[4 * g], s[4 * g]);
+            __m128i b = _mm_add_epi32(x[4 * g + 1], s[4 * g + 1]);
+            __m128i c = _mm_add_epi32(x[4 * g + 2], s[4 * g + 2]);
+            __m128i d = _mm_add_epi32(x[4 * g + 3], s[4 * g + 3]);
+            __m128i ab_lo = _mm_unpacklo_epi32(a, b), cd_lo = _mm_unpacklo_epi32(c, d);
+            __m128i ab_hi = _mm_unpackhi_epi32(a, b), cd_hi = _mm_unpackhi_epi32(c, d);
+            xor_store_sse2(out + 16 * g, _mm_unpacklo_epi64(ab_lo, cd_lo));
+            xor_store_sse2(out + 64 + 16 * g, _mm_unpackhi_epi64(ab_lo, cd_lo));
+            xor_store_sse2(out + 128 + 16 * g, _mm_unpacklo_epi64(ab_hi, cd_hi));
+            xor_store_sse2(out + 192 + 16 * g, _mm_unpackhi_epi64(ab_hi, cd_hi));
+        }
+        state[12] += 4;
+    }
+    chacha_scalar(data + 64 * i, blocks - i, state);
+}
+
+// Igual que SSE2 con 8 bloques por pasada; las rotaciones de 16 y 8 bits son un shuffle de bytes
+template <int C>
+__attribute__((target("avx2")))
+static inline __m256i rotl_avx2(__m256i v) {
+    return _mm256_or_si256(_mm256_slli_epi32(v, C), _mm256_srli_epi32(v, 32 - C));
+}
+
+__attribute__((target("avx2")))
+static inline void quarter_round_avx2(__m256i& a, __m256i& b, __m256i& c, __m256i& d,
+                                      __m256i rot16, __m256i rot8) {
+    a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);
+    c = _mm256_add_epi32(c, d); b = rotl_avx2<12>(_mm256_xor_si256(b, c));
+    a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);
+    c = _mm256_add_epi32(c, d); b = rotl_avx2<7>(_mm256_xor_si256(b, c));
+}
+
+__attribute__((target("avx2")))
+static inline void xor_store_avx2(unsigned char* p, __m256i k) {
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_xor_si256(d, k));
+}
+
+__attribute__((target("avx2")))
+static void chacha_avx2(unsigned char* data, size_t blocks, uint32_t state[16]) {
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    size_t i = 0;
+    for (; i + 8 <= blocks; i += 8) {
+        __m256i s[16], x[16];
+        for (int j = 0; j < 16; ++j) s[j] = _mm256_set1_epi32(static_cast<int>(state[j]));
+        s[12] = _mm256_add_epi32(s[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        for (int j = 0; j < 16; ++j) x[j] = s[j];
+
+        for (int r = 0; r < 10; ++r) {
+            quarter_round_avx2(x[0], x[4], x[8], x[12], rot16, rot8);
+            quarter_round_avx2(x[1], x[5], x[9], x[13], rot16, rot8);
+            quarter_round_avx2(x[2], x[6], x[10], x[14], rot16, rot8);
+            quarter_round_avx2(x[3], x[7], x[11], x[15], rot16, rot8);
+            quarter_round_avx2(x[0], x[5], x[10], x[15], rot16, rot8);
+            quarter_round_avx2(x[1], x[6], x[11], x[12], rot16, rot8);
+            quarter_round_avx2(x[2], x[7], x[8], x[13], rot16, rot8);
+            quarter_round_avx2(x[3], x[4], x[9], x[14], rot16, rot8);
+        }
+
+        // Transpuesta dentro de cada mitad: t[g][b] tiene las palabras 4g..4g+3
+        // del bloque b (mitad baja) y del bloque b + 4 (mitad alta)
+        __m256i t[4][4];
+        for (int g = 0; g < 4; ++g) {
+            __m256i a = _mm256_add_epi32(x[4 * g], s[4 * g]);
+            __m256i b = _mm256_add_epi32(x[4 * g + 1], s[4 * g + 1]);
+            __m256i c = _mm256_add_epi32(x[4 * g + 2], s[4 * g + 2]);
+            __m256i d = _mm256_add_epi32(x[4 * g + 3], s[4 * g + 3]);
+            __m256i ab_lo = _mm256_unpacklo_epi32(a, b), cd_lo = _mm256_unpacklo_epi32(c, d);
+            __m256i ab_hi = _mm256_unpackhi_epi32(a, b), cd_hi = _mm256_unpackhi_epi32(c, d);
+            t[g][0] = _mm256_unpacklo_epi64(ab_lo, cd_lo);
+            t[g][1] = _mm256_unpackhi_epi64(ab_lo, cd_lo);
+            t[g][2] = _mm256_unpacklo_epi64(ab_hi, cd_hi);
+            t[g][3] = _mm256_unpackhi_epi64(ab_hi, cd_hi);
+        }
+        unsigned char* out = data + 64 * i;
+        for (int b = 0; b < 4; ++b) {
+            xor_store_avx2(out + 64 * b, _mm256_permute2x128_si256(t[0][b], t[1][b], 0x20));
+            xor_store_avx2(out + 64 * b + 32, _mm256_permute2x128_si256(t[2][b], t[3][b], 0x20));
+            xor_store_avx2(out + 64 * (b + 4), _mm256_permute2x128_si256(t[0][b], t[1][b], 0x31));
+            xor_store_avx2(out + 64 * (b + 4) + 32, _mm256_permute2x128_si256(t[2][b], t[3][b], 0x31));
+        }
+        state[12] += 8;
+    }
+    chacha_sse2(data + 64 * i, blocks - i, state);
+}
+
+#endif
+
+struct ChaChaKernelInfo {
+    ChaChaKernel fn;
+    const char* name;
+};
+
+// Selecciona una sola vez el mejor kernel disponible en esta CPU (cpuid)
+static const ChaChaKernelInfo& select_chacha_kernel() {
+    static const ChaChaKernelInfo info = []() -> ChaChaKernelInfo {
+#ifdef GSEA_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return {chacha_avx2, "avx2"};
+        return {chacha_sse2, "sse2"};
+#else
+        return {chacha_scalar, "escalar"};
+#endif
+    }();
+    return info;
+}
+
+// Aplica el flujo desde offset: bloque parcial inicial, bloques completos con el kernel y resto final
+static void apply_keystream(unsigned char* data, size_t size, const unsigned char key[32],
+                            const unsigned char nonce[12], uint64_t offset) {
+    uint32_t state[16];
+    init_state(state, key, nonce, static_cast<uint32_t>(offset / 64));
+    unsigned char stream[64];
+
+    size_t skip = static_cast<size_t>(offset % 64);
+    if (skip != 0 && size > 0) {
+        size_t take = min(size, 64 - skip);
+        chacha20_block(state, stream);
+        for (size_t j = 0; j < take; ++j) data[j] ^= stream[skip + j];
+        state[12]++;
+        data += take;
+        size -= take;
+    }
+
+    size_t blocks = size / 64;
+    select_chacha_kernel().fn(data, blocks, state);
+    data += 64 * blocks;
+    size -= 64 * blocks;
+
+    if (size > 0) {
+        chacha20_block(state, stream);
+        for (size_t j = 0; j < size; ++j) data[j] ^= stream[j];
+    }
+}
+
+void chacha20_xor(unsigned char* data, size_t size, const unsigned char key[32], const unsigned char nonce[12],
+                  uint64_t offset, ThreadPool* pool) {
+    size_t segments = min<size_t>(pool ? pool->size() : 1, (size + CHACHA20_SEGMENT - 1) / CHACHA20_SEGMENT);
+    if (segments <= 1) {
+        apply_keystream(data, size, key, nonce, offset);
+        return;
+    }
+
+    // Cada hilo recibe un tramo contiguo; como el contador depende solo de la posición, son independientes
+    size_t segment = ((size + segments - 1) / segments + 63) / 64 * 64;
+    parallel_for(pool, (size + segment - 1) / segment, [=](size_t i) {
+        size_t begin = i * segment;
+        apply_keystream(data + begin, min(segment, size - begin), key, nonce, offset + begin);
+    });
+}
+
+struct DerivedKey {
+    string key;
+    array<unsigned char, CHACHA20_SALT_SIZE> salt;
+    array<unsigned char, 32> derived;
+};
+
+/**
+ * Clave de 256 bits para descifrar o cifrar los datos con esta cabecera. En
+ * la versión actual es PBKDF2-HMAC-SHA256 de la clave de texto con la sal del
+ * nonce; como la derivación es lenta a propósito, cada (clave, sal) se deriva
+ * una sola vez por proceso y el hilo conserva la última que usó.
+ */
+static const unsigned char* derive_key(const string& key, const unsigned char* header) {
+    if (header[4] == CHACHA20_VERSION_SHA256) {
+        thread_local string cached_key;
+        thread_local array<unsigned char, 32> cached_digest;
+        thread_local bool valid = false;
+        if (!valid || cached_key != key) {
+            cached_digest = sha256(ByteView(reinterpret_cast<const unsigned char*>(key.data()), key.size()));
+            cached_key = key;
+            valid = true;
+        }
+        return cached_digest.data();
+    }
+
+    const unsigned char* salt = header + 8;
+    thread_local DerivedKey last;
+    thread_local bool last_valid = false;
+    if (last_valid && memcmp(last.salt.data(), salt, CHACHA20_SALT_SIZE) == 0 && last.key == key) {
+        return last.derived.data();
+    }
+
+    static mutex cache_mtx;
+    static vector<DerivedKey> cache; // Las más recientes al final
+    {
+        // Se deriva con el lock tomado: los hilos que piden la misma clave la esperan en lugar de repetirla
+        lock_guard<mutex> lock(cache_mtx);
+        auto it = find_if(cache.begin(), cache.end(), [&](const DerivedKey& entry) {
+            return memcmp(entry.salt.data(), salt, CHACHA20_SALT_SIZE) == 0 && entry.key == key;
+        });
+        if (it != cache.end()) {
+            last = *it;
+        } else {
+            last.key = key;
+            memcpy(last.salt.data(), salt, CHACHA20_SALT_SIZE);
+            last.derived = pbkdf2_sha256(ByteView(reinterpret_cast<const unsigned char*>(key.data()), key.size()),
+                                         ByteView(salt, CHACHA20_SALT_SIZE), CHACHA20_KDF_ITERATIONS);
+            if (cache.size() == DERIVED_KEY_CACHE) cache.erase(cache.begin());
+            cache.push_back(last);
+        }
+    }
+    last_valid = true;
+    return last.derived.data();
+}
+
+void random_bytes(unsigned char* out, size_t size) {
+    // getrandom; si no está disponible se usa random_device
+    size_t filled = 0;
+    while (filled < size) {
+        ssize_t got = getrandom(out + filled, size - filled, 0);
+        if (got <= 0) break;
+        filled += static_cast<size_t>(got);
+    }
+    if (filled < size) {
+        random_device rd;
+        for (size_t i = filled; i < size; ++i) out[i] = static_cast<unsigned char>(rd());
+    }
+}
+
+/**
+ * Nonce nuevo: la sal aleatoria del proceso y un contador. El par no se
+ * repite (al agotarse el contador se elige otra sal) y todas las salidas
+ * del proceso comparten la sal, así la clave se deriva una sola vez.
+ */
+static void next_nonce(unsigned char nonce[12]) {
+    static mutex nonce_mtx;
+    static unsigned char salt[CHACHA20_SALT_SIZE];
+    static uint64_t counter = uint64_t(1) << 32; // Fuera de rango: la primera llamada elige la sal
+    lock_guard<mutex> lock(nonce_mtx);
+    if (counter > UINT32_MAX) {
+        random_bytes(salt, sizeof(salt));
+        counter = 0;
+    }
+    memcpy(nonce, salt, CHACHA20_SALT_SIZE);
+    for (int i = 0; i < 4; ++i) nonce[CHACHA20_SALT_SIZE + i] = static_cast<unsigned char>(counter >> (8 * i));
+    counter++;
+}
+
+bool is_chacha20_data(ByteView data) {
+    return data.size() >= CHACHA20_HEADER_SIZE && memcmp(data.data(), CHACHA20_MAGIC, 4) == 0 &&
+           (data[4] == CHACHA20_VERSION || data[4] == CHACHA20_VERSION_SHA256) &&
+           data[5] == 0 && data[6] == 0 && data[7] == 0;
+}
+
+/**
+ * Escribe la cabecera con un nonce nuevo en out y cifra los size bytes que la
+ * siguen, que ya contienen los datos originales.
+ */
+static bool seal_chacha20(unsigned char* out, size_t size, const string& key, ThreadPool* pool) {
+    if (size > CHACHA20_MAX_SIZE) {
+        cerr << "ERROR CHACHA20: Los datos superan el máximo de " << (CHACHA20_MAX_SIZE >> 30) << " GiB por nonce." << endl;
+        return false;
+    }
+    memcpy(out, CHACHA20_MAGIC, 4);
+    out[4] = CHACHA20_VERSION;
+    memset(out + 5, 0, 3);
+    next_nonce(out + 8);
+    chacha20_xor(out + CHACHA20_HEADER_SIZE, size, derive_key(key, out), out + 8, 0, pool);
+    return true;
+}
+
+FileData encrypt_chacha20(ByteView input, const string& key, ThreadPool* pool) {
+    if (input.empty()) return {};
+    FileData output(CHACHA20_HEADER_SIZE + input.size());
+    memcpy(output.data() + CHACHA20_HEADER_SIZE, input.data(), input.size());
+    if (!seal_chacha20(output.data(), input.size(), key, pool)) return {};
+    return output;
+}
+
+FileData decrypt_chacha20_range(ByteView input, const string& key, uint64_t offset, uint64_t length,
+                                ThreadPool* pool) {
+    if (!is_chacha20_data(input)) {
+        cerr << "ERROR CHACHA20: Los datos no tienen cabecera ChaCha20." << endl;
+        return {};
+    }
+    uint64_t total = input.size() - CHACHA20_HEADER_SIZE;
+    if (length == 0 || offset >= total) {
+        cerr << "ERROR CHACHA20: El rango comienza fuera del contenido (" << total << " bytes)." << endl;
+        return {};
+    }
+    size_t len = static_cast<size_t>(min(length, total - offset));
+
+    FileData output(input.data() + CHACHA20_HEADER_SIZE + offset, input.data() + CHACHA20_HEADER_SIZE + offset + len);
+    chacha20_xor(output.data(), output.size(), derive_key(key, input.data()), input.data() + 8, offset, pool);
     return output;
-}
\ No newline at end of file
+}
+
+FileData decrypt_chacha20(ByteView input, const string& key, ThreadPool* pool) {
+    if (input.size() == CHACHA20_HEADER_SIZE && is_chacha20_data(input)) return {};
+    return decrypt_chacha20_range(input, key, 0, CHACHA20_MAX_SIZE, pool);
+}
+
+const char* chacha20_kernel_name() {
+    return select_chacha_kernel().name;
+}
+
+// =================================================================
+// SELECCIÓN DEL ALGORITMO
+// =================================================================
+
+bool encrypt_selected_into(ByteView input, const Config& config, FileData& output, ThreadPool* pool) {
+    output.clear();
+    if (input.empty()) return false;
+    if (config.enc_alg == ENC_ALG_CHACHA20) {
+        output.resize(CHACHA20_HEADER_SIZE + input.size());
+        memcpy(output.data() + CHACHA20_HEADER_SIZE, input.data(), input.size());
+        if (seal_chacha20(output.data(), input.size(), config.key, pool)) return true;
+        output.clear();
+        return false;
+    }
+    output.assign(input.begin(), input.end());
+    encrypt_vigenere_in_place(output.data(), output.size(), config.key);
+    return true;
+}
+
+FileData encrypt_selected(ByteView input, const Config& config, ThreadPool* pool) {
+    FileData output;
+    encrypt_selected_into(input, config, output, pool);
+    return output;
+}
+
+bool encrypt_selected_in_place(FileData& data, const Config& config, ThreadPool* pool) {
+    if (config.enc_alg != ENC_ALG_CHACHA20) {
+        encrypt_vigenere_in_place(data.data(), data.size(), config.key);
+        return true;
+    }
+    if (data.empty()) return true;
+    // Se desplazan los datos para dejar lugar a la cabecera, sin un segundo buffer
+    size_t size = data.size();
+    data.insert(data.begin(), CHACHA20_HEADER_SIZE, 0);
+    return seal_chacha20(data.data(), size, config.key, pool);
+}
+
+bool decrypt_selected_into(ByteView input, const Config& config, FileData& output, ThreadPool* pool) {
+    output.clear();
+    if (is_chacha20_data(input)) {
+        output.assign(input.begin() + CHACHA20_HEADER_SIZE, input.end());
+        chacha20_xor(output.data(), output.size(), derive_key(config.key, input.data()), input.data() + 8, 0, pool);
+        return !output.empty();
+    }
+    if (config.enc_alg == ENC_ALG_CHACHA20 && !input.empty()) {
+        cerr << "ERROR CHACHA20: Los datos no tienen cabecera ChaCha20." << endl;
+        return false;
+    }
+    output.assign(input.begin(), input.end());
+    decrypt_vigenere_in_place(output.data(), output.size(), config.key);
+    return !output.empty();
+}
+
+FileData decrypt_selected(ByteView input, const Config& config, ThreadPool* pool) {
+    FileData output;
+    decrypt_selected_into(input, config, output, pool);
+    return output;
+}
+
+const string& detected_enc_alg(ByteView input, const Config& config) {
+    return is_chacha20_data(input) ? ENC_ALG_CHACHA20 : config.enc_alg;
+}
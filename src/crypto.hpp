@@ -1,6 +1,12 @@
 #pragma once
 
 #include "constantes.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+
+// El cifrado se aplica con kernels SSE2/AVX2/AVX-512 elegidos en tiempo de
+// ejecución según la CPU (con respaldo escalar); la clave expandida se
+// reutiliza entre llamadas del mismo hilo.
 
 /**
  * Encripta los datos usando el Cifrado Vigenère binario.
@@ -8,7 +14,7 @@
  * @param key Clave secreta.
  * @return Datos encriptados.
  */
-FileData encrypt_vigenere(const FileData& input, const std::string& key);
+FileData encrypt_vigenere(ByteView input, const std::string& key);
 
 /**
  * Desencripta los datos usando el Cifrado Vigenère binario.
@@ -16,4 +22,156 @@ FileData encrypt_vigenere(const FileData& input, const std::string& key);
  * @param key Clave secreta.
  * @return Datos desencriptados.
  */
-FileData decrypt_vigenere(const FileData& input, const std::string& key);
+FileData decrypt_vigenere(ByteView input, const std::string& key);
+
+/**
+ * Encripta los datos en su lugar, sin buffer adicional.
+ * @param data Datos a encriptar (se sobrescriben).
+ * @param size Cantidad de bytes.
+ * @param key Clave secreta.
+ * @param key_offset Posición del primer byte dentro del flujo cifrado (índice de clave).
+ */
+void encrypt_vigenere_in_place(unsigned char* data, size_t size, const std::string& key, uint64_t key_offset = 0);
+
+/**
+ * Desencripta los datos en su lugar, sin buffer adicional.
+ * @param data Datos a desencriptar (se sobrescriben).
+ * @param size Cantidad de bytes.
+ * @param key Clave secreta.
+ * @param key_offset Posición del primer byte dentro del flujo cifrado (índice de clave).
+ */
+void decrypt_vigenere_in_place(unsigned char* data, size_t size, const std::string& key, uint64_t key_offset = 0);
+
+/**
+ * @return Nombre del kernel Vigenère elegido en tiempo de ejecución (avx512, avx2, sse2 o escalar).
+ */
+const char* vigenere_kernel_name();
+
+// =================================================================
+// CHACHA20
+// =================================================================
+
+/**
+ * ChaCha20 (RFC 8439) en modo contador. Cada salida lleva una cabecera con
+ * su nonce de 96 bits, formado por una sal aleatoria de 64 bits (la misma
+ * para todas las salidas de un proceso) y un contador de 32 bits:
+ *   ["GSCH"] [Versión (1)] [Reservado (3)] [Sal (8)] [Contador (4)] [Datos cifrados]
+ * La clave de 256 bits se deriva de la clave de texto y la sal con
+ * PBKDF2-HMAC-SHA256 (CHACHA20_KDF_ITERATIONS iteraciones), lo que encarece
+ * adivinar una clave de texto débil. Los archivos de la versión 1 (clave
+ * derivada con SHA-256, sin sal) se siguen pudiendo desencriptar.
+ * El byte i de los datos se combina con el byte i del flujo de clave (bloque
+ * i / 64 del contador), así cualquier posición se cifra o descifra sin
+ * procesar las anteriores: los buffers grandes se reparten entre hilos y un
+ * rango puede leerse de forma independiente. El flujo de clave se genera de a
+ * 8 bloques (AVX2) o 4 bloques (SSE2) por pasada, con respaldo escalar.
+ * No autentica los datos: una clave incorrecta produce datos sin sentido.
+ */
+
+// Tamaño de la cabecera de un archivo cifrado con ChaCha20
+const size_t CHACHA20_HEADER_SIZE = 20;
+
+// Contador de 32 bits: como máximo 2^32 bloques de 64 bytes por nonce
+const uint64_t CHACHA20_MAX_SIZE = uint64_t(64) << 32;
+
+// Iteraciones de PBKDF2 al derivar la clave (una vez por clave de texto y sal en cada proceso)
+const uint32_t CHACHA20_KDF_ITERATIONS = 100000;
+
+/**
+ * Combina los datos con el flujo de clave ChaCha20 desde una posición
+ * (cifra y descifra, es la misma operación).
+ * @param data Datos (se sobrescriben).
+ * @param size Cantidad de bytes.
+ * @param key Clave de 32 bytes.
+ * @param nonce Nonce de 12 bytes.
+ * @param offset Posición del primer byte dentro del flujo (bloque offset / 64).
+ * @param pool Pool donde se reparten los buffers grandes (nulo = en el hilo actual).
+ */
+void chacha20_xor(unsigned char* data, size_t size, const unsigned char key[32], const unsigned char nonce[12],
+                  uint64_t offset, ThreadPool* pool = nullptr);
+
+/**
+ * Indica si los datos comienzan con una cabecera ChaCha20.
+ */
+bool is_chacha20_data(ByteView data);
+
+/**
+ * Encripta con ChaCha20 y un nonce nuevo.
+ * @param input Datos binarios a encriptar.
+ * @param key Clave secreta (se deriva con PBKDF2 y la sal del nonce).
+ * @param pool Pool donde se reparten los buffers grandes (nulo = en el hilo actual).
+ * @return Cabecera y datos encriptados; vacío si la entrada es vacía o supera CHACHA20_MAX_SIZE.
+ */
+FileData encrypt_chacha20(ByteView input, const std::string& key, ThreadPool* pool = nullptr);
+
+/**
+ * Desencripta datos con cabecera ChaCha20.
+ * @param input Cabecera y datos encriptados.
+ * @param key Clave secreta.
+ * @param pool Pool donde se reparten los buffers grandes (nulo = en el hilo actual).
+ * @return Datos desencriptados; vacío si falta la cabecera.
+ */
+FileData decrypt_chacha20(ByteView input, const std::string& key, ThreadPool* pool = nullptr);
+
+/**
+ * Desencripta solo un rango de bytes, sin procesar el resto del archivo.
+ * @param input Cabecera y datos encriptados.
+ * @param offset Posición del primer byte del rango (en los datos originales).
+ * @param length Largo del rango (se recorta al final de los datos).
+ * @return Bytes del rango; vacío si falta la cabecera o el rango empieza fuera de los datos.
+ */
+FileData decrypt_chacha20_range(ByteView input, const std::string& key, uint64_t offset, uint64_t length,
+                                ThreadPool* pool = nullptr);
+
+/**
+ * Llena out con bytes aleatorios del sistema (getrandom, o random_device si
+ * no está disponible).
+ */
+void random_bytes(unsigned char* out, size_t size);
+
+/**
+ * @return Nombre del kernel ChaCha20 elegido en tiempo de ejecución (avx2, sse2 o escalar).
+ */
+const char* chacha20_kernel_name();
+
+// =================================================================
+// SELECCIÓN DEL ALGORITMO
+// =================================================================
+
+/**
+ * Encripta con el algoritmo de config.enc_alg.
+ * @return Datos encriptados; vacío si el algoritmo no pudo encriptarlos.
+ */
+FileData encrypt_selected(ByteView input, const Config& config, ThreadPool* pool = nullptr);
+
+/**
+ * Como encrypt_selected, pero escribe en output reutilizando su capacidad.
+ * @return false si el algoritmo no pudo encriptar los datos (output queda vacío).
+ */
+bool encrypt_selected_into(ByteView input, const Config& config, FileData& output, ThreadPool* pool = nullptr);
+
+/**
+ * Encripta un buffer propio con el algoritmo de config.enc_alg. Vigenère
+ * trabaja en su lugar; ChaCha20 antepone su cabecera.
+ * @return false si el algoritmo no pudo encriptar los datos.
+ */
+bool encrypt_selected_in_place(FileData& data, const Config& config, ThreadPool* pool = nullptr);
+
+/**
+ * Desencripta detectando el algoritmo: los datos con cabecera ChaCha20 se
+ * descifran con ChaCha20 y el resto con Vigenère (salvo que config.enc_alg
+ * pida ChaCha20, en cuyo caso la cabecera es obligatoria).
+ * @return Datos desencriptados; vacío si no se pudieron desencriptar.
+ */
+FileData decrypt_selected(ByteView input, const Config& config, ThreadPool* pool = nullptr);
+
+/**
+ * Como decrypt_selected, pero escribe en output reutilizando su capacidad.
+ * @return false si no se pudieron desencriptar (output queda vacío).
+ */
+bool decrypt_selected_into(ByteView input, const Config& config, FileData& output, ThreadPool* pool = nullptr);
+
+/**
+ * @return Nombre del algoritmo con el que decrypt_selected desencriptaría los datos.
+ */
+const std::string& detected_enc_alg(ByteView input, const Config& config);
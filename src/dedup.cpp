@@ -0,0 +1,288 @@
+#include "dedup.hpp"
+#include "block.hpp"
+#include "bytes.hpp"
+#include "hash.hpp"
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const unsigned char CHUNK_STORE_MAGIC[4] = {'G', 'S', 'C', 'P'};
+static const unsigned char CHUNK_TABLE_MAGIC[4] = {'G', 'S', 'C', 'T'};
+static const unsigned char RECIPE_MAGIC[4] = {'G', 'S', 'D', 'R'};
+static const unsigned char CHUNK_STORE_VERSION = 1;
+static const unsigned char RECIPE_VERSION = 1;
+static const size_t CHUNK_STORE_HEADER_SIZE = 12;
+static const size_t CHUNK_TABLE_ENTRY_SIZE = 16;
+static const size_t CHUNK_FOOTER_SIZE = 16;
+static const size_t RECIPE_HEADER_SIZE = 8;
+
+// Semillas de las dos mitades de la huella de 128 bits
+static const uint64_t FINGERPRINT_SEED_A = 0;
+static const uint64_t FINGERPRINT_SEED_B = 0x9E3779B97F4A7C15ULL;
+
+// =================================================================
+// CORTE DEFINIDO POR CONTENIDO
+// =================================================================
+
+// Tabla del gear hash: un valor pseudoaleatorio fijo por byte (splitmix64)
+static array<uint64_t, 256> make_gear_table() {
+    array<uint64_t, 256> table{};
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (uint64_t& value : table) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}
+
+static const array<uint64_t, 256> GEAR = make_gear_table();
+
+// Bits altos del hash que deben ser cero para cortar: antes del tamaño medio
+// se exigen más (cortes menos probables) y después menos, lo que concentra
+// los tamaños alrededor de la media (corte normalizado)
+static const int CUT_BITS_BEFORE_AVG = 17;
+static const int CUT_BITS_AFTER_AVG = 13;
+
+size_t next_chunk_size(const unsigned char* data, size_t size) {
+    if (size <= DEDUP_MIN_CHUNK) return size;
+    size_t limit = min(size, DEDUP_MAX_CHUNK);
+    size_t normal = min(limit, DEDUP_AVG_CHUNK);
+
+    // El gear hash depende solo de los últimos 64 bytes: empezar en el mínimo
+    // no cambia dónde caen los cortes
+    uint64_t hash = 0;
+    size_t i = DEDUP_MIN_CHUNK;
+    for (; i < normal; ++i) {
+        hash = (hash << 1) + GEAR[data[i]];
+        if ((hash >> (64 - CUT_BITS_BEFORE_AVG)) == 0) return i + 1;
+    }
+    for (; i < limit; ++i) {
+        hash = (hash << 1) + GEAR[data[i]];
+        if ((hash >> (64 - CUT_BITS_AFTER_AVG)) == 0) return i + 1;
+    }
+    return limit;
+}
+
+// Escribe todo el buffer en un offset fijo (los hilos escriben en regiones disjuntas)
+static bool pwrite_fully(int fd, const unsigned char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+// =================================================================
+// ALMACÉN EN ESCRITURA
+// =================================================================
+
+ChunkStore::~ChunkStore() {
+    if (fd >= 0) close_fd(fd);
+}
+
+bool ChunkStore::create(const string& path) {
+    fd = open_output_fd(path);
+    if (fd < 0) return false;
+    FileData header;
+    header.insert(header.end(), CHUNK_STORE_MAGIC, CHUNK_STORE_MAGIC + 4);
+    header.push_back(CHUNK_STORE_VERSION);
+    header.push_back(block_flags(config));
+    header.push_back(0);
+    header.push_back(0);
+    put_u32(header, static_cast<uint32_t>(DEDUP_AVG_CHUNK));
+    next_offset = header.size();
+    return write_fully(fd, header.data(), header.size());
+}
+
+uint32_t ChunkStore::add(const unsigned char* data, size_t size, bool* added) {
+    ByteView chunk(data, size);
+    Fingerprint fp{hash64(chunk, FINGERPRINT_SEED_A), hash64(chunk, FINGERPRINT_SEED_B), static_cast<uint32_t>(size)};
+    Shard& shard = shards[(fp.b >> 32) % SHARDS];
+
+    uint32_t id;
+    {
+        lock_guard<mutex> lock(shard.mtx);
+        auto it = shard.ids.find(fp);
+        if (it != shard.ids.end()) {
+            if (added) *added = false;
+            return it->second;
+        }
+        id = next_id++;
+        shard.ids.emplace(fp, id);
+    }
+    if (added) *added = true;
+
+    // Fragmento nuevo: se codifica sin locks y se escribe en un espacio reservado
+    FileData encoded = encode_block(data, size, config);
+    FileData record;
+    record.reserve(BLOCK_HEADER_SIZE + encoded.size());
+    write_block_header(record, static_cast<uint32_t>(size), static_cast<uint32_t>(encoded.size()));
+    record.insert(record.end(), encoded.begin(), encoded.end());
+    uint64_t offset = next_offset.fetch_add(record.size());
+    if (!pwrite_fully(fd, record.data(), record.size(), offset)) failed = true;
+
+    lock_guard<mutex> lock(table_mtx);
+    if (table.size() <= id) table.resize(id + 1);
+    table[id] = {offset, static_cast<uint32_t>(size), static_cast<uint32_t>(encoded.size())};
+    return id;
+}
+
+bool ChunkStore::finish() {
+    if (fd < 0 || failed) return false;
+    table.resize(next_id.load());
+    FileData trailer;
+    trailer.reserve(table.size() * CHUNK_TABLE_ENTRY_SIZE + CHUNK_FOOTER_SIZE);
+    for (const TableEntry& entry : table) {
+        put_u64(trailer, entry.offset);
+        put_u32(trailer, entry.raw_size);
+        put_u32(trailer, entry.stored_size);
+    }
+    put_u64(trailer, next_offset.load());
+    put_u32(trailer, static_cast<uint32_t>(table.size()));
+    trailer.insert(trailer.end(), CHUNK_TABLE_MAGIC, CHUNK_TABLE_MAGIC + 4);
+    bool ok = pwrite_fully(fd, trailer.data(), trailer.size(), next_offset.load());
+    close_fd(fd);
+    fd = -1;
+    return ok;
+}
+
+// =================================================================
+// ALMACÉN EN LECTURA
+// =================================================================
+
+bool ChunkPack::open(const string& path, const Config& config) {
+    if (!input.open(path)) return false;
+    ByteView data = input.view();
+    if (data.size() < CHUNK_STORE_HEADER_SIZE + CHUNK_FOOTER_SIZE ||
+        memcmp(data.data(), CHUNK_STORE_MAGIC, 4) != 0 || data[4] != CHUNK_STORE_VERSION ||
+        memcmp(data.data() + data.size() - 4, CHUNK_TABLE_MAGIC, 4) != 0) {
+        cerr << "ERROR DEDUP: El almacén de fragmentos no es válido: " << path << endl;
+        return false;
+    }
+    flags = data[5];
+    if (!check_block_flags(flags, config)) return false;
+
+    const unsigned char* footer = data.data() + data.size() - CHUNK_FOOTER_SIZE;
+    uint64_t table_offset = get_u64(footer);
+    uint64_t count = get_u32(footer + 8);
+    if (!table_fits(data.size(), CHUNK_STORE_HEADER_SIZE, CHUNK_FOOTER_SIZE, table_offset, count,
+                    CHUNK_TABLE_ENTRY_SIZE)) {
+        cerr << "ERROR DEDUP: Tabla de fragmentos inválida: " << path << endl;
+        return false;
+    }
+    table.resize(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        const unsigned char* p = data.data() + table_offset + i * CHUNK_TABLE_ENTRY_SIZE;
+        TableEntry entry{get_u64(p), get_u32(p + 8), get_u32(p + 12)};
+        // La cabecera y los datos del fragmento deben quedar antes de la tabla
+        if (!block_fits(entry.offset, entry.stored_size, CHUNK_STORE_HEADER_SIZE, table_offset) ||
+            get_u32(data.data() + entry.offset) != entry.raw_size ||
+            get_u32(data.data() + entry.offset + 4) != entry.stored_size) {
+            cerr << "ERROR DEDUP: Fragmento " << i << " fuera de rango en: " << path << endl;
+            return false;
+        }
+        table[i] = entry;
+    }
+    return true;
+}
+
+bool ChunkPack::read(uint32_t id, const Config& config, FileData& out) const {
+    if (id >= table.size()) return false;
+    const TableEntry& entry = table[id];
+    return decode_block(input.view().data() + entry.offset + BLOCK_HEADER_SIZE, entry.stored_size,
+                        entry.raw_size, flags, config, out);
+}
+
+bool is_dedup_directory(const string& path) {
+    struct stat st;
+    string store = path + "/" + CHUNK_STORE_FILE;
+    return stat(store.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// =================================================================
+// RECETAS
+// =================================================================
+
+bool dedup_file(const string& input_file, const string& recipe_file, ChunkStore& store,
+                uint64_t& bytes_in, uint64_t& new_bytes) {
+    InputFile input;
+    if (!input.open(input_file)) {
+        // Un archivo vacío es válido: su receta no tiene fragmentos
+        struct stat st;
+        if (stat(input_file.c_str(), &st) != 0 || st.st_size != 0) return false;
+    }
+    ByteView data = input.view();
+    bytes_in = data.size();
+    new_bytes = 0;
+
+    vector<uint32_t> ids;
+    ids.reserve(data.size() / DEDUP_AVG_CHUNK + 1);
+    for (size_t pos = 0; pos < data.size();) {
+        size_t len = next_chunk_size(data.data() + pos, data.size() - pos);
+        bool added = false;
+        ids.push_back(store.add(data.data() + pos, len, &added));
+        if (added) new_bytes += len;
+        pos += len;
+    }
+
+    FileData recipe;
+    recipe.insert(recipe.end(), RECIPE_MAGIC, RECIPE_MAGIC + 4);
+    recipe.push_back(RECIPE_VERSION);
+    recipe.insert(recipe.end(), 3, 0);
+    put_varint(recipe, data.size());
+    put_varint(recipe, ids.size());
+    for (uint32_t id : ids) put_varint(recipe, id);
+    if (!write_file_posix(recipe_file, recipe)) {
+        cerr << "  [HILO] ERROR: Falló la escritura de la receta: " << recipe_file << endl;
+        return false;
+    }
+    return true;
+}
+
+bool restore_dedup_file(const string& recipe_file, const string& output_file, const ChunkPack& pack,
+                        const Config& config) {
+    InputFile input;
+    if (!input.open(recipe_file)) return false;
+    ByteView recipe = input.view();
+    if (recipe.size() < RECIPE_HEADER_SIZE || memcmp(recipe.data(), RECIPE_MAGIC, 4) != 0 ||
+        recipe[4] != RECIPE_VERSION) {
+        cerr << "  [HILO] ERROR DEDUP: No es una receta válida: " << recipe_file << endl;
+        return false;
+    }
+
+    int fd = open_output_fd(output_file);
+    if (fd < 0) return false;
+    bool ok = true;
+    try {
+        size_t pos = RECIPE_HEADER_SIZE;
+        uint64_t expected = get_varint(recipe, pos);
+        uint64_t count = get_varint(recipe, pos);
+        uint64_t written = 0;
+        FileData chunk;
+        for (uint64_t i = 0; ok && i < count; ++i) {
+            uint64_t id = get_varint(recipe, pos);
+            ok = id <= UINT32_MAX && pack.read(static_cast<uint32_t>(id), config, chunk) &&
+                 write_fully(fd, chunk.data(), chunk.size());
+            written += chunk.size();
+        }
+        ok = ok && written == expected;
+    } catch (const runtime_error&) {
+        ok = false;
+    }
+    close_fd(fd);
+    if (!ok) cerr << "  [HILO] ERROR DEDUP: Falló la reconstrucción de: " << recipe_file << endl;
+    return ok;
+}
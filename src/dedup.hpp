@@ -0,0 +1,159 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "fs_utils.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Deduplicación por fragmentos definidos por contenido (--dedup).
+ * Cada archivo se corta en fragmentos de tamaño variable donde un hash
+ * rodante (gear hash) cumple una condición, así una inserción o un cambio
+ * solo mueve los cortes cercanos. Cada fragmento se identifica por su huella
+ * (dos hash64 con semillas distintas y el tamaño); un índice concurrente
+ * compartido por todos los hilos guarda cada fragmento distinto una sola vez
+ * en un almacén común, comprimido/encriptado con encode_block. Por cada
+ * archivo se escribe una receta con la lista de fragmentos.
+ *
+ * Almacén (<salida>/.gsea-chunks, enteros little-endian):
+ * - Cabecera (12 bytes): ["GSCP"] [Versión (1)] [Flags (1)] [Reservado (2)] [Tamaño medio de fragmento (4)]
+ * - Por fragmento, en orden de escritura: [Tamaño original (4)] [Tamaño almacenado (4)] [Datos]
+ * - Tabla, por id de fragmento: [Offset de su cabecera (8)] [Tamaño original (4)] [Tamaño almacenado (4)]
+ * - Pie (16 bytes): [Offset de la tabla (8)] [Número de fragmentos (4)] ["GSCT"]
+ *
+ * Receta (una por archivo, con el nombre de salida habitual):
+ *   ["GSDR"] [Versión (1)] [Reservado (3)] varint: [Tamaño original] [Número de fragmentos] [Id]...
+ */
+
+// Nombre del almacén de fragmentos dentro del directorio de salida
+const char* const CHUNK_STORE_FILE = ".gsea-chunks";
+
+// Límites de los fragmentos (el corte se busca entre el mínimo y el máximo)
+const size_t DEDUP_MIN_CHUNK = 8 * 1024;
+const size_t DEDUP_AVG_CHUNK = 32 * 1024;
+const size_t DEDUP_MAX_CHUNK = 128 * 1024;
+
+/**
+ * Calcula el largo del próximo fragmento definido por contenido.
+ * @param data Inicio de los datos pendientes.
+ * @param size Bytes pendientes.
+ * @return Largo del fragmento (entre 1 y DEDUP_MAX_CHUNK).
+ */
+size_t next_chunk_size(const unsigned char* data, size_t size);
+
+/**
+ * Almacén de fragmentos en escritura. add() puede llamarse desde varios
+ * hilos: el índice está dividido en particiones con su propio lock y cada
+ * fragmento nuevo se codifica fuera de los locks y se escribe con pwrite en
+ * un offset reservado atómicamente.
+ */
+class ChunkStore {
+public:
+    explicit ChunkStore(const Config& config) : config(config) {}
+    ChunkStore(const ChunkStore&) = delete;
+    ChunkStore& operator=(const ChunkStore&) = delete;
+    ~ChunkStore();
+
+    /**
+     * Crea (o reemplaza) el almacén y escribe su cabecera.
+     */
+    bool create(const std::string& path);
+
+    /**
+     * Agrega un fragmento; si ya existe uno idéntico solo devuelve su id.
+     * @param added Si no es nulo, recibe true si el fragmento era nuevo.
+     * @return Id del fragmento.
+     */
+    uint32_t add(const unsigned char* data, size_t size, bool* added = nullptr);
+
+    /**
+     * Escribe la tabla y el pie. Debe llamarse cuando ya no hay add() en curso.
+     * @return true si todos los fragmentos se escribieron.
+     */
+    bool finish();
+
+    uint32_t chunk_count() const { return next_id.load(); }
+    uint64_t stored_bytes() const { return next_offset.load(); }
+
+private:
+    struct Fingerprint {
+        uint64_t a, b;
+        uint32_t size;
+        bool operator==(const Fingerprint& o) const { return a == o.a && b == o.b && size == o.size; }
+    };
+    struct FingerprintHash {
+        size_t operator()(const Fingerprint& f) const { return static_cast<size_t>(f.a); }
+    };
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<Fingerprint, uint32_t, FingerprintHash> ids;
+    };
+    struct TableEntry {
+        uint64_t offset = 0;
+        uint32_t raw_size = 0;
+        uint32_t stored_size = 0;
+    };
+    static const size_t SHARDS = 64;
+
+    const Config& config;
+    int fd = -1;
+    Shard shards[SHARDS];
+    std::atomic<uint32_t> next_id{0};
+    std::atomic<uint64_t> next_offset{0};
+    std::atomic<bool> failed{false};
+    std::mutex table_mtx;
+    std::vector<TableEntry> table;
+};
+
+/**
+ * Almacén de fragmentos en lectura (mapeado).
+ */
+class ChunkPack {
+public:
+    /**
+     * Abre el almacén y valida su tabla y los flags contra config.
+     */
+    bool open(const std::string& path, const Config& config);
+
+    /**
+     * Restaura un fragmento.
+     * @return true si el id existe y el fragmento se decodificó.
+     */
+    bool read(uint32_t id, const Config& config, FileData& out) const;
+
+private:
+    struct TableEntry {
+        uint64_t offset;
+        uint32_t raw_size;
+        uint32_t stored_size;
+    };
+    InputFile input;
+    unsigned char flags = 0;
+    std::vector<TableEntry> table;
+};
+
+/**
+ * Indica si un directorio contiene un almacén de fragmentos (salida de --dedup).
+ */
+bool is_dedup_directory(const std::string& path);
+
+/**
+ * Corta un archivo en fragmentos, los agrega al almacén y escribe su receta.
+ * @param bytes_in Recibe el tamaño del archivo.
+ * @param new_bytes Recibe los bytes de fragmentos que no estaban en el almacén.
+ * @return true si la receta se escribió.
+ */
+bool dedup_file(const std::string& input_file, const std::string& recipe_file, ChunkStore& store,
+                uint64_t& bytes_in, uint64_t& new_bytes);
+
+/**
+ * Reconstruye un archivo a partir de su receta.
+ * @return true si el archivo se restauró.
+ */
+bool restore_dedup_file(const std::string& recipe_file, const std::string& output_file, const ChunkPack& pack,
+                        const Config& config);
@@ -0,0 +1,246 @@
+#include "dictionary.hpp"
+#include "bytes.hpp"
+#include "fs_utils.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+using namespace std;
+
+static const unsigned char DICT_MAGIC[4] = {'G', 'S', 'D', 'C'};
+static const unsigned char DICT_VERSION = 1;
+static const size_t DICT_HEADER_SIZE = 12;
+
+// Largo de las secuencias contadas y de los segmentos elegidos
+static const size_t DMER_SIZE = 8;
+static const size_t SEGMENT_SIZE = 256;
+// Bits de las tablas de frecuencia (indexadas por hash de la secuencia)
+static const int FREQ_BITS = 22;
+// Rondas sobre las épocas mientras el diccionario no se llene
+static const int MAX_ROUNDS = 8;
+
+// Muestra: como máximo 256 veces el diccionario (hasta 64 MiB) y 128 KiB por archivo
+static const size_t SAMPLE_RATIO = 256;
+static const size_t SAMPLE_MAX = size_t(64) << 20;
+static const size_t SAMPLE_FILE_MAX = size_t(128) << 10;
+
+// =================================================================
+// ENTRENAMIENTO
+// =================================================================
+
+static inline uint32_t dmer_hash(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return static_cast<uint32_t>((v * 0x9E3779B185EBCA87ULL) >> (64 - FREQ_BITS));
+}
+
+// Segmento elegido: su puntaje y su ubicación en las muestras
+struct Segment {
+    uint64_t score;
+    size_t sample;
+    size_t offset;
+    size_t length;
+};
+
+/**
+ * Busca en la muestra el segmento con mayor suma de frecuencias, deslizando
+ * una ventana de SEGMENT_SIZE bytes (o la muestra completa si es menor).
+ */
+static void best_segment(const FileData& sample, size_t index, const vector<uint32_t>& freq, Segment& best) {
+    if (sample.size() < DMER_SIZE) return;
+    size_t window = min(SEGMENT_SIZE, sample.size());
+    size_t dmers = window - DMER_SIZE + 1;
+    const unsigned char* p = sample.data();
+
+    uint64_t score = 0;
+    for (size_t j = 0; j < dmers; ++j) score += freq[dmer_hash(p + j)];
+    if (score > best.score) best = {score, index, 0, window};
+
+    for (size_t start = 1; start + window <= sample.size(); ++start) {
+        score -= freq[dmer_hash(p + start - 1)];
+        score += freq[dmer_hash(p + start + dmers - 1)];
+        if (score > best.score) best = {score, index, start, window};
+    }
+}
+
+FileData build_dictionary(const vector<FileData>& samples, size_t dict_size) {
+    size_t total = 0;
+    for (const FileData& s : samples) total += s.size();
+    if (total == 0 || dict_size == 0) return {};
+
+    // Muestras que ya entran completas: el diccionario son las muestras mismas
+    if (total <= dict_size) {
+        FileData content;
+        content.reserve(total);
+        for (const FileData& s : samples) content.insert(content.end(), s.begin(), s.end());
+        return content;
+    }
+
+    // Frecuencia de documento: cuántas muestras contienen cada secuencia
+    vector<uint32_t> freq(size_t(1) << FREQ_BITS, 0);
+    vector<uint32_t> seen(size_t(1) << FREQ_BITS, 0);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const FileData& s = samples[i];
+        for (size_t j = 0; j + DMER_SIZE <= s.size(); ++j) {
+            uint32_t h = dmer_hash(s.data() + j);
+            if (seen[h] == i + 1) continue;
+            seen[h] = static_cast<uint32_t>(i + 1);
+            freq[h]++;
+        }
+    }
+    // Lo que aparece en un solo archivo no ayuda a los demás
+    for (uint32_t& f : freq) {
+        if (f < 2) f = 0;
+    }
+
+    // Épocas: grupos contiguos de muestras de tamaño parecido
+    size_t epochs = max<size_t>(1, dict_size / SEGMENT_SIZE);
+    // (la época e abarca las muestras [epoch_begin[e], epoch_begin[e + 1]))
+    vector<size_t> epoch_begin(epochs + 1, samples.size());
+    size_t offset = 0;
+    size_t next_epoch = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        size_t epoch = min(epochs - 1, offset * epochs / total);
+        while (next_epoch <= epoch) epoch_begin[next_epoch++] = i;
+        offset += samples[i].size();
+    }
+
+    vector<Segment> chosen;
+    size_t chosen_bytes = 0;
+    for (int round = 0; round < MAX_ROUNDS && chosen_bytes < dict_size; ++round) {
+        size_t added = 0;
+        for (size_t e = 0; e < epochs && chosen_bytes < dict_size; ++e) {
+            Segment best = {0, 0, 0, 0};
+            for (size_t i = epoch_begin[e]; i < epoch_begin[e + 1]; ++i) best_segment(samples[i], i, freq, best);
+            if (best.score == 0) continue;
+
+            // Las secuencias cubiertas dejan de sumar: el próximo segmento aporta contenido nuevo
+            const unsigned char* p = samples[best.sample].data() + best.offset;
+            for (size_t j = 0; j + DMER_SIZE <= best.length; ++j) freq[dmer_hash(p + j)] = 0;
+            chosen.push_back(best);
+            chosen_bytes += best.length;
+            added++;
+        }
+        if (added == 0) break;
+    }
+    if (chosen.empty()) return {};
+
+    // Los segmentos más valiosos al final, donde los offsets son más cortos
+    stable_sort(chosen.begin(), chosen.end(), [](const Segment& a, const Segment& b) { return a.score < b.score; });
+    FileData content;
+    content.reserve(chosen_bytes);
+    for (const Segment& s : chosen) {
+        const unsigned char* p = samples[s.sample].data() + s.offset;
+        content.insert(content.end(), p, p + s.length);
+    }
+    if (content.size() > dict_size) content.erase(content.begin(), content.end() - dict_size);
+    return content;
+}
+
+// Lee como máximo limit bytes del inicio de un archivo
+static bool read_prefix(const string& path, size_t limit, FileData& out) {
+    int fd = open_input_fd(path);
+    if (fd < 0) return false;
+    out.resize(min(limit, get_file_size(path)));
+    long got = out.empty() ? 0 : read_fully(fd, out.data(), out.size());
+    close_fd(fd);
+    if (got < 0) return false;
+    out.resize(static_cast<size_t>(got));
+    return true;
+}
+
+/**
+ * Elige las muestras repartidas por todo el directorio: primero un archivo
+ * cada step (en orden de ruta) y luego los intermedios, hasta llenar el presupuesto.
+ */
+static vector<FileData> collect_samples(vector<string>& files, size_t budget) {
+    sort(files.begin(), files.end());
+    vector<FileData> samples;
+    size_t step = max<size_t>(1, files.size() / 1024);
+    size_t used = 0;
+    for (size_t phase = 0; phase < step && used < budget; ++phase) {
+        for (size_t i = phase; i < files.size() && used < budget; i += step) {
+            FileData data;
+            if (!read_prefix(files[i], min(SAMPLE_FILE_MAX, budget - used), data) || data.empty()) continue;
+            used += data.size();
+            samples.push_back(move(data));
+        }
+    }
+    return samples;
+}
+
+bool train_dictionary(const Config& config, ThreadPool& pool) {
+    vector<string> files;
+    if (config.recursive) {
+        mutex files_mtx;
+        TaskGroup group(pool);
+        walk_directory_tree(config.input_path, group,
+            [](const string&) { return true; },
+            [&](const string& input_file, const string&) {
+                lock_guard<mutex> lock(files_mtx);
+                files.push_back(input_file);
+            });
+        group.wait();
+    } else {
+        files = list_directory(config.input_path);
+    }
+
+    size_t budget = min(SAMPLE_MAX, config.dict_size * SAMPLE_RATIO);
+    vector<FileData> samples = collect_samples(files, budget);
+    size_t sample_bytes = 0;
+    for (const FileData& s : samples) sample_bytes += s.size();
+    log_progress(config, "Entrenando diccionario con ", samples.size(), " de ", files.size(),
+                 " archivos (", sample_bytes, " bytes de muestra)");
+
+    FileData content = build_dictionary(samples, config.dict_size);
+    if (content.empty()) {
+        cerr << "ERROR DICCIONARIO: Los archivos de " << config.input_path << " no tienen contenido en común." << endl;
+        return false;
+    }
+    shared_ptr<const Dictionary> dict = make_dictionary(move(content));
+    if (!save_dictionary(config.output_path, *dict)) return false;
+
+    char id[9];
+    snprintf(id, sizeof(id), "%08x", dict->id);
+    log_progress(config, "Diccionario de ", dict->content.size(), " bytes (id ", id, ") guardado en: ",
+                 config.output_path);
+    return true;
+}
+
+// =================================================================
+// ARCHIVO DE DICCIONARIO
+// =================================================================
+
+bool save_dictionary(const string& path, const Dictionary& dict) {
+    FileData out;
+    out.reserve(DICT_HEADER_SIZE + dict.content.size());
+    out.insert(out.end(), DICT_MAGIC, DICT_MAGIC + 4);
+    out.push_back(DICT_VERSION);
+    out.insert(out.end(), 3, 0);
+    put_u32(out, dict.id);
+    out.insert(out.end(), dict.content.begin(), dict.content.end());
+    if (!write_file_posix(path, out)) {
+        cerr << "ERROR DICCIONARIO: No se pudo escribir: " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+shared_ptr<const Dictionary> load_dictionary(const string& path) {
+    FileData data = read_file_posix(path);
+    if (data.size() <= DICT_HEADER_SIZE || memcmp(data.data(), DICT_MAGIC, 4) != 0 || data[4] != DICT_VERSION ||
+        data.size() - DICT_HEADER_SIZE > (static_cast<size_t>(DICT_MAX_KB) << 10)) {
+        cerr << "ERROR DICCIONARIO: " << path << " no es un diccionario válido." << endl;
+        return nullptr;
+    }
+    uint32_t id = get_u32(data.data() + 8);
+    shared_ptr<const Dictionary> dict = make_dictionary(FileData(data.begin() + DICT_HEADER_SIZE, data.end()));
+    if (dict->id != id) {
+        cerr << "ERROR DICCIONARIO: " << path << " está dañado (el id no coincide con el contenido)." << endl;
+        return nullptr;
+    }
+    return dict;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "compress.hpp"
+#include "thread_pool.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Diccionarios entrenados para directorios de archivos pequeños y parecidos
+ * (configuraciones, registros JSON, fragmentos de logs). Sin diccionario
+ * cada archivo empieza con la ventana vacía y casi no tiene contra qué
+ * comparar; con --dict la ventana empieza con el diccionario.
+ *
+ * Entrenamiento (--train-dict): se toma una muestra repartida del directorio
+ * y se cuentan las secuencias de 8 bytes presentes en al menos dos archivos
+ * (cada archivo cuenta una vez por secuencia). La muestra se divide en
+ * épocas y de cada una se elige el segmento con más secuencias frecuentes
+ * aún no cubiertas; los segmentos elegidos se concatenan con los de mayor
+ * puntaje al final (los offsets más cortos son los más baratos).
+ *
+ * Archivo (enteros little-endian):
+ *   ["GSDC"] [Versión (1)] [Reservado (3)] [Id (4)] [Contenido]
+ */
+
+/**
+ * Construye el contenido de un diccionario a partir de muestras.
+ * @param samples Archivos (o prefijos de archivos) de muestra.
+ * @param dict_size Tamaño máximo del diccionario en bytes.
+ * @return Contenido del diccionario; vacío si las muestras no tienen nada en común.
+ */
+FileData build_dictionary(const std::vector<FileData>& samples, size_t dict_size);
+
+/**
+ * Guarda un diccionario en disco.
+ */
+bool save_dictionary(const std::string& path, const Dictionary& dict);
+
+/**
+ * Carga un diccionario y construye su índice.
+ * @return Diccionario, o nulo si el archivo no existe o no es válido.
+ */
+std::shared_ptr<const Dictionary> load_dictionary(const std::string& path);
+
+/**
+ * Entrena un diccionario de config.dict_size bytes con los archivos de
+ * config.input_path (con -r, también los subdirectorios) y lo guarda en
+ * config.output_path.
+ * @param pool Pool donde se recorren los subdirectorios.
+ * @return true si el diccionario se guardó.
+ */
+bool train_dictionary(const Config& config, ThreadPool& pool);
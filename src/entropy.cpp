@@ -0,0 +1,390 @@
+#include "entropy.hpp"
+#include "bytes.hpp"
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// Alfabeto de los valores numéricos: 0..15 directos y luego una cubeta por potencia de 2
+const int VALUE_DIRECT = 16;
+const int VALUE_ALPHABET = VALUE_DIRECT + 28;
+const int LITERAL_ALPHABET = 256;
+// Cada cuántos símbolos se verifica que el lector no se pasó del final
+const size_t OVERRUN_CHECK_INTERVAL = 4096;
+
+// Símbolo con sus bits extra (sin codificar)
+struct Coded {
+    uint16_t symbol;
+    uint8_t extra_bits;
+    uint32_t extra;
+};
+
+// Valor -> cubeta logarítmica: v < 16 directo; si no, cubeta por bit más alto + bits restantes
+Coded bucket(uint32_t v) {
+    if (v < static_cast<uint32_t>(VALUE_DIRECT)) return {static_cast<uint16_t>(v), 0, 0};
+    int n = 31 - __builtin_clz(v);
+    return {static_cast<uint16_t>(VALUE_DIRECT + n - 4), static_cast<uint8_t>(n), v - (1u << n)};
+}
+
+// =================================================================
+// E/S DE BITS (LSB PRIMERO)
+// =================================================================
+
+class BitWriter {
+public:
+    explicit BitWriter(FileData& out) : out(out) {}
+
+    void write(uint32_t value, int bits) {
+        acc |= uint64_t(value) << count;
+        count += bits;
+        while (count >= 8) {
+            out.push_back(static_cast<unsigned char>(acc));
+            acc >>= 8;
+            count -= 8;
+        }
+    }
+
+    void flush() {
+        if (count > 0) out.push_back(static_cast<unsigned char>(acc));
+        acc = 0;
+        count = 0;
+    }
+
+private:
+    FileData& out;
+    uint64_t acc = 0;
+    int count = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+    // Garantiza al menos 56 bits en el buffer (más allá del final se leen ceros)
+    void refill() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (pos + 8 <= size) {
+            uint64_t word;
+            memcpy(&word, data + pos, 8);
+            buffer |= word << avail;
+            size_t bytes = (63 - avail) >> 3;
+            pos += bytes;
+            avail += static_cast<int>(bytes * 8);
+            return;
+        }
+#endif
+        while (avail <= 56) {
+            uint64_t b = pos < size ? data[pos] : 0;
+            buffer |= b << avail;
+            pos++;
+            avail += 8;
+        }
+    }
+
+    uint32_t peek(int bits) const { return static_cast<uint32_t>(buffer & ((uint64_t(1) << bits) - 1)); }
+
+    void consume(int bits) {
+        buffer >>= bits;
+        avail -= bits;
+    }
+
+    uint32_t read(int bits) {
+        if (bits == 0) return 0;
+        refill();
+        uint32_t v = peek(bits);
+        consume(bits);
+        return v;
+    }
+
+    // true si se consumieron más bits de los que hay en la entrada
+    bool overrun() const { return pos * 8 - avail > size * 8; }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0;
+    uint64_t buffer = 0;
+    int avail = 0;
+};
+
+// =================================================================
+// CONSTRUCCIÓN DE CÓDIGOS HUFFMAN
+// =================================================================
+
+// Longitudes de código óptimas limitadas a max_bits (se reducen las
+// frecuencias a la mitad hasta que el árbol entra en el límite)
+vector<uint8_t> build_lengths(vector<uint64_t> freq, int max_bits) {
+    size_t n = freq.size();
+    vector<uint8_t> lengths(n, 0);
+
+    size_t used = count_if(freq.begin(), freq.end(), [](uint64_t f) { return f > 0; });
+    if (used == 0) return lengths;
+    if (used == 1) {
+        for (size_t i = 0; i < n; ++i) {
+            if (freq[i]) lengths[i] = 1;
+        }
+        return lengths;
+    }
+
+    while (true) {
+        // Nodos: hojas [0, n) e internos a continuación
+        vector<int> parent(2 * n, -1);
+        using Node = pair<uint64_t, int>;
+        priority_queue<Node, vector<Node>, greater<Node>> heap;
+        for (size_t i = 0; i < n; ++i) {
+            if (freq[i]) heap.push({freq[i], static_cast<int>(i)});
+        }
+        int next = static_cast<int>(n);
+        while (heap.size() > 1) {
+            Node a = heap.top(); heap.pop();
+            Node b = heap.top(); heap.pop();
+            parent[a.second] = next;
+            parent[b.second] = next;
+            heap.push({a.first + b.first, next++});
+        }
+
+        int max_len = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (!freq[i]) continue;
+            int depth = 0;
+            for (int p = parent[i]; p != -1; p = parent[p]) depth++;
+            lengths[i] = static_cast<uint8_t>(depth);
+            max_len = max(max_len, depth);
+        }
+        if (max_len <= max_bits) return lengths;
+
+        for (uint64_t& f : freq) {
+            if (f) f = (f + 1) / 2;
+        }
+    }
+}
+
+// Códigos canónicos (ordenados por longitud y símbolo), invertidos para escritura LSB primero
+vector<uint16_t> assign_codes(const vector<uint8_t>& lengths) {
+    int bl_count[HUF_MAX_BITS + 1] = {0};
+    for (uint8_t len : lengths) {
+        if (len) bl_count[len]++;
+    }
+    int next_code[HUF_MAX_BITS + 2] = {0};
+    int code = 0;
+    for (int bits = 1; bits <= HUF_MAX_BITS; ++bits) {
+        code = (code + bl_count[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+
+    vector<uint16_t> codes(lengths.size(), 0);
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        int len = lengths[i];
+        if (!len) continue;
+        int c = next_code[len]++;
+        int reversed = 0;
+        for (int b = 0; b < len; ++b) {
+            reversed = (reversed << 1) | ((c >> b) & 1);
+        }
+        codes[i] = static_cast<uint16_t>(reversed);
+    }
+    return codes;
+}
+
+// Tabla de decodificación: entrada = (símbolo << 4) | longitud (0 = inválida)
+vector<uint16_t> build_decode_table(const vector<uint8_t>& lengths) {
+    vector<uint16_t> codes = assign_codes(lengths);
+    vector<uint16_t> table(size_t(1) << HUF_MAX_BITS, 0);
+    for (size_t sym = 0; sym < lengths.size(); ++sym) {
+        int len = lengths[sym];
+        if (!len) continue;
+        for (size_t k = codes[sym]; k < table.size(); k += size_t(1) << len) {
+            table[k] = static_cast<uint16_t>((sym << 4) | len);
+        }
+    }
+    return table;
+}
+
+// =================================================================
+// FLUJOS
+// =================================================================
+
+/**
+ * Flujo: [Tamaño del alfabeto (varint)] [Longitudes, 4 bits c/u]
+ *        [Bytes del flujo de bits (varint)] [Bits: código + bits extra por símbolo]
+ */
+void encode_stream(const vector<Coded>& items, int alphabet, FileData& out) {
+    vector<uint64_t> freq(alphabet, 0);
+    for (const Coded& c : items) freq[c.symbol]++;
+    vector<uint8_t> lengths = build_lengths(freq, HUF_MAX_BITS);
+    vector<uint16_t> codes = assign_codes(lengths);
+
+    put_varint(out, alphabet);
+    for (int i = 0; i < alphabet; i += 2) {
+        uint8_t hi = (i + 1 < alphabet) ? lengths[i + 1] : 0;
+        out.push_back(static_cast<unsigned char>(lengths[i] | (hi << 4)));
+    }
+
+    // Buffer del hilo: conserva su capacidad entre flujos y archivos
+    thread_local FileData bits;
+    bits.clear();
+    BitWriter writer(bits);
+    for (const Coded& c : items) {
+        writer.write(codes[c.symbol], lengths[c.symbol]);
+        if (c.extra_bits) writer.write(c.extra, c.extra_bits);
+    }
+    writer.flush();
+
+    put_varint(out, bits.size());
+    out.insert(out.end(), bits.begin(), bits.end());
+    // Como el arena del hilo, no se conserva más de ARENA_KEEP_MB
+    if (bits.capacity() > (size_t(ARENA_KEEP_MB) << 20)) FileData().swap(bits);
+}
+
+/**
+ * Lector de un flujo: tabla de decodificación y lector de bits.
+ */
+class StreamDecoder {
+public:
+    StreamDecoder(ByteView in, size_t& pos, int expected_alphabet) {
+        uint64_t alphabet = get_varint(in, pos);
+        if (alphabet != static_cast<uint64_t>(expected_alphabet)) throw runtime_error("Alfabeto Huffman inválido.");
+        size_t table_bytes = (alphabet + 1) / 2;
+        if (table_bytes > in.size() - pos) throw runtime_error("Tabla Huffman incompleta.");
+
+        vector<uint8_t> lengths(alphabet);
+        for (size_t i = 0; i < alphabet; ++i) {
+            unsigned char b = in[pos + i / 2];
+            lengths[i] = (i % 2 == 0) ? (b & 0x0F) : (b >> 4);
+            if (lengths[i] > HUF_MAX_BITS) throw runtime_error("Longitud de código inválida.");
+        }
+        pos += table_bytes;
+
+        // Verificar la desigualdad de Kraft para no aceptar códigos imposibles
+        uint64_t kraft = 0;
+        for (uint8_t len : lengths) {
+            if (len) kraft += uint64_t(1) << (HUF_MAX_BITS - len);
+        }
+        if (kraft > (uint64_t(1) << HUF_MAX_BITS)) throw runtime_error("Tabla Huffman inválida.");
+        table = build_decode_table(lengths);
+
+        uint64_t bit_bytes = get_varint(in, pos);
+        if (bit_bytes > in.size() - pos) throw runtime_error("Flujo Huffman incompleto.");
+        reader = BitReader(in.data() + pos, bit_bytes);
+        pos += bit_bytes;
+    }
+
+    uint32_t symbol() {
+        reader.refill();
+        uint16_t entry = table[reader.peek(HUF_MAX_BITS)];
+        int len = entry & 0x0F;
+        if (len == 0) throw runtime_error("Código Huffman inválido.");
+        reader.consume(len);
+        return entry >> 4;
+    }
+
+    // Decodifica n símbolos de 8 bits; con 56 bits disponibles caben 4 códigos por recarga
+    void bytes(unsigned char* out, size_t n) {
+        size_t i = 0;
+        while (i < n) {
+            if (i % OVERRUN_CHECK_INTERVAL == 0) check();
+            reader.refill();
+            size_t batch = min<size_t>(4, n - i);
+            for (size_t k = 0; k < batch; ++k) {
+                uint16_t entry = table[reader.peek(HUF_MAX_BITS)];
+                int len = entry & 0x0F;
+                if (len == 0) throw runtime_error("Código Huffman inválido.");
+                reader.consume(len);
+                out[i++] = static_cast<unsigned char>(entry >> 4);
+            }
+        }
+        check();
+    }
+
+    uint32_t value() {
+        uint32_t sym = symbol();
+        if (sym < static_cast<uint32_t>(VALUE_DIRECT)) return sym;
+        int n = static_cast<int>(sym) - VALUE_DIRECT + 4;
+        return (1u << n) + reader.read(n);
+    }
+
+    void check() const {
+        if (reader.overrun()) throw runtime_error("Flujo Huffman truncado.");
+    }
+
+private:
+    vector<uint16_t> table;
+    BitReader reader{nullptr, 0};
+};
+
+} // namespace
+
+// =================================================================
+// API PÚBLICA
+// =================================================================
+
+void encode_sequences_huf(const vector<Lz77Sequence>& sequences, ByteView literals, FileData& out) {
+    put_varint(out, sequences.size());
+    put_varint(out, literals.size());
+
+    // Reutilizado entre llamadas del mismo hilo (crece hasta el archivo más grande)
+    thread_local vector<Coded> items;
+    items.clear();
+    items.reserve(max(literals.size(), sequences.size()));
+
+    // 1. Literales
+    for (unsigned char c : literals) items.push_back({c, 0, 0});
+    encode_stream(items, LITERAL_ALPHABET, out);
+
+    // 2. Corridas de literales
+    items.clear();
+    for (const Lz77Sequence& s : sequences) items.push_back(bucket(s.literal_run));
+    encode_stream(items, VALUE_ALPHABET, out);
+
+    // 3. Longitudes de coincidencia (0 = sin coincidencia, si no longitud - 2)
+    items.clear();
+    for (const Lz77Sequence& s : sequences) items.push_back(bucket(s.match_length ? s.match_length - 2 : 0));
+    encode_stream(items, VALUE_ALPHABET, out);
+
+    // 4. Offsets - 1 (solo de las secuencias con coincidencia)
+    items.clear();
+    for (const Lz77Sequence& s : sequences) {
+        if (s.match_length) items.push_back(bucket(s.offset - 1));
+    }
+    encode_stream(items, VALUE_ALPHABET, out);
+    if (items.capacity() * sizeof(Coded) > (size_t(ARENA_KEEP_MB) << 20)) vector<Coded>().swap(items);
+}
+
+void decode_sequences_huf(ByteView in, size_t& pos, vector<Lz77Sequence>& sequences, FileData& literals) {
+    uint64_t sequence_count = get_varint(in, pos);
+    uint64_t literal_count = get_varint(in, pos);
+
+    StreamDecoder literal_stream(in, pos, LITERAL_ALPHABET);
+    StreamDecoder run_stream(in, pos, VALUE_ALPHABET);
+    StreamDecoder length_stream(in, pos, VALUE_ALPHABET);
+    StreamDecoder offset_stream(in, pos, VALUE_ALPHABET);
+
+    // Cada símbolo ocupa al menos un bit: cantidades mayores indican datos corruptos
+    if (literal_count > in.size() * 8 || sequence_count > in.size() * 8) {
+        throw runtime_error("Cantidad de símbolos inválida.");
+    }
+
+    literals.resize(literal_count);
+    literal_stream.bytes(literals.data(), literals.size());
+
+    sequences.resize(sequence_count);
+    for (size_t i = 0; i < sequence_count; ++i) {
+        Lz77Sequence& s = sequences[i];
+        s.literal_run = run_stream.value();
+        uint32_t length = length_stream.value();
+        s.match_length = length ? length + 2 : 0;
+        s.offset = length ? offset_stream.value() + 1 : 0;
+        if (i % OVERRUN_CHECK_INTERVAL == 0) {
+            run_stream.check();
+            length_stream.check();
+            offset_stream.check();
+        }
+    }
+    run_stream.check();
+    length_stream.check();
+    offset_stream.check();
+}
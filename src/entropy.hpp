@@ -0,0 +1,46 @@
+#pragma once
+
+#include "constantes.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Etapa de codificación de entropía (Huffman canónico) para LZ77.
+ * Las secuencias LZ77 se separan en cuatro flujos codificados de forma
+ * independiente: literales, longitudes de corridas de literales, longitudes
+ * de coincidencia y offsets. Los valores numéricos se agrupan en cubetas
+ * logarítmicas (código Huffman de la cubeta + bits extra sin codificar).
+ * La decodificación usa una tabla de 2^HUF_MAX_BITS entradas (una consulta
+ * por símbolo).
+ */
+
+// Longitud máxima de un código Huffman (tamaño de la tabla de decodificación)
+const int HUF_MAX_BITS = 11;
+
+// Corrida de literales seguida (opcionalmente) de una coincidencia
+struct Lz77Sequence {
+    uint32_t literal_run;  // Literales antes de la coincidencia
+    uint32_t match_length; // 0 = sin coincidencia
+    uint32_t offset;       // Distancia de la coincidencia (si match_length > 0)
+};
+
+// Corrida de literales máxima por secuencia (las más largas se dividen)
+const uint32_t HUF_MAX_LITERAL_RUN = (1u << 24) - 1;
+
+/**
+ * Codifica las secuencias y sus literales y los agrega a out.
+ * @param sequences Secuencias en orden.
+ * @param literals Todos los literales concatenados.
+ * @param out Destino.
+ */
+void encode_sequences_huf(const std::vector<Lz77Sequence>& sequences, ByteView literals, FileData& out);
+
+/**
+ * Decodifica los flujos escritos por encode_sequences_huf.
+ * Lanza std::runtime_error si los datos están corruptos.
+ * @param in Datos de entrada.
+ * @param pos Posición de inicio; recibe la posición final.
+ * @param sequences Recibe las secuencias.
+ * @param literals Recibe los literales concatenados.
+ */
+void decode_sequences_huf(ByteView in, size_t& pos, std::vector<Lz77Sequence>& sequences, FileData& literals);
@@ -1,6 +1,8 @@
 #include "fs_utils.hpp"
 #include <iostream>
 #include <cstring>
+#include <cerrno>
+#include <memory>
 
 // Cabeceras POSIX para E/S de bajo nivel y manejo de directorios
 #include <sys/types.h>
@@ -8,6 +10,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <sys/mman.h>
 
 using namespace std;
 
@@ -50,7 +53,71 @@ FileData read_file_posix(const string& filename) {
     return data;
 }
 
-bool write_file_posix(const string& filename, const FileData& data) {
+// =================================================================
+// ENTRADA MAPEADA EN MEMORIA
+// =================================================================
+
+InputFile::~InputFile() {
+    if (mapped != nullptr) {
+        munmap(mapped, mapped_size);
+    }
+}
+
+bool InputFile::open(const string& filename, FileData* reuse) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "ERROR: No se pudo abrir el archivo de entrada: " << filename << endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        cerr << "ERROR: No se pudo obtener el estado del archivo: " << filename << endl;
+        ::close(fd);
+        return false;
+    }
+
+    // Archivos pequeños: una sola lectura al buffer reutilizable
+    size_t size = static_cast<size_t>(st.st_size);
+    if (reuse != nullptr && S_ISREG(st.st_mode) && size > 0 && size <= (size_t(SMALL_FILE_READ_KB) << 10)) {
+        reuse->resize(size);
+        long got = read_fully(fd, reuse->data(), size);
+        ::close(fd);
+        if (got < 0) {
+            cerr << "ERROR: Error de lectura del archivo: " << filename << endl;
+            return false;
+        }
+        reuse->resize(static_cast<size_t>(got));
+        borrowed = reuse;
+        return !reuse->empty();
+    }
+
+    // Solo los archivos regulares no vacíos se mapean; el resto usa read()
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            mapped = addr;
+            mapped_size = st.st_size;
+            ::close(fd);
+            return true;
+        }
+    }
+    ::close(fd);
+
+    buffer = read_file_posix(filename);
+    return !buffer.empty();
+}
+
+ByteView InputFile::view() const {
+    if (mapped != nullptr) {
+        return ByteView(static_cast<const unsigned char*>(mapped), mapped_size);
+    }
+    if (borrowed != nullptr) return ByteView(*borrowed);
+    return ByteView(buffer);
+}
+
+bool write_file_posix(const string& filename, ByteView data) {
     // O_CREAT | O_TRUNC | Permisos 0600
     int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
     if (fd < 0) {
@@ -58,18 +125,69 @@ bool write_file_posix(const string& filename, const FileData& data) {
         return false;
     }
 
+    // Reservar el tamaño final; si el sistema de archivos no lo soporta se continúa igual
+    if (!data.empty()) {
+        fallocate(fd, 0, 0, data.size());
+    }
+
+    if (!write_fully(fd, data.data(), data.size())) {
+        cerr << "ERROR: Error de escritura del archivo: " << filename << endl;
+        close(fd);
+        return false;
+    }
+
+    close(fd);
+    return true;
+}
+
+int open_input_fd(const string& filename) {
+    if (filename == "-") return STDIN_FILENO;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "ERROR: No se pudo abrir el archivo de entrada: " << filename << endl;
+    }
+    return fd;
+}
+
+int open_output_fd(const string& filename) {
+    if (filename == "-") return STDOUT_FILENO;
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        cerr << "ERROR: No se pudo abrir/crear el archivo de salida: " << filename << endl;
+    }
+    return fd;
+}
+
+void close_fd(int fd) {
+    if (fd > STDERR_FILENO) close(fd);
+}
+
+long read_fully(int fd, unsigned char* buffer, size_t size) {
+    size_t total_read = 0;
+    while (total_read < size) {
+        ssize_t bytes_read = read(fd, buffer + total_read, size - total_read);
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        total_read += bytes_read;
+    }
+    return static_cast<long>(total_read);
+}
+
+bool write_fully(int fd, const unsigned char* buffer, size_t size) {
     size_t total_written = 0;
-    while (total_written < data.size()) {
-        ssize_t bytes_written = write(fd, data.data() + total_written, data.size() - total_written);
+    while (total_written < size) {
+        ssize_t bytes_written = write(fd, buffer + total_written, size - total_written);
         if (bytes_written < 0) {
-            cerr << "ERROR: Error de escritura del archivo: " << filename << endl;
-            close(fd);
+            if (errno == EINTR) continue;
             return false;
         }
         total_written += bytes_written;
     }
-
-    close(fd);
     return true;
 }
 
@@ -81,6 +199,141 @@ bool is_directory(const string& path) {
     return S_ISDIR(st.st_mode);
 }
 
+bool make_directories(const string& path) {
+    for (size_t pos = path.find('/', 1);; pos = path.find('/', pos + 1)) {
+        string prefix = pos == string::npos ? path : path.substr(0, pos);
+        if (mkdir(prefix.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) != 0 && errno != EEXIST) {
+            cerr << "ERROR: No se pudo crear el directorio: " << prefix << endl;
+            return false;
+        }
+        if (pos == string::npos) return true;
+    }
+}
+
+bool is_safe_relative_path(const string& path) {
+    if (path.empty() || path[0] == '/' || path.find('\0') != string::npos) return false;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == string::npos) end = path.size();
+        string part = path.substr(start, end - start);
+        if (part.empty() || part == "." || part == "..") return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+size_t get_file_size(const string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(st.st_size);
+}
+
+namespace {
+
+// Clase de una entrada de directorio
+enum class EntryKind { File, Directory, Other };
+
+/**
+ * Determina la clase de una entrada usando d_type. Solo si el sistema de
+ * archivos no lo informa (DT_UNKNOWN) o la entrada es un enlace simbólico
+ * se consulta fstatat relativo al descriptor del directorio, sin armar la ruta.
+ * Los enlaces a directorios no se siguen para evitar ciclos.
+ */
+EntryKind entry_kind(int dir_fd, const struct dirent* entry) {
+    switch (entry->d_type) {
+        case DT_REG: return EntryKind::File;
+        case DT_DIR: return EntryKind::Directory;
+        case DT_UNKNOWN:
+        case DT_LNK: break;
+        default: return EntryKind::Other;
+    }
+
+    struct stat st;
+    if (fstatat(dir_fd, entry->d_name, &st, 0) != 0) return EntryKind::Other;
+    if (S_ISREG(st.st_mode)) return EntryKind::File;
+    if (S_ISDIR(st.st_mode) && entry->d_type != DT_LNK) return EntryKind::Directory;
+    return EntryKind::Other;
+}
+
+// Ignorar "." y ".."
+bool is_dot_entry(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/**
+ * Recorrido paralelo: cada directorio se lee en un trabajo del grupo y sus
+ * subdirectorios se encolan como trabajos nuevos. Los trabajos comparten
+ * el recorredor mediante shared_ptr, que vive hasta que termina el último.
+ */
+class TreeWalker : public enable_shared_from_this<TreeWalker> {
+public:
+    TreeWalker(const string& root, TaskGroup& group, DirCallback on_dir, FileCallback on_file, const string& exclude)
+        : root(root), group(group), on_dir(move(on_dir)), on_file(move(on_file)) {
+        struct stat st;
+        skip = !exclude.empty() && stat(exclude.c_str(), &st) == 0;
+        if (skip) {
+            skip_dev = st.st_dev;
+            skip_ino = st.st_ino;
+        }
+    }
+
+    void submit(const string& relative) {
+        auto self = shared_from_this();
+        group.submit([self, relative]() { self->scan(relative); });
+    }
+
+private:
+    void scan(const string& relative) {
+        string dir_path = relative.empty() ? root : root + "/" + relative;
+        DIR* dir = opendir(dir_path.c_str());
+        if (dir == nullptr) {
+            cerr << "ERROR: No se pudo abrir el directorio: " << dir_path << endl;
+            return;
+        }
+
+        int dir_fd = dirfd(dir);
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (is_dot_entry(entry->d_name)) continue;
+
+            EntryKind kind = entry_kind(dir_fd, entry);
+            if (kind == EntryKind::Other || is_excluded(dir_fd, entry, kind)) continue;
+
+            string child = relative.empty() ? string(entry->d_name) : relative + "/" + entry->d_name;
+            if (kind == EntryKind::File) {
+                on_file(dir_path + "/" + entry->d_name, child);
+            } else if (on_dir(child)) {
+                submit(child);
+            }
+        }
+        closedir(dir);
+    }
+
+    /**
+     * Indica si la entrada es la excluida. Para archivos, d_ino descarta casi
+     * todas sin fstatat; los directorios se consultan siempre porque en un
+     * punto de montaje d_ino no coincide con el inodo montado.
+     */
+    bool is_excluded(int dir_fd, const struct dirent* entry, EntryKind kind) const {
+        if (!skip || (kind == EntryKind::File && entry->d_ino != skip_ino)) return false;
+        struct stat st;
+        return fstatat(dir_fd, entry->d_name, &st, 0) == 0 && st.st_dev == skip_dev && st.st_ino == skip_ino;
+    }
+
+    string root;
+    TaskGroup& group;
+    DirCallback on_dir;
+    FileCallback on_file;
+    bool skip = false; // Hay una entrada excluida (skip_dev, skip_ino)
+    dev_t skip_dev = 0;
+    ino_t skip_ino = 0;
+};
+
+} // namespace
+
 vector<string> list_directory(const string& path) {
     vector<string> files;
     DIR *dir = opendir(path.c_str());
@@ -89,19 +342,26 @@ vector<string> list_directory(const string& path) {
         return files;
     }
 
+    int dir_fd = dirfd(dir);
     struct dirent *entry;
     while ((entry = readdir(dir)) != nullptr) {
-        // Ignorar "." y ".."
-        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
-            string full_path = path + "/" + entry->d_name;
-            struct stat st;
-            // Verificar si es un archivo regular
-            if (stat(full_path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
-                files.push_back(full_path);
-            }
+        // Solo archivos regulares (d_type, o fstatat si no se conoce)
+        if (!is_dot_entry(entry->d_name) && entry_kind(dir_fd, entry) == EntryKind::File) {
+            files.push_back(path + "/" + entry->d_name);
         }
     }
 
     closedir(dir);
     return files;
 }
+
+void walk_directory_tree(const string& root, TaskGroup& group, DirCallback on_dir, FileCallback on_file,
+                         const string& exclude) {
+    make_shared<TreeWalker>(root, group, move(on_dir), move(on_file), exclude)->submit("");
+}
+
+bool same_file(const string& a, const string& b) {
+    struct stat st_a, st_b;
+    return stat(a.c_str(), &st_a) == 0 && stat(b.c_str(), &st_b) == 0 &&
+           st_a.st_dev == st_b.st_dev && st_a.st_ino == st_b.st_ino;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "constantes.hpp"
+#include "thread_pool.hpp"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -11,13 +13,87 @@
  */
 FileData read_file_posix(const std::string& filename);
 
+/**
+ * Archivo de entrada accesible como una vista de bytes sin copias.
+ * Los archivos regulares se mapean con mmap (con madvise SEQUENTIAL);
+ * las tuberías y archivos especiales se leen con read() a un buffer.
+ * Con un buffer reutilizable, los archivos pequeños se leen en él: para
+ * pocos KiB, mmap/munmap y los fallos de página cuestan más que la copia.
+ */
+class InputFile {
+public:
+    InputFile() = default;
+    ~InputFile();
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    /**
+     * Abre y mapea (o lee) el archivo completo.
+     * @param filename Ruta del archivo.
+     * @param reuse Si no es nulo, los archivos regulares de hasta
+     *        SMALL_FILE_READ_KB KiB se leen en este buffer (debe vivir mientras se use view()).
+     * @return true si el contenido está disponible en view().
+     */
+    bool open(const std::string& filename, FileData* reuse = nullptr);
+
+    /**
+     * @return Vista del contenido del archivo.
+     */
+    ByteView view() const;
+
+    /**
+     * @return true si el contenido proviene de mmap.
+     */
+    bool is_mapped() const { return mapped != nullptr; }
+
+private:
+    void* mapped = nullptr;
+    size_t mapped_size = 0;
+    const FileData* borrowed = nullptr;
+    FileData buffer;
+};
+
 /**
  * Escribe datos en un archivo usando llamadas de sistema POSIX.
+ * El espacio se reserva de antemano con fallocate para evitar que el
+ * archivo crezca de a poco durante la escritura.
  * @param filename Ruta del archivo de salida.
  * @param data Datos binarios a escribir.
  * @return true si la escritura fue exitosa, false en caso contrario.
  */
-bool write_file_posix(const std::string& filename, const FileData& data);
+bool write_file_posix(const std::string& filename, ByteView data);
+
+/**
+ * Abre un archivo de entrada para lectura secuencial.
+ * @param filename Ruta del archivo, o "-" para la entrada estándar.
+ * @return Descriptor de archivo, o -1 en caso de error.
+ */
+int open_input_fd(const std::string& filename);
+
+/**
+ * Abre (crea o trunca) un archivo de salida para escritura secuencial.
+ * @param filename Ruta del archivo, o "-" para la salida estándar.
+ * @return Descriptor de archivo, o -1 en caso de error.
+ */
+int open_output_fd(const std::string& filename);
+
+/**
+ * Cierra un descriptor abierto con open_input_fd/open_output_fd
+ * (la entrada y salida estándar no se cierran).
+ */
+void close_fd(int fd);
+
+/**
+ * Lee hasta size bytes, reintentando lecturas parciales.
+ * @return Bytes leídos (menos de size solo al llegar al final), o -1 en caso de error.
+ */
+long read_fully(int fd, unsigned char* buffer, size_t size);
+
+/**
+ * Escribe size bytes, reintentando escrituras parciales.
+ * @return true si se escribieron todos los bytes.
+ */
+bool write_fully(int fd, const unsigned char* buffer, size_t size);
 
 /**
  * Determina si la ruta es un directorio.
@@ -26,9 +102,59 @@ bool write_file_posix(const std::string& filename, const FileData& data);
  */
 bool is_directory(const std::string& path);
 
+/**
+ * Crea un directorio y todos sus padres que no existan (como mkdir -p).
+ * @param path Ruta del directorio.
+ * @return true si el directorio existe o se creó.
+ */
+bool make_directories(const std::string& path);
+
+/**
+ * Indica si una ruta es relativa y no tiene componentes vacíos, "." ni ".."
+ * (no puede salir del directorio al que se agrega).
+ * @param path Ruta a validar (por ejemplo, leída de un archivo sólido o un manifiesto).
+ */
+bool is_safe_relative_path(const std::string& path);
+
+/**
+ * Obtiene el tamaño de un archivo.
+ * @param path Ruta del archivo.
+ * @return Tamaño en bytes, o 0 si no se pudo obtener.
+ */
+size_t get_file_size(const std::string& path);
+
 /**
  * Lista los archivos regulares en un directorio.
  * @param path Ruta del directorio.
  * @return Vector de rutas absolutas de archivos regulares.
  */
-std::vector<std::string> list_directory(const std::string& path);
\ No newline at end of file
+std::vector<std::string> list_directory(const std::string& path);
+
+// Se llama por cada subdirectorio (ruta relativa) antes de recorrerlo; false lo omite
+using DirCallback = std::function<bool(const std::string& relative)>;
+// Se llama por cada archivo regular con su ruta completa y su ruta relativa a la raíz
+using FileCallback = std::function<void(const std::string& path, const std::string& relative)>;
+
+/**
+ * Recorre recursivamente un árbol de directorios en paralelo sobre un grupo del pool.
+ * Cada directorio se lee en un trabajo propio y on_file se llama apenas se
+ * encuentra cada archivo, de modo que el procesamiento puede comenzar
+ * mientras el recorrido continúa. Los tipos de entrada se toman de d_type
+ * (fstatat relativo al directorio solo si no se conoce); los enlaces a
+ * directorios no se siguen. Las funciones se llaman desde varios hilos.
+ * La función retorna de inmediato: el llamador espera con group.wait().
+ * @param root Directorio raíz.
+ * @param group Grupo donde se ejecuta el recorrido.
+ * @param on_dir Llamada por cada subdirectorio encontrado.
+ * @param on_file Llamada por cada archivo regular encontrado.
+ * @param exclude Directorio o archivo que no se visita (por ejemplo, la salida
+ *        dentro de root); se compara por dispositivo e inodo. Vacío = ninguno.
+ */
+void walk_directory_tree(const std::string& root, TaskGroup& group, DirCallback on_dir, FileCallback on_file,
+                         const std::string& exclude = "");
+
+/**
+ * Indica si dos rutas existentes son el mismo archivo o directorio
+ * (mismo dispositivo e inodo), sin importar cómo estén escritas.
+ */
+bool same_file(const std::string& a, const std::string& b);
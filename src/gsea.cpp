@@ -1,123 +1,18 @@
 #include <iostream>
 #include <string>
-#include <map>
-#include <thread>
-#include <sstream>
-#include <algorithm>
 #include <vector>
-#include <cstring>
-#include <cstdlib>
-#include <sys/stat.h> 
-#include <errno.h>    
-
 
 // Inclusión de módulos
 #include "constantes.hpp"
-#include "crypto.hpp"
-#include "compress.hpp"
-#include "fs_utils.hpp"
+#include "batch.hpp"
+#include "cli.hpp"
+#include "dedup.hpp"
+#include "dictionary.hpp"
+#include "manifest.hpp"
+#include "metrics.hpp"
 
 using namespace std;
 
-// =================================================================
-// LÓGICA DE PROCESAMIENTO
-// =================================================================
-
-/**
- * Función worker para procesar un solo archivo.
- * Llama a las funciones de compresión/encriptación en el orden correcto.
- */
-void process_file(const string& input_file, const string& output_file, const Config& config) {
-    cout << "  [HILO] Procesando: " << input_file << " -> " << output_file << endl;
-
-    FileData data = read_file_posix(input_file);
-    if (data.empty()) {
-        cerr << "  [HILO] ERROR: Falló la lectura o el archivo está vacío: " << input_file << endl;
-        return;
-    }
-
-    FileData processed_data = data;
-
-    // 1. Desencriptar (si -u)
-    if (config.decrypt) {
-        processed_data = decrypt_vigenere(processed_data, config.key);
-        cout << "  [HILO] Desencriptado (Vigenere): " << input_file << endl;
-    }
-
-    // 2. Descomprimir (si -d)
-    if (config.decompress) {
-        processed_data = decompress_lz77(processed_data);
-        if (processed_data.empty()) {
-            cerr << "  [HILO] ERROR: Falló la descompresión LZ77 de: " << input_file << endl;
-            return;
-        }
-        cout << "  [HILO] Descomprimido (LZ77): " << input_file << endl;
-    }
-
-    // 3. Comprimir (si -c)
-    if (config.compress) {
-        processed_data = compress_lz77(processed_data);
-        cout << "  [HILO] Comprimido (LZ77): " << input_file << endl;
-    }
-
-    // 4. Encriptar (si -e)
-    if (config.encrypt) {
-        processed_data = encrypt_vigenere(processed_data, config.key);
-        cout << "  [HILO] Encriptado (Vigenere): " << input_file << endl;
-    }
-
-    // Escribir el resultado
-    if (write_file_posix(output_file, processed_data)) {
-        cout << "  [HILO] Éxito. Resultado guardado en: " << output_file << endl;
-    } else {
-        cerr << "  [HILO] ERROR: Falló la escritura en el archivo de salida: " << output_file << endl;
-    }
-}
-
-/**
- * Procesa todos los archivos en un directorio usando hilos (Concurrencia).
- */
-void process_directory(const Config& config) {
-    cout << "--- Modo Directorio: Iniciando procesamiento concurrente ---" << endl;
-    
-    // Crear el directorio de salida si no existe
-    int res = mkdir(config.output_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-    if (res != 0 && errno != EEXIST) {
-        cerr << "ERROR: No se pudo crear el directorio de salida: " << config.output_path << endl;
-        return;
-    }
-
-    vector<string> input_files = list_directory(config.input_path);
-    if (input_files.empty()) {
-        cout << "No se encontraron archivos regulares para procesar en: " << config.input_path << endl;
-        return;
-    }
-
-    vector<thread> workers;
-    for (const string& input_file : input_files) {
-        // Extraer el nombre del archivo para la salida
-        size_t last_slash = input_file.find_last_of('/');
-        string filename = (last_slash == string::npos) ? input_file : input_file.substr(last_slash + 1);
-        
-        // Agregar sufijo a la salida (esto es simplificado; un sistema robusto usaría metadatos)
-        string suffix = (config.compress ? ".lz77" : (config.encrypt ? ".enc" : ""));
-        string output_file = config.output_path + "/" + filename + suffix;
-
-        // Lanzar un hilo para cada archivo
-        // Usamos std::ref para pasar la configuración por referencia constante
-        workers.emplace_back(process_file, input_file, output_file, std::ref(config));
-    }
-
-    // Esperar a que todos los hilos terminen (join)
-    for (auto& worker : workers) {
-        if (worker.joinable()) {
-            worker.join();
-        }
-    }
-
-    cout << "--- Procesamiento concurrente de directorios finalizado ---" << endl;
-}
-
 // =================================================================
 // PARSEO DE ARGUMENTOS Y FUNCIÓN MAIN
 // =================================================================
@@ -127,110 +22,107 @@ void show_help(const string& program_name) {
     cout << "\nOperaciones:" << endl;
     cout << "  -c          Comprimir (" << COMP_ALG_LZ77 << ")" << endl;
     cout << "  -d          Descomprimir (" << COMP_ALG_LZ77 << ")" << endl;
-    cout << "  -e          Encriptar (" << ENC_ALG_VIGENERE << ")" << endl;
-    cout << "  -u          Desencriptar (" << ENC_ALG_VIGENERE << ")" << endl;
+    cout << "  -e          Encriptar (" << ENC_ALG_VIGENERE << " o " << ENC_ALG_CHACHA20 << ")" << endl;
+    cout << "  -u          Desencriptar (" << ENC_ALG_VIGENERE << " o " << ENC_ALG_CHACHA20 << ")" << endl;
     cout << "  NOTA: Las operaciones se realizan en el siguiente orden: Desencriptar -> Descomprimir -> Comprimir -> Encriptar." << endl;
     cout << "\nArgumentos obligatorios:" << endl;
-    cout << "  -i <ruta>   Ruta del archivo o directorio de entrada." << endl;
-    cout << "  -o <ruta>   Ruta del archivo o directorio de salida." << endl;
+    cout << "  -i <ruta>   Ruta del archivo o directorio de entrada (\"-\" para la entrada estándar)." << endl;
+    cout << "  -o <ruta>   Ruta del archivo o directorio de salida (\"-\" para la salida estándar)." << endl;
     cout << "\nArgumentos opcionales:" << endl;
     cout << "  -k <clave>  Clave secreta para operaciones de encriptación/desencriptación." << endl;
-    cout << "  --comp-alg <alg>  Algoritmo de compresión (Actual: " << COMP_ALG_LZ77 << ")." << endl;
-    cout << "  --enc-alg <alg>   Algoritmo de encriptación (Actual: " << ENC_ALG_VIGENERE << ")." << endl;
+    cout << "  --comp-alg <alg>  Algoritmo de compresión: " << COMP_ALG_LZ77 << " (Predeterminado) o "
+         << COMP_ALG_LZ77_HUF << " (con etapa de entropía). La descompresión detecta el formato." << endl;
+    cout << "  --enc-alg <alg>   Algoritmo de encriptación: " << ENC_ALG_VIGENERE << " (Predeterminado) o "
+         << ENC_ALG_CHACHA20 << " (cifrado de flujo con nonce por archivo y clave derivada de -k con PBKDF2). La desencriptación detecta ChaCha20." << endl;
+    cout << "  -1 ... -9   Nivel de compresión: -1 más rápido, -9 mejor relación (Predeterminado: -" << LZ77_DEFAULT_LEVEL << ")." << endl;
+    cout << "  --level <n> Igual que -1 ... -9." << endl;
+    cout << "  --chain <n>       Profundidad máxima de la cadena de hash de LZ77 (Predeterminado: la del nivel)." << endl;
+    cout << "  --train-dict      Entrena un diccionario con los archivos del directorio -i y lo guarda en -o." << endl;
+    cout << "  --dict-size <KiB> Tamaño del diccionario a entrenar (" << DICT_MIN_KB << "-" << DICT_MAX_KB
+         << ", Predeterminado: " << DICT_DEFAULT_KB << ")." << endl;
+    cout << "  --dict <ruta>     Con -c precarga el diccionario en la ventana de cada archivo; con -d es" << endl;
+    cout << "                    necesario para los archivos comprimidos con él (se verifica su id)." << endl;
+    cout << "  --block-size <MiB> Divide cada archivo en bloques independientes procesados en paralelo ("
+         << BLOCK_SIZE_MIN_MB << "-" << BLOCK_SIZE_MAX_MB << " MiB)." << endl;
+    cout << "  -r          Procesa también los subdirectorios y replica su estructura en la salida." << endl;
+    cout << "  --archive   Empaqueta el directorio de entrada en un único archivo sólido (-o es un archivo)." << endl;
+    cout << "  --member <ruta> Al extraer un archivo sólido (-d/-u), extrae solo ese miembro en -o." << endl;
+    cout << "  --range <offset:len> Con -d/-u, extrae solo ese rango de bytes de un contenedor por bloques" << endl;
+    cout << "              o de un archivo encriptado con " << ENC_ALG_CHACHA20 << " (solo -u)." << endl;
+    cout << "  --stream    Procesa por fragmentos con memoria constante (implícito con -i - / -o -)." << endl;
+    cout << "  -j <n>      Número de hilos de trabajo (Predeterminado: núcleos disponibles)." << endl;
+    cout << "  --max-inflight <MiB> Máximo de bytes de entrada cargados a la vez en modo directorio (Predeterminado: "
+         << DEFAULT_MAX_INFLIGHT_MB << ", 0 = sin límite)." << endl;
+    cout << "  --io-uring  En modo directorio, lee y escribe con E/S asíncrona io_uring (Linux), superponiendo" << endl;
+    cout << "              la E/S con el cómputo; si el kernel no lo permite se usa E/S POSIX." << endl;
+    cout << "  --queue-depth <n> Operaciones de E/S en vuelo con --io-uring (Predeterminado: " << DEFAULT_QUEUE_DEPTH << ")." << endl;
+    cout << "  --dedup     En modo directorio, guarda una sola vez los fragmentos repetidos entre archivos" << endl;
+    cout << "              (almacén " << CHUNK_STORE_FILE << " y una receta por archivo en la salida)." << endl;
+    cout << "  --incremental En modo directorio, omite los archivos sin cambios desde la ejecución anterior" << endl;
+    cout << "              (manifiesto " << MANIFEST_FILE << " en el directorio de salida)." << endl;
+    cout << "  --prune     Con --incremental, elimina las salidas de los archivos de entrada borrados." << endl;
+    cout << "  --quiet     No muestra mensajes de progreso por archivo (solo errores)." << endl;
+    cout << "  --stats <ruta> Escribe métricas por archivo y etapa (tiempos, bytes, ratio, espera en cola):" << endl;
+    cout << "              CSV si la ruta termina en .csv, JSON en otro caso (\"-\" para la salida estándar)." << endl;
+    cout << "\nLote y servicio (cada trabajo es una línea con las opciones de arriba, ej.: -c -i a.txt -o a.lz77):" << endl;
+    cout << "  --batch <ruta>    Ejecuta los trabajos del manifiesto (\"-\" para la entrada estándar) en un pool" << endl;
+    cout << "              de -j hilos y escribe una línea JSON por trabajo (estado, espera y tiempo)." << endl;
+    cout << "  --daemon <socket> Servicio: recibe trabajos por un socket Unix y responde por la misma conexión." << endl;
+    cout << "  --client <socket> Envía al servicio los trabajos de --batch <ruta> y muestra sus respuestas;" << endl;
+    cout << "              con --shutdown detiene el servicio." << endl;
     cout << "  -h          Mostrar esta ayuda." << endl;
 }
 
 int main(int argc, char* argv[]) {
     Config config;
 
-    // 1. Recolección de argumentos en un mapa
-    map<string, string> args;
-    for (int i = 1; i < argc; ++i) {
-        string arg = argv[i];
-        if (arg[0] == '-') {
-            // Opciones cortas que esperan valor (-i, -o, -k)
-            if (arg.size() == 2 && (arg == "-i" || arg == "-o" || arg == "-k")) {
-                if (i + 1 < argc && argv[i+1][0] != '-') {
-                    args[arg] = argv[i+1];
-                    i++; 
-                } else {
-                    args[arg] = "";
-                }
-            } else if (arg.substr(0, 2) == "--") {
-                 // Opciones largas que esperan valor (--comp-alg, --enc-alg)
-                if (i + 1 < argc && argv[i+1][0] != '-') {
-                    args[arg] = argv[i+1];
-                    i++;
-                }
-            } else {
-                // Opciones cortas sin valor o combinadas (-c, -d, -ce)
-                args[arg] = "";
-            }
-        }
-    }
-
-    // 2. Parsear Operaciones y Opciones
-    if (args.count("-h")) {
-        show_help(argv[0]);
-        return 0;
+    // 1. Parsear y validar los argumentos
+    vector<string> args(argv + 1, argv + argc);
+    string error;
+    switch (parse_arguments(args, config, error)) {
+        case ArgsStatus::Help:
+            show_help(argv[0]);
+            return 0;
+        case ArgsStatus::Usage:
+            cerr << "ERROR: " << error << endl;
+            show_help(argv[0]);
+            return 1;
+        case ArgsStatus::Invalid:
+            cerr << "ERROR: " << error << endl;
+            return 1;
+        case ArgsStatus::Ok:
+            break;
     }
 
-    if (args.count("-i")) config.input_path = args["-i"];
-    if (args.count("-o")) config.output_path = args["-o"];
-    if (args.count("-k")) config.key = args["-k"];
-    if (args.count("--comp-alg")) config.comp_alg = args["--comp-alg"];
-    if (args.count("--enc-alg")) config.enc_alg = args["--enc-alg"];
+    // 2. Modo lote / servicio: cada trabajo trae su propia operación
+    if (!config.client_socket.empty()) return run_client(config) ? 0 : 1;
+    if (!config.daemon_socket.empty()) return run_daemon(config) ? 0 : 1;
+    if (!config.batch_path.empty()) return run_batch(config) ? 0 : 1;
 
-    // Manejo de la cadena de operaciones combinadas (ej: -ce)
-    for (const auto& pair : args) {
-        if (pair.first.find('-') != string::npos && pair.first.size() > 1) {
-            for (char op : pair.first.substr(1)) {
-                if (op == 'c') config.compress = true;
-                if (op == 'd') config.decompress = true;
-                if (op == 'e') config.encrypt = true;
-                if (op == 'u') config.decrypt = true;
-            }
-        }
-    }
-    
-    // 3. Validar Argumentos
-    if (config.input_path.empty() || config.output_path.empty()) {
-        cerr << "ERROR: Las rutas de entrada (-i) y salida (-o) son obligatorias." << endl;
-        show_help(argv[0]);
-        return 1;
+    if (!config.dict_path.empty()) {
+        config.dictionary = load_dictionary(config.dict_path);
+        if (!config.dictionary) return 1;
     }
 
-    if (config.compress && config.decompress) {
-        cerr << "ERROR: No se pueden especificar ambas operaciones de compresión y descompresión." << endl;
-        return 1;
-    }
-    if (config.encrypt && config.decrypt) {
-        cerr << "ERROR: No se pueden especificar ambas operaciones de encriptación y desencriptación." << endl;
-        return 1;
-    }
-    if ((config.encrypt || config.decrypt) && config.key.empty()) {
-        cerr << "ERROR: Se requiere una clave secreta (-k) para las operaciones de encriptación/desencriptación." << endl;
-        return 1;
+    // Con la salida estándar como destino, los mensajes van a stderr
+    if (config.output_path == "-") {
+        cout.rdbuf(cerr.rdbuf());
     }
 
-    // 4. Validar Algoritmos Soportados
-    if ((config.compress || config.decompress) && config.comp_alg != COMP_ALG_LZ77) {
-        cerr << "ERROR: El algoritmo de compresión '" << config.comp_alg << "' no es compatible. Solo se soporta " << COMP_ALG_LZ77 << "." << endl;
-        return 1;
-    }
-    if ((config.encrypt || config.decrypt) && config.enc_alg != ENC_ALG_VIGENERE) {
-        cerr << "ERROR: El algoritmo de encriptación '" << config.enc_alg << "' no es compatible. Solo se soporta " << ENC_ALG_VIGENERE << "." << endl;
-        return 1;
+    if (!config.stats_path.empty()) enable_stats();
+
+    // 3. Ejecutar la operación (Archivo único vs. Directorio concurrente)
+    bool ok;
+    {
+        // El pool se destruye antes del resumen: sus hilos suman el uso final de sus arenas
+        ThreadPool pool(config.threads);
+        ok = run_operation(config, pool);
     }
 
-    // 5. Ejecutar la operación (Archivo único vs. Directorio concurrente)
-    if (is_directory(config.input_path)) {
-        process_directory(config);
-    } else {
-        cout << "--- Modo Archivo Único: Iniciando procesamiento secuencial ---" << endl;
-        process_file(config.input_path, config.output_path, config);
-        cout << "--- Procesamiento de archivo único finalizado ---" << endl;
+    // Resumen de métricas: todos los trabajos ya terminaron
+    if (!config.stats_path.empty() && !write_stats(config.stats_path)) {
+        return 1;
     }
 
-    return 0;
-}
\ No newline at end of file
+    return ok ? 0 : 1;
+}
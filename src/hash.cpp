@@ -0,0 +1,249 @@
+#include "hash.hpp"
+#include <cstring>
+
+using namespace std;
+
+// Primos de XXH64
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Lecturas sin alinear (little-endian en las plataformas soportadas)
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t mix_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    return rotl(acc, 31) * PRIME1;
+}
+
+static inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= mix_round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+uint64_t hash64(ByteView data, uint64_t seed) {
+    const unsigned char* p = data.data();
+    const unsigned char* end = p + data.size();
+    uint64_t h;
+
+    if (data.size() >= 32) {
+        // Cuatro acumuladores independientes sobre franjas de 32 bytes
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = mix_round(v1, read64(p));
+            v2 = mix_round(v2, read64(p + 8));
+            v3 = mix_round(v3, read64(p + 16));
+            v4 = mix_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += data.size();
+
+    // Cola de menos de 32 bytes
+    while (p + 8 <= end) {
+        h ^= mix_round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= uint64_t(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        p++;
+    }
+
+    // Avalancha final
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// =================================================================
+// SHA-256
+// =================================================================
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+static inline uint32_t read_be32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// Procesa un bloque de 64 bytes
+static void sha256_block(uint32_t h[8], const unsigned char* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) w[i] = read_be32(block + 4 * i);
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = k + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static const uint32_t SHA256_INIT[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+/**
+ * Procesa los últimos len bytes de un mensaje y el relleno, y escribe el
+ * resumen. prefix_len es la cantidad de bytes ya procesados en h (múltiplo
+ * de 64), que cuenta en la longitud del relleno.
+ */
+static void sha256_finish(uint32_t h[8], const unsigned char* p, size_t len, uint64_t prefix_len,
+                          unsigned char digest[32]) {
+    size_t full = len / 64;
+    for (size_t i = 0; i < full; ++i) sha256_block(h, p + 64 * i);
+
+    // Relleno: 0x80, ceros y la longitud en bits (big-endian) al final del último bloque
+    unsigned char tail[128] = {0};
+    size_t rest = len - full * 64;
+    memcpy(tail, p + full * 64, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = rest + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (prefix_len + len) * 8;
+    for (int i = 0; i < 8; ++i) tail[tail_len - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    for (size_t i = 0; i < tail_len; i += 64) sha256_block(h, tail + i);
+
+    for (int i = 0; i < 8; ++i) {
+        digest[4 * i] = static_cast<unsigned char>(h[i] >> 24);
+        digest[4 * i + 1] = static_cast<unsigned char>(h[i] >> 16);
+        digest[4 * i + 2] = static_cast<unsigned char>(h[i] >> 8);
+        digest[4 * i + 3] = static_cast<unsigned char>(h[i]);
+    }
+}
+
+array<unsigned char, 32> sha256(ByteView data) {
+    uint32_t h[8];
+    memcpy(h, SHA256_INIT, sizeof(h));
+    array<unsigned char, 32> digest;
+    sha256_finish(h, data.data(), data.size(), 0, digest.data());
+    return digest;
+}
+
+// =================================================================
+// HMAC-SHA256 Y PBKDF2
+// =================================================================
+
+/**
+ * Estados de SHA-256 tras el bloque de la clave combinada con ipad y con
+ * opad: cada HMAC con la misma clave parte de ellos sin repetir ese bloque.
+ */
+struct HmacKey {
+    uint32_t inner[8];
+    uint32_t outer[8];
+
+    explicit HmacKey(ByteView key) {
+        unsigned char block[64] = {0};
+        if (key.size() > 64) {
+            array<unsigned char, 32> digest = sha256(key);
+            memcpy(block, digest.data(), digest.size());
+        } else if (!key.empty()) {
+            memcpy(block, key.data(), key.size());
+        }
+        unsigned char pad[64];
+        for (int i = 0; i < 64; ++i) pad[i] = block[i] ^ 0x36;
+        memcpy(inner, SHA256_INIT, sizeof(inner));
+        sha256_block(inner, pad);
+        for (int i = 0; i < 64; ++i) pad[i] = block[i] ^ 0x5c;
+        memcpy(outer, SHA256_INIT, sizeof(outer));
+        sha256_block(outer, pad);
+    }
+
+    // HMAC de un mensaje formado por dos partes consecutivas
+    void mac(const unsigned char* a, size_t a_len, const unsigned char* b, size_t b_len, unsigned char out[32]) const {
+        uint32_t h[8];
+        memcpy(h, inner, sizeof(h));
+        if (b_len == 0) {
+            sha256_finish(h, a, a_len, 64, out);
+        } else {
+            FileData message(a, a + a_len);
+            message.insert(message.end(), b, b + b_len);
+            sha256_finish(h, message.data(), message.size(), 64, out);
+        }
+        memcpy(h, outer, sizeof(h));
+        sha256_finish(h, out, 32, 64, out);
+    }
+};
+
+array<unsigned char, 32> hmac_sha256(ByteView key, ByteView message) {
+    array<unsigned char, 32> out;
+    HmacKey(key).mac(message.data(), message.size(), nullptr, 0, out.data());
+    return out;
+}
+
+array<unsigned char, 32> pbkdf2_sha256(ByteView password, ByteView salt, uint32_t iterations) {
+    // Un solo bloque de salida (32 bytes): U1 = HMAC(sal || INT(1)), Uj = HMAC(Uj-1), T = U1 ^ ... ^ Uc
+    HmacKey key(password);
+    const unsigned char index[4] = {0, 0, 0, 1};
+    unsigned char u[32];
+    key.mac(salt.data(), salt.size(), index, sizeof(index), u);
+    array<unsigned char, 32> t;
+    memcpy(t.data(), u, sizeof(u));
+    for (uint32_t j = 1; j < iterations; ++j) {
+        key.mac(u, sizeof(u), nullptr, 0, u);
+        for (int i = 0; i < 32; ++i) t[i] ^= u[i];
+    }
+    return t;
+}
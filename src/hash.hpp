@@ -0,0 +1,39 @@
+#pragma once
+
+#include "constantes.hpp"
+#include <array>
+#include <cstdint>
+
+/**
+ * Hash de contenido de 64 bits (algoritmo XXH64). No es criptográfico:
+ * sirve para detectar cambios en archivos, no para resistir colisiones
+ * provocadas.
+ * @param data Datos a resumir.
+ * @param seed Semilla (valores distintos dan hashes independientes).
+ * @return Hash de 64 bits.
+ */
+uint64_t hash64(ByteView data, uint64_t seed = 0);
+
+/**
+ * Resumen SHA-256 (FIPS 180-4).
+ * @param data Datos a resumir.
+ * @return Resumen de 32 bytes.
+ */
+std::array<unsigned char, 32> sha256(ByteView data);
+
+/**
+ * HMAC-SHA256 (RFC 2104): resumen de message que depende de key.
+ * @return Código de 32 bytes.
+ */
+std::array<unsigned char, 32> hmac_sha256(ByteView key, ByteView message);
+
+/**
+ * PBKDF2-HMAC-SHA256 (RFC 8018): deriva una clave de 32 bytes de una clave
+ * de texto y una sal. Las iteraciones encarecen cada intento de adivinar la
+ * clave de texto; la sal impide reutilizar el trabajo entre salidas.
+ * @param password Clave de texto.
+ * @param salt Sal (no secreta, distinta por salida).
+ * @param iterations Número de iteraciones (al menos 1).
+ * @return Clave derivada de 32 bytes.
+ */
+std::array<unsigned char, 32> pbkdf2_sha256(ByteView password, ByteView salt, uint32_t iterations);
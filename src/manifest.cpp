@@ -0,0 +1,167 @@
+#include "manifest.hpp"
+#include "compress.hpp"
+#include "crypto.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char* const MANIFEST_HEADER = "# gsea-manifest 2";
+static const char* const MANIFEST_HEADER_V1 = "# gsea-manifest 1"; // Sin sal: sus parámetros nunca coinciden
+static const char* const SALT_PREFIX = "# sal ";
+
+// Bytes de la sal e iteraciones de PBKDF2 para el resumen de la clave
+static const size_t SALT_SIZE = 16;
+static const uint32_t KEY_KDF_ITERATIONS = 100000;
+
+static string to_hex(const unsigned char* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 15];
+    }
+    return hex;
+}
+
+string manifest_params(const Config& config, const string& salt) {
+    ostringstream out;
+    out << (config.decrypt ? "u" : "") << (config.decompress ? "d" : "")
+        << (config.compress ? "c" : "") << (config.encrypt ? "e" : "");
+    if (config.compress) {
+        out << " alg=" << config.comp_alg << " nivel=" << config.level << " cadena=" << config.chain_depth;
+        if (config.dictionary) {
+            char id[9];
+            snprintf(id, sizeof(id), "%08x", config.dictionary->id);
+            out << " dict=" << id;
+        }
+    }
+    if (config.encrypt || config.decrypt) {
+        // Resumen lento y con la sal del manifiesto: no sirve para probar claves candidatas rápido
+        ByteView key(reinterpret_cast<const unsigned char*>(config.key.data()), config.key.size());
+        array<unsigned char, 32> digest = pbkdf2_sha256(
+            key, ByteView(reinterpret_cast<const unsigned char*>(salt.data()), salt.size()), KEY_KDF_ITERATIONS);
+        out << " enc=" << config.enc_alg << " clave=" << to_hex(digest.data(), digest.size());
+    }
+    out << " bloque=" << config.block_size << (config.stream ? " stream" : "");
+    return out.str();
+}
+
+bool stat_file(const string& path, uint64_t& size, int64_t& mtime_ns) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+Manifest::Manifest() {
+    unsigned char salt[SALT_SIZE];
+    random_bytes(salt, sizeof(salt));
+    key_salt = to_hex(salt, sizeof(salt));
+}
+
+bool Manifest::load(const string& path) {
+    ifstream in(path);
+    if (!in) return true; // Primera ejecución: sin manifiesto previo (queda la sal nueva)
+
+    string line;
+    bool valid = getline(in, line) && (line == MANIFEST_HEADER || line == MANIFEST_HEADER_V1);
+    if (valid && line == MANIFEST_HEADER) {
+        valid = getline(in, line) && line.size() == strlen(SALT_PREFIX) + 2 * SALT_SIZE &&
+                line.compare(0, strlen(SALT_PREFIX), SALT_PREFIX) == 0;
+        if (valid) key_salt = line.substr(strlen(SALT_PREFIX));
+    }
+    if (!valid) {
+        cerr << "ERROR: El manifiesto no es válido: " << path << endl;
+        return false;
+    }
+    while (getline(in, line)) {
+        if (line.empty()) continue;
+        vector<string> fields;
+        size_t start = 0;
+        for (size_t tab; fields.size() < 5 && (tab = line.find('\t', start)) != string::npos; start = tab + 1) {
+            fields.push_back(line.substr(start, tab - start));
+        }
+        fields.push_back(line.substr(start));
+        if (fields.size() != 6 || fields[0].empty()) {
+            cerr << "ERROR: Línea inválida en el manifiesto: " << path << endl;
+            return false;
+        }
+        ManifestEntry entry;
+        entry.output = fields[1];
+        entry.size = strtoull(fields[2].c_str(), nullptr, 10);
+        entry.mtime_ns = strtoll(fields[3].c_str(), nullptr, 10);
+        entry.hash = strtoull(fields[4].c_str(), nullptr, 16);
+        entry.params = fields[5];
+        entries[fields[0]] = entry;
+    }
+    return true;
+}
+
+bool Manifest::save(const string& path) const {
+    lock_guard<mutex> lock(mtx);
+    // Orden estable para que el manifiesto sea legible y comparable entre ejecuciones
+    vector<const pair<const string, ManifestEntry>*> sorted;
+    sorted.reserve(entries.size());
+    for (const auto& item : entries) sorted.push_back(&item);
+    sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    string temp = path + ".tmp";
+    {
+        ofstream out(temp, ios::trunc);
+        out << MANIFEST_HEADER << '\n' << SALT_PREFIX << key_salt << '\n';
+        for (const auto* item : sorted) {
+            const ManifestEntry& e = item->second;
+            char hex[17];
+            snprintf(hex, sizeof(hex), "%016" PRIx64, e.hash);
+            out << item->first << '\t' << e.output << '\t' << e.size << '\t' << e.mtime_ns << '\t'
+                << hex << '\t' << e.params << '\n';
+        }
+        if (!out.flush()) {
+            cerr << "ERROR: No se pudo escribir el manifiesto: " << temp << endl;
+            remove(temp.c_str());
+            return false;
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        cerr << "ERROR: No se pudo reemplazar el manifiesto: " << path << endl;
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+const ManifestEntry* Manifest::find(const string& relative) const {
+    auto it = entries.find(relative);
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+void Manifest::set(const string& relative, const ManifestEntry& entry) {
+    // Las rutas con tabuladores o saltos de línea no se pueden registrar: se procesan siempre
+    if (relative.find_first_of("\t\n") != string::npos || entry.output.find_first_of("\t\n") != string::npos) return;
+    lock_guard<mutex> lock(mtx);
+    entries[relative] = entry;
+}
+
+void Manifest::mark_seen(const string& relative) {
+    lock_guard<mutex> lock(mtx);
+    seen.insert(relative);
+}
+
+vector<string> Manifest::orphans(const Manifest& current) const {
+    vector<string> result;
+    lock_guard<mutex> lock(current.mtx);
+    for (const auto& item : entries) {
+        if (!current.seen.count(item.first)) result.push_back(item.first);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "constantes.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Manifiesto del modo incremental (--incremental). Se guarda en el
+ * directorio de salida y registra, por cada archivo de entrada procesado,
+ * su tamaño, fecha de modificación, hash de contenido, los parámetros de la
+ * operación y la ruta de su salida. En la siguiente ejecución, los archivos
+ * cuyas entradas siguen coincidiendo (y cuya salida existe) se omiten.
+ *
+ * Formato de texto: una cabecera "# gsea-manifest 2", la línea "# sal [hex]"
+ * con la sal del resumen de la clave y una línea por archivo con campos
+ * separados por tabuladores:
+ *   [Ruta relativa] [Salida relativa] [Tamaño] [mtime (ns)] [Hash (hex)] [Parámetros]
+ */
+
+// Nombre del manifiesto dentro del directorio de salida
+const char* const MANIFEST_FILE = ".gsea-manifest";
+
+struct ManifestEntry {
+    std::string output;  // Ruta de la salida, relativa al directorio de salida
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t hash = 0;   // hash64 del contenido de entrada
+    std::string params;  // Parámetros que determinan la salida (ver manifest_params)
+};
+
+/**
+ * Resume los parámetros que determinan la salida (operaciones, algoritmo,
+ * nivel, bloques y, si hay clave, su PBKDF2-HMAC-SHA256 con la sal del
+ * manifiesto; nunca la clave en claro ni un hash rápido de ella).
+ * Si cambian, todos los archivos se vuelven a procesar.
+ * @param salt Sal del manifiesto (ver Manifest::salt).
+ */
+std::string manifest_params(const Config& config, const std::string& salt);
+
+/**
+ * Lee tamaño y fecha de modificación de un archivo.
+ * @return false si el archivo no existe.
+ */
+bool stat_file(const std::string& path, uint64_t& size, int64_t& mtime_ns);
+
+/**
+ * Conjunto de entradas del manifiesto. set() y mark_seen() pueden llamarse
+ * desde varios hilos a la vez; find() solo mientras nadie modifica.
+ */
+class Manifest {
+public:
+    /**
+     * Crea un manifiesto vacío con una sal aleatoria nueva.
+     */
+    Manifest();
+
+    /**
+     * Carga un manifiesto y su sal. Un archivo inexistente deja el
+     * manifiesto vacío; uno de la versión 1 (sin sal) conserva la sal nueva.
+     * @return false si el archivo existe pero no es un manifiesto válido.
+     */
+    bool load(const std::string& path);
+
+    /**
+     * Escribe el manifiesto de forma atómica (archivo temporal + rename).
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @return La entrada de relative, o nullptr si no está.
+     */
+    const ManifestEntry* find(const std::string& relative) const;
+
+    /**
+     * Agrega o reemplaza la entrada de relative.
+     */
+    void set(const std::string& relative, const ManifestEntry& entry);
+
+    /**
+     * Registra que relative existe en la entrada de esta ejecución.
+     */
+    void mark_seen(const std::string& relative);
+
+    /**
+     * @return Rutas relativas de las entradas de this que no se vieron en current
+     * (archivos de entrada eliminados desde la ejecución anterior).
+     */
+    std::vector<std::string> orphans(const Manifest& current) const;
+
+    size_t size() const { return entries.size(); }
+
+    /**
+     * @return Sal del resumen de la clave (hex).
+     */
+    const std::string& salt() const { return key_salt; }
+
+    /**
+     * Reemplaza la sal (el manifiesto nuevo conserva la del anterior).
+     */
+    void set_salt(const std::string& salt) { key_salt = salt; }
+
+private:
+    std::string key_salt;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, ManifestEntry> entries;
+    std::unordered_set<std::string> seen;
+};
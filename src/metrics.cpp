@@ -0,0 +1,194 @@
+#include "metrics.hpp"
+#include "arena.hpp"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+
+const char* const STAGE_NAMES[] = {"leer", "desencriptar", "descomprimir", "comprimir", "encriptar",
+                                   "bloques", "streaming", "rango", "dedup", "escribir"};
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<size_t>(Stage::Count),
+              "Falta el nombre de una etapa");
+
+// Buffer de un hilo: solo lo escribe su dueño
+struct ThreadStats {
+    vector<FileStats> files;
+};
+
+atomic<bool> enabled{false};
+uint64_t started_ns = 0;
+
+// Registro de buffers; el lock solo se toma al registrar un hilo y al agregar
+mutex registry_mtx;
+vector<unique_ptr<ThreadStats>> registry;
+
+ThreadStats& local_stats() {
+    // El buffer lo posee el registro, así sobrevive al hilo (los hilos del pool terminan antes del resumen)
+    thread_local ThreadStats* local = nullptr;
+    if (local == nullptr) {
+        lock_guard<mutex> lock(registry_mtx);
+        registry.push_back(make_unique<ThreadStats>());
+        local = registry.back().get();
+    }
+    return *local;
+}
+
+double to_ms(uint64_t ns) {
+    return ns / 1e6;
+}
+
+double ratio_of(uint64_t in, uint64_t out) {
+    return in ? static_cast<double>(out) / in : 0.0;
+}
+
+// Máximo de memoria residente del proceso (en Linux ru_maxrss está en KiB)
+uint64_t peak_rss_bytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+// Escapa un campo CSV si contiene separadores o comillas
+string csv_escape(const string& text) {
+    if (text.find_first_of(",\"\n") == string::npos) return text;
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+void write_json(ostream& out, const vector<FileStats>& files, const FileStats& total, size_t failed, double wall_ms) {
+    out << "{\n";
+    out << "  \"archivos\": " << files.size() << ",\n";
+    out << "  \"fallidos\": " << failed << ",\n";
+    out << "  \"tiempo_total_ms\": " << wall_ms << ",\n";
+    out << "  \"bytes_entrada\": " << total.bytes_in << ",\n";
+    out << "  \"bytes_salida\": " << total.bytes_out << ",\n";
+    out << "  \"ratio\": " << ratio_of(total.bytes_in, total.bytes_out) << ",\n";
+    out << "  \"espera_cola_ms\": " << to_ms(total.queue_ns) << ",\n";
+    out << "  \"arena_pico_bytes\": " << total.arena_bytes << ",\n";
+    out << "  \"memoria_pico_bytes\": " << peak_rss_bytes() << ",\n";
+    out << "  \"etapas_ms\": {";
+    for (size_t s = 0; s < static_cast<size_t>(Stage::Count); ++s) {
+        out << (s ? ", " : "") << '"' << STAGE_NAMES[s] << "\": " << to_ms(total.stage_ns[s]);
+    }
+    out << "},\n";
+    out << "  \"detalle\": [\n";
+    for (size_t i = 0; i < files.size(); ++i) {
+        const FileStats& f = files[i];
+        out << "    {\"ruta\": \"" << json_escape(f.path) << "\", \"ok\": " << (f.ok ? "true" : "false")
+            << ", \"bytes_entrada\": " << f.bytes_in << ", \"bytes_salida\": " << f.bytes_out
+            << ", \"ratio\": " << ratio_of(f.bytes_in, f.bytes_out) << ", \"espera_cola_ms\": " << to_ms(f.queue_ns)
+            << ", \"arena_bytes\": " << f.arena_bytes;
+        for (size_t s = 0; s < static_cast<size_t>(Stage::Count); ++s) {
+            if (f.stage_ns[s]) out << ", \"" << STAGE_NAMES[s] << "_ms\": " << to_ms(f.stage_ns[s]);
+        }
+        out << "}" << (i + 1 < files.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void write_csv_row(ostream& out, const FileStats& f) {
+    out << csv_escape(f.path) << ',' << (f.ok ? 1 : 0) << ',' << f.bytes_in << ',' << f.bytes_out << ','
+        << ratio_of(f.bytes_in, f.bytes_out) << ',' << to_ms(f.queue_ns) << ',' << f.arena_bytes;
+    for (size_t s = 0; s < static_cast<size_t>(Stage::Count); ++s) out << ',' << to_ms(f.stage_ns[s]);
+    out << '\n';
+}
+
+void write_csv(ostream& out, const vector<FileStats>& files, const FileStats& total) {
+    out << "ruta,ok,bytes_entrada,bytes_salida,ratio,espera_cola_ms,arena_bytes";
+    for (const char* name : STAGE_NAMES) out << ',' << name << "_ms";
+    out << '\n';
+    for (const FileStats& f : files) write_csv_row(out, f);
+    // Última fila: totales agregados (arena_bytes es la suma de los máximos de los hilos)
+    write_csv_row(out, total);
+}
+
+} // namespace
+
+// Escapa una ruta para una cadena JSON
+string json_escape(const string& text) {
+    string out;
+    out.reserve(text.size());
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+void enable_stats() {
+    started_ns = monotonic_ns();
+    enabled.store(true, memory_order_relaxed);
+}
+
+bool stats_enabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+void record_file_stats(FileStats&& stats) {
+    if (!stats_enabled()) return;
+    local_stats().files.push_back(move(stats));
+}
+
+bool write_stats(const string& path) {
+    double wall_ms = to_ms(monotonic_ns() - started_ns);
+
+    vector<FileStats> files;
+    {
+        lock_guard<mutex> lock(registry_mtx);
+        for (const auto& thread : registry) {
+            files.insert(files.end(), thread->files.begin(), thread->files.end());
+        }
+    }
+
+    FileStats total;
+    total.path = "TOTAL";
+    total.ok = true;
+    total.arena_bytes = arena_peak_bytes();
+    size_t failed = 0;
+    for (const FileStats& f : files) {
+        total.bytes_in += f.bytes_in;
+        total.bytes_out += f.bytes_out;
+        total.queue_ns += f.queue_ns;
+        for (size_t s = 0; s < static_cast<size_t>(Stage::Count); ++s) total.stage_ns[s] += f.stage_ns[s];
+        if (!f.ok) {
+            failed++;
+            total.ok = false;
+        }
+    }
+
+    if (path == "-") {
+        write_json(cout, files, total, failed, wall_ms);
+        return bool(cout);
+    }
+    ofstream out(path);
+    if (!out) {
+        cerr << "ERROR: No se pudo abrir el archivo de métricas: " << path << endl;
+        return false;
+    }
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        write_csv(out, files, total);
+    } else {
+        write_json(out, files, total, failed, wall_ms);
+    }
+    return bool(out);
+}
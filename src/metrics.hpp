@@ -0,0 +1,112 @@
+#pragma once
+
+#include "constantes.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**
+ * Instrumentación por etapas y mensajes de progreso.
+ * Cada hilo acumula las métricas de los archivos que procesa en su propio
+ * buffer (sin sincronización en el camino caliente); al terminar, los
+ * buffers se agregan y se exportan como resumen JSON o CSV (--stats).
+ */
+
+// Etapas medidas por archivo
+enum class Stage {
+    Read,       // Apertura/mapeo de la entrada
+    Decrypt,    // Desencriptado
+    Decompress, // Descompresión
+    Compress,   // Compresión (incluye la sonda de incompresibilidad)
+    Encrypt,    // Encriptado
+    Blocks,     // Contenedor por bloques (construcción o restauración en paralelo)
+    Stream,     // Pipeline por streaming completo (lectura, etapas y escritura)
+    Range,      // Lectura de un rango de un contenedor por bloques
+    Dedup,      // Corte en fragmentos, índice y codificación de los fragmentos nuevos (o reconstrucción)
+    Write,      // Escritura de la salida
+    Count
+};
+
+// Métricas de un archivo procesado
+struct FileStats {
+    std::string path;
+    uint64_t stage_ns[static_cast<size_t>(Stage::Count)] = {};
+    uint64_t queue_ns = 0;  // Espera desde que se encoló hasta que empezó (incluye --max-inflight)
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t arena_bytes = 0; // Memoria de trabajo del hilo al terminar el archivo (ver arena.hpp)
+    bool ok = false;
+};
+
+/**
+ * Activa la recolección de métricas e inicia el reloj del resumen.
+ */
+void enable_stats();
+
+/**
+ * @return true si se están recolectando métricas (--stats).
+ */
+bool stats_enabled();
+
+/**
+ * Agrega las métricas de un archivo al buffer del hilo actual.
+ * No toma ningún lock salvo la primera vez que el hilo registra su buffer.
+ */
+void record_file_stats(FileStats&& stats);
+
+/**
+ * Agrega los buffers de todos los hilos y escribe el resumen.
+ * Debe llamarse cuando ya no hay trabajos en curso.
+ * @param path Ruta de salida: ".csv" produce CSV, cualquier otra JSON; "-" escribe JSON en la salida estándar.
+ * @return true si el resumen se escribió.
+ */
+bool write_stats(const std::string& path);
+
+/**
+ * Escapa un texto para incluirlo en una cadena JSON.
+ */
+std::string json_escape(const std::string& text);
+
+/**
+ * @return Nanosegundos de un reloj monótono (para medir esperas y etapas).
+ */
+inline uint64_t monotonic_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Mide una etapa de un archivo mientras está en alcance.
+ * Si las métricas están desactivadas no consulta el reloj.
+ */
+class StageTimer {
+public:
+    StageTimer(FileStats& stats, Stage stage)
+        : stats(stats), stage(stage), start(stats_enabled() ? monotonic_ns() : 0) {}
+    ~StageTimer() {
+        if (start != 0) stats.stage_ns[static_cast<size_t>(stage)] += monotonic_ns() - start;
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    FileStats& stats;
+    Stage stage;
+    uint64_t start;
+};
+
+/**
+ * Escribe una línea de progreso salvo con --quiet. La línea se arma
+ * completa y se emite con una sola escritura, para que las de distintos
+ * hilos no se intercalen.
+ */
+template <typename... Args>
+void log_progress(const Config& config, const Args&... args) {
+    if (config.quiet) return;
+    std::ostringstream line;
+    (line << ... << args);
+    line << '\n';
+    std::cout << line.str() << std::flush;
+}
@@ -0,0 +1,706 @@
+#include "process.hpp"
+#include "arena.hpp"
+#include "crypto.hpp"
+#include "compress.hpp"
+#include "fs_utils.hpp"
+#include "block.hpp"
+#include "thread_pool.hpp"
+#include "stream.hpp"
+#include "archive.hpp"
+#include "metrics.hpp"
+#include "manifest.hpp"
+#include "hash.hpp"
+#include "dedup.hpp"
+#include "uring.hpp"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/stat.h>
+#include <errno.h>
+
+using namespace std;
+
+// =================================================================
+// LÓGICA DE PROCESAMIENTO
+// =================================================================
+
+/**
+ * Informa cuántos bloques del archivo se comprimieron y cuántos se
+ * almacenaron sin comprimir por ser incompresibles.
+ */
+static void report_store(const string& input_file, const StoreReport& report, const Config& config) {
+    if (report.stored == 0 && report.compressed == 0) return;
+    log_progress(config, "  [HILO] Bloques comprimidos: ", report.compressed,
+                 ", almacenados sin comprimir: ", report.stored, " (", input_file, ")");
+}
+
+bool transform_buffer(const string& input_file, ByteView input, const Config& config, ThreadPool* pool,
+                      FileStats& stats, FileData& processed_data, ByteView& current) {
+    // current apunta a la salida de la última etapa ejecutada y holder al buffer que la contiene
+    // (nulo mientras sea la entrada). Las etapas alternan entre processed_data y el buffer
+    // intermedio del arena del hilo; el primero se elige según cuántas etapas escriben un
+    // buffer nuevo, así la última siempre escribe en processed_data (sin copias ni intercambios).
+    current = input;
+    bool restore = (config.decrypt || config.decompress) && is_block_container(input);
+    bool blocks = config.block_size > 0 && (config.compress || config.encrypt);
+    int outputs = restore ? 1 : int(config.decrypt) + int(config.decompress);
+    if (blocks) {
+        outputs++;
+    } else {
+        // La encriptación solo escribe un buffer nuevo si ninguna etapa anterior lo hizo
+        outputs += int(config.compress);
+        if (config.encrypt && outputs == 0) outputs = 1;
+    }
+    FileData& scratch = worker_arena().scratch;
+    FileData* holder = nullptr;
+    auto next_buffer = [&]() -> FileData& {
+        if (holder == nullptr) return outputs % 2 ? processed_data : scratch;
+        return holder == &processed_data ? scratch : processed_data;
+    };
+    if (restore) {
+        // 1-2. Desencriptar/Descomprimir un contenedor por bloques en paralelo
+        FileData& out = next_buffer();
+        {
+            StageTimer timer(stats, Stage::Blocks);
+            out = restore_blocks(current, config, pool);
+        }
+        if (out.empty()) {
+            cerr << "  [HILO] ERROR: Falló la restauración del contenedor por bloques de: " << input_file << endl;
+            return false;
+        }
+        current = out;
+        holder = &out;
+        log_progress(config, "  [HILO] Bloques restaurados: ", input_file);
+    } else {
+        // 1. Desencriptar (si -u)
+        if (config.decrypt) {
+            const string& alg = detected_enc_alg(current, config);
+            FileData& out = next_buffer();
+            bool ok;
+            {
+                StageTimer timer(stats, Stage::Decrypt);
+                ok = decrypt_selected_into(current, config, out, pool);
+            }
+            if (!ok) {
+                cerr << "  [HILO] ERROR: Falló la desencriptación (" << alg << ") de: " << input_file << endl;
+                return false;
+            }
+            current = out;
+            holder = &out;
+            log_progress(config, "  [HILO] Desencriptado (", alg, "): ", input_file);
+        }
+
+        // 2. Descomprimir (si -d)
+        if (config.decompress) {
+            FileData& out = next_buffer();
+            bool ok;
+            {
+                StageTimer timer(stats, Stage::Decompress);
+                ok = decompress_lz77_into(current, config.dictionary.get(), out);
+            }
+            if (!ok) {
+                cerr << "  [HILO] ERROR: Falló la descompresión LZ77 de: " << input_file << endl;
+                return false;
+            }
+            current = out;
+            holder = &out;
+            log_progress(config, "  [HILO] Descomprimido (LZ77): ", input_file);
+        }
+    }
+
+    if (blocks) {
+        // 3-4. Comprimir/Encriptar por bloques independientes en paralelo
+        StoreReport report;
+        FileData& out = next_buffer();
+        {
+            StageTimer timer(stats, Stage::Blocks);
+            out = build_blocks(current, config, pool, &report);
+        }
+        current = out;
+        holder = &out;
+        log_progress(config, "  [HILO] Procesado por bloques de ", config.block_size >> 20, " MiB: ", input_file);
+        report_store(input_file, report, config);
+    } else {
+        // 3. Comprimir (si -c)
+        if (config.compress) {
+            FileData& out = next_buffer();
+            bool stored = false;
+            {
+                StageTimer timer(stats, Stage::Compress);
+                compress_into(current, config, out, &stored);
+            }
+            current = out;
+            holder = &out;
+            if (stored) {
+                log_progress(config, "  [HILO] Almacenado sin comprimir (datos incompresibles): ", input_file);
+            } else {
+                log_progress(config, "  [HILO] Comprimido (", config.comp_alg, "): ", input_file);
+            }
+        }
+
+        // 4. Encriptar (si -e)
+        if (config.encrypt) {
+            bool ok;
+            {
+                StageTimer timer(stats, Stage::Encrypt);
+                if (holder != nullptr) {
+                    // La etapa anterior ya produjo un buffer propio: se encripta en su lugar
+                    ok = encrypt_selected_in_place(*holder, config, pool);
+                } else {
+                    FileData& out = next_buffer();
+                    ok = encrypt_selected_into(current, config, out, pool);
+                    holder = &out;
+                }
+                current = *holder;
+            }
+            if (!ok) {
+                cerr << "  [HILO] ERROR: Falló la encriptación (" << config.enc_alg << ") de: " << input_file << endl;
+                return false;
+            }
+            log_progress(config, "  [HILO] Encriptado (", config.enc_alg, "): ", input_file);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Ejecuta las etapas sobre un archivo y anota en stats el tiempo de cada una.
+ * @return true si la salida se escribió.
+ */
+static bool run_file_stages(const string& input_file, const string& output_file, const Config& config,
+                            ThreadPool* pool, FileStats& stats) {
+    log_progress(config, "  [HILO] Procesando: ", input_file, " -> ", output_file);
+
+    if (config.range_length > 0) {
+        // Lectura de un rango: solo se restauran los bloques que lo cubren
+        InputFile input;
+        {
+            StageTimer timer(stats, Stage::Read);
+            if (!input.open(input_file)) return false;
+        }
+        stats.bytes_in = input.view().size();
+        // Un archivo solo encriptado con ChaCha20 también admite acceso aleatorio: se descifra solo el rango
+        bool chacha_range = config.decrypt && !config.decompress && is_chacha20_data(input.view());
+        if (!chacha_range && !is_block_container(input.view())) {
+            cerr << "  [HILO] ERROR: --range requiere un contenedor por bloques (creado con --block-size o --stream)"
+                 << " o un archivo encriptado con " << ENC_ALG_CHACHA20 << ": " << input_file << endl;
+            return false;
+        }
+        FileData range;
+        {
+            StageTimer timer(stats, Stage::Range);
+            if (chacha_range) {
+                range = decrypt_chacha20_range(input.view(), config.key, config.range_offset, config.range_length,
+                                               pool);
+            } else {
+                range = read_block_range(input.view(), config.range_offset, config.range_length, config, pool);
+            }
+        }
+        bool ok = false;
+        {
+            StageTimer timer(stats, Stage::Write);
+            int fd = range.empty() ? -1 : open_output_fd(output_file);
+            ok = fd >= 0 && write_fully(fd, range.data(), range.size());
+            if (fd >= 0) close_fd(fd);
+        }
+        if (!ok) {
+            cerr << "  [HILO] ERROR: Falló la lectura del rango de: " << input_file << endl;
+            return false;
+        }
+        stats.bytes_out = range.size();
+        log_progress(config, "  [HILO] Rango de ", range.size(), " bytes desde ", config.range_offset,
+                     " guardado en: ", output_file);
+        return true;
+    }
+
+    if (config.stream) {
+        // Pipeline por fragmentos: memoria constante sin importar el tamaño del archivo
+        StoreReport report;
+        bool ok;
+        {
+            StageTimer timer(stats, Stage::Stream);
+            ok = process_stream(input_file, output_file, config, pool, &report);
+        }
+        if (!ok) {
+            cerr << "  [HILO] ERROR: Falló el procesamiento por streaming de: " << input_file << endl;
+            return false;
+        }
+        if (stats_enabled() && input_file != "-" && output_file != "-") {
+            stats.bytes_in = get_file_size(input_file);
+            stats.bytes_out = get_file_size(output_file);
+        }
+        report_store(input_file, report, config);
+        log_progress(config, "  [HILO] Éxito (streaming). Resultado guardado en: ", output_file);
+        return true;
+    }
+
+    // Entrada mapeada (o leída al arena si es pequeña): la primera etapa lee directamente de ella
+    WorkerArena& arena = worker_arena();
+    InputFile input;
+    {
+        StageTimer timer(stats, Stage::Read);
+        if (!input.open(input_file, &arena.input) || input.view().empty()) {
+            cerr << "  [HILO] ERROR: Falló la lectura o el archivo está vacío: " << input_file << endl;
+            return false;
+        }
+    }
+    stats.bytes_in = input.view().size();
+
+    ByteView current;
+    if (!transform_buffer(input_file, input.view(), config, pool, stats, arena.output, current)) return false;
+
+    // Escribir el resultado
+    bool written;
+    {
+        StageTimer timer(stats, Stage::Write);
+        written = write_file_posix(output_file, current);
+    }
+    if (!written) {
+        cerr << "  [HILO] ERROR: Falló la escritura en el archivo de salida: " << output_file << endl;
+        return false;
+    }
+    stats.bytes_out = current.size();
+    log_progress(config, "  [HILO] Éxito. Resultado guardado en: ", output_file);
+    return true;
+}
+
+/**
+ * Procesa un archivo y registra sus métricas en el buffer del hilo actual.
+ * @param queue_ns Tiempo que el trabajo esperó en la cola antes de empezar.
+ * @return true si la salida se escribió.
+ */
+static bool process_file_recorded(const string& input_file, const string& output_file, const Config& config,
+                                  ThreadPool* pool, uint64_t queue_ns) {
+    FileStats stats;
+    bool ok = run_file_stages(input_file, output_file, config, pool, stats);
+    stats.arena_bytes = worker_arena().finish_file();
+    if (stats_enabled()) {
+        stats.ok = ok;
+        stats.path = input_file;
+        stats.queue_ns = queue_ns;
+        record_file_stats(move(stats));
+    }
+    return ok;
+}
+
+bool process_file(const string& input_file, const string& output_file, const Config& config, ThreadPool* pool) {
+    return process_file_recorded(input_file, output_file, config, pool, 0);
+}
+
+/**
+ * Crea un directorio de salida si no existe.
+ * @return true si el directorio existe o se creó.
+ */
+static bool create_output_directory(const string& path) {
+    int res = mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    if (res != 0 && errno != EEXIST) {
+        cerr << "ERROR: No se pudo crear el directorio de salida: " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Sufijo que se agrega a las salidas en modo directorio
+// (esto es simplificado; un sistema robusto usaría metadatos)
+static string output_suffix(const Config& config) {
+    return config.compress ? ".lz77" : (config.encrypt ? ".enc" : "");
+}
+
+// Estado del modo incremental compartido por los trabajos de un directorio
+struct IncrementalRun {
+    Manifest previous; // Manifiesto de la ejecución anterior (solo lectura)
+    Manifest current;  // Entradas vigentes al terminar esta ejecución
+    string params;
+    atomic<size_t> skipped{0};
+};
+
+// Estado compartido por los trabajos de un directorio
+struct DirectoryRun {
+    unique_ptr<IncrementalRun> incremental; // --incremental
+    unique_ptr<ChunkStore> chunks;          // --dedup
+    atomic<uint64_t> dedup_in{0};           // Bytes de entrada deduplicados
+    atomic<uint64_t> dedup_new{0};          // Bytes de fragmentos nuevos (no repetidos)
+    atomic<size_t> failed{0};               // Archivos que no se pudieron procesar
+};
+
+/**
+ * Deduplica un archivo contra el almacén compartido y registra sus métricas.
+ * @return true si la receta se escribió.
+ */
+static bool dedup_file_recorded(const string& input_file, const string& recipe_file, const Config& config,
+                                DirectoryRun& run, uint64_t queue_ns) {
+    log_progress(config, "  [HILO] Deduplicando: ", input_file, " -> ", recipe_file);
+    FileStats stats;
+    uint64_t new_bytes = 0;
+    bool ok;
+    {
+        StageTimer timer(stats, Stage::Dedup);
+        ok = dedup_file(input_file, recipe_file, *run.chunks, stats.bytes_in, new_bytes);
+    }
+    if (ok) {
+        run.dedup_in += stats.bytes_in;
+        run.dedup_new += new_bytes;
+        log_progress(config, "  [HILO] Éxito (dedup, ", new_bytes, " de ", stats.bytes_in,
+                     " bytes nuevos). Receta guardada en: ", recipe_file);
+    } else {
+        cerr << "  [HILO] ERROR: Falló la deduplicación de: " << input_file << endl;
+    }
+    if (stats_enabled()) {
+        // Los bytes de salida de cada archivo son los de su receta; los fragmentos se cuentan en el almacén
+        stats.ok = ok;
+        stats.path = input_file;
+        stats.queue_ns = queue_ns;
+        stats.bytes_out = ok ? get_file_size(recipe_file) : 0;
+        record_file_stats(move(stats));
+    }
+    return ok;
+}
+
+static uint64_t hash_input_file(const string& path) {
+    InputFile input;
+    return input.open(path) ? hash64(input.view()) : hash64(ByteView());
+}
+
+/**
+ * Decide si un archivo puede omitirse: su entrada del manifiesto anterior
+ * coincide en parámetros, tamaño y salida, la salida existe y, o bien la
+ * fecha de modificación es la misma, o el hash del contenido lo es.
+ * @param entry Se completa con los datos actuales del archivo.
+ * @param hashed Se pone en true si entry.hash ya tiene el hash del contenido.
+ */
+static bool is_unchanged(const IncrementalRun& run, const string& relative, const string& input_file,
+                         const string& output_file, ManifestEntry& entry, bool& hashed) {
+    hashed = false;
+    if (!stat_file(input_file, entry.size, entry.mtime_ns)) return false;
+    const ManifestEntry* old = run.previous.find(relative);
+    if (old == nullptr || old->params != entry.params || old->size != entry.size || old->output != entry.output) {
+        return false;
+    }
+    uint64_t output_size;
+    int64_t output_mtime;
+    if (!stat_file(output_file, output_size, output_mtime)) return false;
+    if (old->mtime_ns == entry.mtime_ns) {
+        entry.hash = old->hash;
+        hashed = true;
+        return true;
+    }
+    // Mismo tamaño con otra fecha (touch, copia, checkout): decide el contenido
+    entry.hash = hash_input_file(input_file);
+    hashed = true;
+    return entry.hash == old->hash;
+}
+
+/**
+ * Encola el procesamiento de un archivo respetando el límite de bytes en vuelo.
+ * relative es la ruta relativa de la entrada; la salida agrega el sufijo de la operación.
+ * Si file_size es 0 se consulta en el hilo de trabajo (modo recursivo).
+ * Con incremental, el archivo se omite si no cambió desde la ejecución anterior;
+ * con dedup, se escribe su receta en lugar de procesarlo por separado.
+ */
+static void submit_file_job(TaskGroup& group, ByteBudget& budget, const Config& config, DirectoryRun& run,
+                            const string& input_file, const string& relative, size_t file_size) {
+    uint64_t queued_at = stats_enabled() ? monotonic_ns() : 0;
+    group.submit([input_file, relative, file_size, queued_at, &run, &config, &budget]() {
+        IncrementalRun* incremental = run.incremental.get();
+        string relative_output = relative + output_suffix(config);
+        string output_file = config.output_path + "/" + relative_output;
+        ManifestEntry entry;
+        bool hashed = false;
+        if (incremental) {
+            incremental->current.mark_seen(relative);
+            entry.output = relative_output;
+            entry.params = incremental->params;
+            if (is_unchanged(*incremental, relative, input_file, output_file, entry, hashed)) {
+                incremental->current.set(relative, entry);
+                incremental->skipped++;
+                log_progress(config, "  [HILO] Sin cambios, omitido: ", input_file);
+                return;
+            }
+        }
+
+        size_t reserved = budget.acquire(file_size ? file_size : get_file_size(input_file));
+        uint64_t queue_ns = queued_at ? monotonic_ns() - queued_at : 0;
+        bool ok = run.chunks ? dedup_file_recorded(input_file, output_file, config, run, queue_ns)
+                             : process_file_recorded(input_file, output_file, config, nullptr, queue_ns);
+        budget.release(reserved);
+        if (!ok) run.failed++;
+
+        // Solo se registran los archivos procesados con éxito: los fallidos se reintentan
+        if (incremental && ok) {
+            if (!hashed) entry.hash = hash_input_file(input_file);
+            incremental->current.set(relative, entry);
+        }
+    });
+}
+
+/**
+ * Cierra una ejecución incremental: conserva (o con --prune elimina) las
+ * salidas de las entradas que ya no existen y guarda el manifiesto nuevo.
+ */
+static void finish_incremental(const Config& config, IncrementalRun& run, const string& manifest_path) {
+    size_t pruned = 0;
+    for (const string& relative : run.previous.orphans(run.current)) {
+        const ManifestEntry* old = run.previous.find(relative);
+        if (!config.prune) {
+            // Sin --prune la entrada se conserva para poder limpiarla más adelante
+            run.current.set(relative, *old);
+            continue;
+        }
+        if (!is_safe_relative_path(old->output)) {
+            cerr << "ERROR: Ruta insegura en el manifiesto, no se elimina: " << old->output << endl;
+            continue;
+        }
+        string output_file = config.output_path + "/" + old->output;
+        if (remove(output_file.c_str()) != 0 && errno != ENOENT) {
+            cerr << "ERROR: No se pudo eliminar la salida huérfana: " << output_file << endl;
+            run.current.set(relative, *old);
+            continue;
+        }
+        pruned++;
+        log_progress(config, "  Salida huérfana eliminada: ", output_file);
+    }
+    if (!run.current.save(manifest_path)) {
+        cerr << "ERROR: No se pudo guardar el manifiesto: " << manifest_path << endl;
+    }
+    log_progress(config, "Incremental: ", run.skipped.load(), " sin cambios, ", pruned, " salidas huérfanas eliminadas.");
+}
+
+/**
+ * Restaura un directorio deduplicado: reconstruye cada receta (recorriendo
+ * los subdirectorios) a partir del almacén de fragmentos compartido.
+ * @return true si todas las recetas se restauraron.
+ */
+static bool restore_dedup_directory(const Config& config, ThreadPool& pool) {
+    ChunkPack pack;
+    string chunk_store_path = config.input_path + "/" + CHUNK_STORE_FILE;
+    if (!pack.open(chunk_store_path, config)) {
+        cerr << "ERROR: No se pudo abrir el almacén de fragmentos: " << chunk_store_path << endl;
+        return false;
+    }
+    if (!create_output_directory(config.output_path)) return false;
+
+    TaskGroup group(pool);
+    log_progress(config, "Hilos: ", group.size(), ", restaurando recetas de: ", config.input_path);
+    atomic<size_t> files{0};
+    atomic<size_t> failed{0};
+    walk_directory_tree(config.input_path, group,
+        [&](const string& relative) {
+            if (create_output_directory(config.output_path + "/" + relative)) return true;
+            failed++;
+            return false;
+        },
+        [&](const string& input_file, const string& relative) {
+            if (relative == CHUNK_STORE_FILE || relative == MANIFEST_FILE) return;
+            files++;
+            string output_file = config.output_path + "/" + relative;
+            FileStats stats;
+            bool ok;
+            {
+                StageTimer timer(stats, Stage::Dedup);
+                ok = restore_dedup_file(input_file, output_file, pack, config);
+            }
+            if (ok) {
+                log_progress(config, "  [HILO] Éxito (dedup). Resultado guardado en: ", output_file);
+            } else {
+                failed++;
+            }
+            if (stats_enabled()) {
+                stats.ok = ok;
+                stats.path = input_file;
+                stats.bytes_in = get_file_size(input_file);
+                stats.bytes_out = ok ? get_file_size(output_file) : 0;
+                record_file_stats(move(stats));
+            }
+        });
+    group.wait();
+    log_progress(config, "Archivos restaurados: ", files.load());
+    return failed == 0;
+}
+
+/**
+ * Modo directorio con E/S io_uring: arma la lista de archivos (creando los
+ * subdirectorios de salida con -r) y la procesa con process_files_uring.
+ * @param failed Recibe el número de archivos que no se pudieron procesar.
+ * @return false si io_uring no está disponible o falló (se usa E/S POSIX).
+ */
+static bool process_directory_uring(const Config& config, TaskGroup& group, size_t& failed) {
+    if (!uring_available()) return false;
+
+    vector<FileJob> jobs;
+    if (config.recursive) {
+        mutex jobs_mtx;
+        atomic<size_t> skipped{0};
+        walk_directory_tree(config.input_path, group,
+            [&](const string& relative) {
+                if (create_output_directory(config.output_path + "/" + relative)) return true;
+                skipped++;
+                return false;
+            },
+            [&](const string& input_file, const string& relative) {
+                lock_guard<mutex> lock(jobs_mtx);
+                jobs.push_back({input_file, config.output_path + "/" + relative + output_suffix(config)});
+            },
+            config.output_path);
+        group.wait();
+        failed += skipped;
+    } else {
+        for (const string& input_file : list_directory(config.input_path)) {
+            size_t last_slash = input_file.find_last_of('/');
+            string filename = (last_slash == string::npos) ? input_file : input_file.substr(last_slash + 1);
+            jobs.push_back({input_file, config.output_path + "/" + filename + output_suffix(config)});
+        }
+    }
+
+    log_progress(config, "Hilos: ", group.size(), ", E/S io_uring con ", config.queue_depth,
+                 " operaciones en vuelo, archivos: ", jobs.size());
+    return process_files_uring(jobs, config, group, failed);
+}
+
+bool process_directory(const Config& config, ThreadPool& pool) {
+    log_progress(config, "--- Modo Directorio: Iniciando procesamiento concurrente ---");
+    
+    if (config.archive) {
+        // Modo archivo: todo el directorio en un único contenedor sólido
+        FileStats stats;
+        bool ok;
+        {
+            StageTimer timer(stats, Stage::Blocks);
+            ok = create_archive(config.input_path, config.output_path, config, pool);
+        }
+        if (stats_enabled()) {
+            // El archivo sólido se registra como una sola entrada (sin bytes de entrada por miembro)
+            stats.path = config.output_path;
+            stats.ok = ok;
+            stats.bytes_out = get_file_size(config.output_path);
+            record_file_stats(move(stats));
+        }
+        if (ok) {
+            log_progress(config, "Archivo sólido creado: ", config.output_path);
+        } else {
+            cerr << "ERROR: Falló la creación del archivo sólido: " << config.output_path << endl;
+        }
+        return ok;
+    }
+
+    if ((config.decompress || config.decrypt) && is_dedup_directory(config.input_path)) {
+        // Salida de --dedup: recetas + almacén de fragmentos
+        bool ok = restore_dedup_directory(config, pool);
+        log_progress(config, "--- Procesamiento concurrente de directorios finalizado ---");
+        return ok;
+    }
+
+    // Crear el directorio de salida si no existe
+    if (!create_output_directory(config.output_path)) return false;
+    // Con -r la salida se crea mientras se recorre la entrada: si fueran el mismo
+    // directorio se volverían a procesar los resultados (una -o dentro de -i se omite)
+    if (config.recursive && same_file(config.input_path, config.output_path)) {
+        cerr << "ERROR: Con -r el directorio de salida (-o) no puede ser el de entrada (-i)." << endl;
+        return false;
+    }
+
+    // Modo incremental: el manifiesto de la ejecución anterior decide qué omitir
+    DirectoryRun run;
+    string manifest_path = config.output_path + "/" + MANIFEST_FILE;
+    if (config.incremental) {
+        run.incremental = make_unique<IncrementalRun>();
+        if (!run.incremental->previous.load(manifest_path)) return false;
+        // El manifiesto nuevo conserva la sal: con la misma clave, los parámetros coinciden
+        const string& salt = run.incremental->previous.salt();
+        run.incremental->current.set_salt(salt);
+        run.incremental->params = manifest_params(config, salt);
+    }
+
+    // Modo dedup: un único almacén de fragmentos para todos los archivos
+    string chunk_store_path = config.output_path + "/" + CHUNK_STORE_FILE;
+    if (config.dedup) {
+        run.chunks = make_unique<ChunkStore>(config);
+        if (!run.chunks->create(chunk_store_path)) {
+            cerr << "ERROR: No se pudo crear el almacén de fragmentos: " << chunk_store_path << endl;
+            return false;
+        }
+    }
+
+    // Límite de bytes en vuelo y grupo de trabajos en el pool (compartido en modo lote)
+    ByteBudget budget(config.max_inflight);
+    TaskGroup group(pool);
+
+    if (config.io_uring) {
+        size_t failed = 0;
+        if (process_directory_uring(config, group, failed)) {
+            log_progress(config, "--- Procesamiento concurrente de directorios finalizado ---");
+            return failed == 0;
+        }
+        cerr << "AVISO: io_uring no está disponible; se usa E/S POSIX." << endl;
+    }
+
+    if (config.recursive) {
+        // El recorrido corre en el mismo pool: cada archivo se encola apenas se
+        // encuentra, sin esperar a que termine de recorrerse el árbol
+        log_progress(config, "Hilos: ", group.size(), ", recorrido recursivo de: ", config.input_path);
+        atomic<size_t> files{0};
+        walk_directory_tree(config.input_path, group,
+            [&](const string& relative) {
+                if (create_output_directory(config.output_path + "/" + relative)) return true;
+                run.failed++;
+                return false;
+            },
+            [&](const string& input_file, const string& relative) {
+                files++;
+                submit_file_job(group, budget, config, run, input_file, relative, 0);
+            },
+            config.output_path);
+        group.wait();
+        log_progress(config, "Archivos procesados: ", files.load());
+    } else {
+        vector<string> input_files = list_directory(config.input_path);
+        if (input_files.empty()) {
+            log_progress(config, "No se encontraron archivos regulares para procesar en: ", config.input_path);
+        }
+
+        // Ordenar de mayor a menor tamaño para que un archivo grande no quede al final
+        vector<pair<size_t, string>> jobs;
+        jobs.reserve(input_files.size());
+        for (const string& input_file : input_files) {
+            jobs.emplace_back(get_file_size(input_file), input_file);
+        }
+        sort(jobs.begin(), jobs.end(), [](const pair<size_t, string>& a, const pair<size_t, string>& b) {
+            return a.first > b.first;
+        });
+
+        log_progress(config, "Hilos: ", group.size(), ", archivos: ", jobs.size());
+
+        for (const auto& job : jobs) {
+            const string& input_file = job.second;
+
+            // Extraer el nombre del archivo para la salida
+            size_t last_slash = input_file.find_last_of('/');
+            string filename = (last_slash == string::npos) ? input_file : input_file.substr(last_slash + 1);
+            // El manifiesto de la ejecución anterior no es una entrada
+            if (run.incremental && filename == MANIFEST_FILE) continue;
+            submit_file_job(group, budget, config, run, input_file, filename, job.first);
+        }
+
+        // Esperar a que todos los trabajos terminen
+        group.wait();
+    }
+
+    if (run.incremental) finish_incremental(config, *run.incremental, manifest_path);
+    if (run.chunks) {
+        uint64_t unique_bytes = run.dedup_new.load();
+        uint32_t chunks = run.chunks->chunk_count();
+        if (!run.chunks->finish()) {
+            cerr << "ERROR: Falló la escritura del almacén de fragmentos: " << chunk_store_path << endl;
+            run.failed++;
+        } else {
+            log_progress(config, "Dedup: ", run.dedup_in.load(), " bytes de entrada, ", unique_bytes,
+                         " únicos en ", chunks, " fragmentos; almacén de ", get_file_size(chunk_store_path), " bytes.");
+        }
+    }
+
+    log_progress(config, "--- Procesamiento concurrente de directorios finalizado ---");
+    return run.failed == 0;
+}
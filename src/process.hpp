@@ -0,0 +1,47 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include <string>
+
+/**
+ * Aplica a un archivo ya leído las etapas pedidas, en orden: desencriptar,
+ * descomprimir, comprimir y encriptar (o el contenedor por bloques).
+ * @param input_file Ruta del archivo (para los mensajes).
+ * @param input Contenido del archivo.
+ * @param config Parámetros de la operación.
+ * @param pool Pool donde se reparten los bloques o los buffers grandes (nulo = en el hilo actual).
+ * @param stats Recibe el tiempo de cada etapa.
+ * @param storage Recibe el resultado de la última etapa que produjo datos nuevos
+ *        (se reutiliza su capacidad; las etapas intermedias usan el arena del hilo).
+ * @param result Recibe la vista del resultado (apunta a input o a storage).
+ * @return true si todas las etapas terminaron bien.
+ */
+bool transform_buffer(const std::string& input_file, ByteView input, const Config& config, ThreadPool* pool,
+                      FileStats& stats, FileData& storage, ByteView& result);
+
+/**
+ * Función worker para procesar un solo archivo.
+ * Llama a las funciones de compresión/encriptación en el orden correcto
+ * (o al pipeline por streaming / lectura de rango según config).
+ * @param input_file Ruta del archivo de entrada.
+ * @param output_file Ruta del archivo de salida.
+ * @param config Parámetros de la operación.
+ * @param pool Pool donde se reparten los bloques o los buffers grandes (nulo = en el hilo actual).
+ * @return true si la salida se escribió.
+ */
+bool process_file(const std::string& input_file, const std::string& output_file, const Config& config,
+                  ThreadPool* pool = nullptr);
+
+/**
+ * Procesa todos los archivos en un directorio usando hilos (Concurrencia).
+ * Con -r recorre también los subdirectorios y replica su estructura bajo -o;
+ * con --archive los empaqueta en un único archivo sólido.
+ * Los archivos se procesan como un grupo de trabajos de pool, que puede
+ * ser compartido (el de un lote): se esperan solo los de este directorio.
+ * @param config Parámetros de la operación (input_path es el directorio).
+ * @param pool Pool donde se procesan los archivos.
+ * @return true si todos los archivos se procesaron sin errores.
+ */
+bool process_directory(const Config& config, ThreadPool& pool);
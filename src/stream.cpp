@@ -0,0 +1,348 @@
+#include "stream.hpp"
+#include "block.hpp"
+#include "process.hpp"
+#include "fs_utils.hpp"
+#include "thread_pool.hpp"
+#include "bytes.hpp"
+#include <iostream>
+#include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Fragmento que recorre el pipeline
+struct Chunk {
+    FileData data;         // Datos leídos (crudos o almacenados en el contenedor)
+    uint32_t raw_size = 0; // Tamaño original (conocido al leer un contenedor)
+    bool stored = false;   // Se almacenó sin comprimir al codificarlo
+};
+
+// Acumula la decisión comprimir/almacenar de un fragmento codificado
+void count_chunk(const Chunk& chunk, const Config& config, StoreReport* report) {
+    if (report && config.compress) (chunk.stored ? report->stored : report->compressed)++;
+}
+
+/**
+ * Lector secuencial: entrega fragmentos crudos de tamaño fijo o, si la
+ * entrada es un contenedor por bloques, los bloques almacenados uno a uno.
+ */
+class StreamReader {
+public:
+    StreamReader(int fd, size_t chunk_size) : fd(fd), chunk_size(chunk_size) {}
+
+    /**
+     * Lee la cabecera de la entrada a restaurar. Si es un contenedor por
+     * bloques la valida; si no, es un archivo completo (LZ77, LZ77+HUF,
+     * Vigenère o ChaCha20) que no se puede restaurar por fragmentos, así que
+     * se lee entero en whole_input.
+     */
+    bool open_container(const Config& config) {
+        unsigned char header[BLOCK_CONTAINER_HEADER_SIZE];
+        long n = read_fully(fd, header, sizeof(header));
+        if (n < 0) {
+            error("Error de lectura.");
+            return false;
+        }
+        if (n != static_cast<long>(sizeof(header)) || !is_block_container(header, sizeof(header))) {
+            whole_input.assign(header, header + n);
+            return read_rest();
+        }
+        flags = header[5];
+        block_size = get_u32(header + 8);
+        // Ningún escritor usa bloques mayores que --block-size: un fragmento acota la memoria en vuelo
+        if (block_size == 0 || block_size > static_cast<uint32_t>(BLOCK_SIZE_MAX_MB) << 20) {
+            error("Tamaño de bloque del contenedor fuera de rango.");
+            return false;
+        }
+        container = true;
+        return check_block_flags(flags, config);
+    }
+
+    // Devuelve 1 si leyó un fragmento, 0 al final de la entrada y -1 en caso de error
+    int next(Chunk& chunk) {
+        if (!container) {
+            chunk.data.resize(chunk_size);
+            long n = read_fully(fd, chunk.data.data(), chunk_size);
+            if (n < 0) return error("Error de lectura.");
+            chunk.data.resize(n);
+            chunk.raw_size = static_cast<uint32_t>(n);
+            return n > 0 ? 1 : 0;
+        }
+
+        unsigned char header[BLOCK_HEADER_SIZE];
+        if (read_fully(fd, header, sizeof(header)) != static_cast<long>(sizeof(header))) {
+            return error("Cabecera de bloque incompleta.");
+        }
+        chunk.raw_size = get_u32(header);
+        uint32_t stored_size = get_u32(header + 4);
+        if (chunk.raw_size == 0 && stored_size == 0) return 0; // Marcador de fin
+        // Los tamaños vienen de la entrada: se validan antes de reservar el fragmento
+        if (chunk.raw_size > block_size || stored_size > max_encoded_size(block_size)) {
+            return error("Tamaño de bloque fuera de rango.");
+        }
+
+        chunk.data.resize(stored_size);
+        if (read_fully(fd, chunk.data.data(), stored_size) != static_cast<long>(stored_size)) {
+            return error("Bloque incompleto.");
+        }
+        return 1;
+    }
+
+    bool container = false;
+    unsigned char flags = 0;
+    uint32_t block_size = 0;
+    FileData whole_input; // Entrada completa cuando no es un contenedor por bloques
+
+private:
+    int error(const char* msg) {
+        cerr << "ERROR STREAM: " << msg << endl;
+        return -1;
+    }
+
+    // Agrega a whole_input el resto de la entrada
+    bool read_rest() {
+        while (true) {
+            size_t used = whole_input.size();
+            whole_input.resize(used + chunk_size);
+            long n = read_fully(fd, whole_input.data() + used, chunk_size);
+            if (n < 0) {
+                error("Error de lectura.");
+                return false;
+            }
+            whole_input.resize(used + n);
+            if (n == 0) return true;
+        }
+    }
+
+    int fd;
+    size_t chunk_size;
+};
+
+/**
+ * Escritor secuencial: escribe los datos crudos o, si se comprime/encripta,
+ * un contenedor por bloques con su tabla al final.
+ */
+class StreamWriter {
+public:
+    StreamWriter(int fd, bool container, unsigned char flags, uint32_t block_size)
+        : fd(fd), container(container), flags(flags), block_size(block_size) {}
+
+    bool begin() {
+        if (!container) return true;
+        FileData header;
+        write_container_header(header, flags, block_size);
+        return emit(header);
+    }
+
+    bool put(const FileData& data, uint32_t raw_size) {
+        if (!container) return emit(data);
+
+        FileData header;
+        write_block_header(header, raw_size, static_cast<uint32_t>(data.size()));
+        table.push_back({offset, raw_size, static_cast<uint32_t>(data.size())});
+        return emit(header) && emit(data);
+    }
+
+    bool finish() {
+        if (!container) return true;
+        FileData trailer;
+        write_container_trailer(trailer, table, offset);
+        return emit(trailer);
+    }
+
+private:
+    bool emit(const FileData& data) {
+        if (!write_fully(fd, data.data(), data.size())) {
+            cerr << "ERROR STREAM: Error de escritura." << endl;
+            return false;
+        }
+        offset += data.size();
+        return true;
+    }
+
+    int fd;
+    bool container;
+    unsigned char flags;
+    uint32_t block_size;
+    uint64_t offset = 0;
+    vector<BlockEntry> table;
+};
+
+/**
+ * Etapas de transformación de un fragmento: restaurar (si la entrada es
+ * un contenedor) y luego comprimir/encriptar (si se pidió).
+ */
+bool transform_chunk(Chunk& chunk, const StreamReader& reader, const Config& config, bool encoding) {
+    if (reader.container) {
+        FileData raw;
+        if (!decode_block(chunk.data.data(), chunk.data.size(), chunk.raw_size, reader.flags, config, raw)) {
+            cerr << "ERROR STREAM: Falló la restauración de un bloque." << endl;
+            return false;
+        }
+        chunk.data.swap(raw);
+    }
+    if (encoding) {
+        chunk.data = encode_block(chunk.data.data(), chunk.data.size(), config, &chunk.stored);
+    }
+    return true;
+}
+
+/**
+ * Pipeline paralelo: el hilo actual lee, el pool transforma y un hilo
+ * escritor emite los fragmentos en orden. Como máximo max_in_flight
+ * fragmentos existen a la vez.
+ */
+bool run_parallel_pipeline(StreamReader& reader, StreamWriter& writer, const Config& config,
+                           bool encoding, ThreadPool& pool, StoreReport* report) {
+    const size_t max_in_flight = 2 * static_cast<size_t>(pool.size());
+
+    mutex mtx;
+    condition_variable cv;
+    map<size_t, Chunk> done; // Fragmentos transformados pendientes de escribir
+    size_t in_flight = 0;
+    size_t total = 0;
+    bool reading = true;
+    bool failed = false;
+
+    thread writer_thread([&]() {
+        for (size_t next = 0;; ++next) {
+            Chunk chunk;
+            {
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [&]() { return failed || done.count(next) || (!reading && next == total); });
+                if (failed || (!reading && next == total && !done.count(next))) return;
+                chunk = move(done[next]);
+                done.erase(next);
+            }
+            bool ok = writer.put(chunk.data, chunk.raw_size);
+            if (encoding) count_chunk(chunk, config, report);
+            {
+                lock_guard<mutex> lock(mtx);
+                in_flight--;
+                if (!ok) failed = true;
+            }
+            cv.notify_all();
+            if (!ok) return;
+        }
+    });
+
+    {
+        TaskGroup group(pool);
+        while (true) {
+            {
+                unique_lock<mutex> lock(mtx);
+                // Un hilo del pool transforma él mismo los fragmentos pendientes mientras espera lugar
+                while (!failed && in_flight >= max_in_flight) {
+                    lock.unlock();
+                    bool ran = group.run_pending();
+                    lock.lock();
+                    if (!ran) cv.wait(lock, [&]() { return failed || in_flight < max_in_flight; });
+                }
+                if (failed) break;
+            }
+
+            Chunk chunk;
+            int status = reader.next(chunk);
+            if (status <= 0) {
+                if (status < 0) {
+                    lock_guard<mutex> lock(mtx);
+                    failed = true;
+                }
+                break;
+            }
+
+            size_t index;
+            {
+                lock_guard<mutex> lock(mtx);
+                index = total++;
+                in_flight++;
+            }
+            group.submit([&, index, chunk = move(chunk)]() mutable {
+                bool ok = transform_chunk(chunk, reader, config, encoding);
+                {
+                    lock_guard<mutex> lock(mtx);
+                    if (ok) done[index] = move(chunk);
+                    else failed = true;
+                }
+                cv.notify_all();
+            });
+        }
+        group.wait();
+    }
+
+    {
+        lock_guard<mutex> lock(mtx);
+        reading = false;
+    }
+    cv.notify_all();
+    writer_thread.join();
+    return !failed;
+}
+
+} // namespace
+
+bool process_stream(const string& input_path, const string& output_path, const Config& config, ThreadPool* pool,
+                    StoreReport* report) {
+    size_t chunk_size = config.block_size ? config.block_size : static_cast<size_t>(STREAM_CHUNK_MB) << 20;
+    bool decoding = config.decrypt || config.decompress;
+    bool encoding = config.compress || config.encrypt;
+
+    int in_fd = open_input_fd(input_path);
+    if (in_fd < 0) return false;
+
+    StreamReader reader(in_fd, chunk_size);
+    if (decoding && !reader.open_container(config)) {
+        close_fd(in_fd);
+        return false;
+    }
+
+    if (decoding && !reader.container) {
+        // Archivo completo: se restaura en memoria con las mismas etapas que sin --stream
+        close_fd(in_fd);
+        FileStats stats;
+        FileData storage;
+        ByteView result;
+        if (!transform_buffer(input_path, reader.whole_input, config, pool, stats, storage, result)) return false;
+        int out_fd = open_output_fd(output_path);
+        bool ok = out_fd >= 0 && write_fully(out_fd, result.data(), result.size());
+        if (out_fd >= 0) close_fd(out_fd);
+        return ok;
+    }
+
+    int out_fd = open_output_fd(output_path);
+    if (out_fd < 0) {
+        close_fd(in_fd);
+        return false;
+    }
+
+    // Al recomprimir un contenedor se conservan sus límites de bloque
+    uint32_t block_size = reader.container ? reader.block_size : static_cast<uint32_t>(chunk_size);
+    StreamWriter writer(out_fd, encoding, block_flags(config), block_size);
+
+    bool ok = writer.begin();
+    if (ok && pool && pool->size() > 1) {
+        ok = run_parallel_pipeline(reader, writer, config, encoding, *pool, report);
+    } else if (ok) {
+        Chunk chunk;
+        int status;
+        while ((status = reader.next(chunk)) > 0) {
+            if (!transform_chunk(chunk, reader, config, encoding) || !writer.put(chunk.data, chunk.raw_size)) {
+                status = -1;
+                break;
+            }
+            if (encoding) count_chunk(chunk, config, report);
+        }
+        ok = status == 0;
+    }
+    ok = ok && writer.finish();
+
+    close_fd(in_fd);
+    close_fd(out_fd);
+    return ok;
+}
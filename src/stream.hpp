@@ -0,0 +1,28 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "compress.hpp"
+#include "thread_pool.hpp"
+#include <string>
+
+/**
+ * Procesa un archivo como un pipeline por fragmentos con memoria acotada:
+ * leer -> desencriptar -> descomprimir -> comprimir -> encriptar -> escribir.
+ * La entrada se lee en fragmentos de tamaño fijo (config.block_size o
+ * STREAM_CHUNK_MB) y, como máximo, hay 2 fragmentos por hilo en vuelo, por lo
+ * que la memoria no depende del tamaño del archivo.
+ *
+ * Al comprimir/encriptar se escribe un contenedor por bloques (ver block.hpp).
+ * Al desencriptar/descomprimir, un contenedor por bloques se restaura por
+ * fragmentos; cualquier otra entrada (un .lz77 o un archivo encriptado
+ * completo) se lee entera y se restaura en memoria, ya que su formato no
+ * tiene límites de fragmento.
+ * @param input_path Ruta de entrada, o "-" para la entrada estándar.
+ * @param output_path Ruta de salida, o "-" para la salida estándar.
+ * @param config Parámetros de la operación.
+ * @param pool Pool donde se transforman los fragmentos (nulo = todo en el hilo actual).
+ * @param report Si no es nulo, acumula cuántos fragmentos se comprimieron o almacenaron.
+ * @return true si el flujo se procesó completo.
+ */
+bool process_stream(const std::string& input_path, const std::string& output_path,
+                    const Config& config, ThreadPool* pool, StoreReport* report = nullptr);
@@ -0,0 +1,259 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+// =================================================================
+// POOL DE HILOS CON ROBO DE TRABAJO
+// =================================================================
+
+unsigned ThreadPool::default_threads() {
+    return max(1u, thread::hardware_concurrency());
+}
+
+// Pool e índice del hilo actual, si es un hilo de algún pool
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local unsigned current_index = 0;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = default_threads();
+    for (unsigned i = 0; i < threads; ++i) {
+        queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    stopping = true;
+    for (auto& q : queues) {
+        // Con el lock tomado, un hilo que está por dormir ve stopping o recibe el aviso
+        lock_guard<mutex> lock(q->sleep_mtx);
+        q->wake_cv.notify_all();
+    }
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool ThreadPool::is_worker_thread() const {
+    return current_pool == this;
+}
+
+void ThreadPool::submit(function<void()> job) {
+    unfinished++;
+    if (current_pool == this) {
+        // Enviado por un trabajo de este pool: al deque de su hilo
+        WorkerQueue& q = *queues[current_index];
+        lock_guard<mutex> lock(q.mtx);
+        q.jobs.push_back(move(job));
+    } else {
+        lock_guard<mutex> lock(injector_mtx);
+        injector.push_back(move(job));
+    }
+    wake_one();
+}
+
+void ThreadPool::wait() {
+    unique_lock<mutex> lock(done_mtx);
+    done_cv.wait(lock, [this]() { return unfinished == 0; });
+}
+
+void ThreadPool::wake_one() {
+    // Sin hilos dormidos no hay nada que sincronizar (caso común con el pool ocupado)
+    if (idle_count == 0) return;
+    unsigned target;
+    {
+        lock_guard<mutex> lock(idle_mtx);
+        if (idle.empty()) return;
+        target = idle.back();
+        idle.pop_back();
+        idle_count--;
+    }
+    WorkerQueue& q = *queues[target];
+    {
+        lock_guard<mutex> lock(q.sleep_mtx);
+        q.woken = true;
+    }
+    q.wake_cv.notify_one();
+}
+
+void ThreadPool::leave_idle(unsigned self) {
+    // Si ya no está en la lista, un envío lo despertó (y dejó woken en true: a lo sumo una vuelta de más)
+    lock_guard<mutex> lock(idle_mtx);
+    auto it = find(idle.begin(), idle.end(), self);
+    if (it != idle.end()) {
+        idle.erase(it);
+        idle_count--;
+    }
+}
+
+bool ThreadPool::try_pop(unsigned self, function<void()>& job) {
+    // 1. El deque propio por el final
+    {
+        WorkerQueue& q = *queues[self];
+        lock_guard<mutex> lock(q.mtx);
+        if (!q.jobs.empty()) {
+            job = move(q.jobs.back());
+            q.jobs.pop_back();
+            return true;
+        }
+    }
+    // 2. La cola de entrada, en orden de envío
+    {
+        lock_guard<mutex> lock(injector_mtx);
+        if (!injector.empty()) {
+            job = move(injector.front());
+            injector.pop_front();
+            return true;
+        }
+    }
+    // 3. Robo: el trabajo más antiguo de otro hilo, empezando por el siguiente
+    size_t n = queues.size();
+    for (size_t k = 1; k < n; ++k) {
+        WorkerQueue& q = *queues[(self + k) % n];
+        lock_guard<mutex> lock(q.mtx);
+        if (!q.jobs.empty()) {
+            job = move(q.jobs.front());
+            q.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_job(function<void()>& job) {
+    job();
+    job = nullptr; // Libera lo capturado antes de avisar que terminó
+    if (--unfinished == 0) {
+        lock_guard<mutex> lock(done_mtx);
+        done_cv.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(unsigned self) {
+    current_pool = this;
+    current_index = self;
+    WorkerQueue& me = *queues[self];
+    function<void()> job;
+    while (true) {
+        if (try_pop(self, job)) {
+            run_job(job);
+            continue;
+        }
+
+        // Anotarse antes de la última mirada: un envío posterior a ella encuentra
+        // este hilo en idle y lo despierta, así ningún trabajo queda sin hilo
+        {
+            lock_guard<mutex> lock(idle_mtx);
+            idle.push_back(self);
+            idle_count++;
+        }
+        if (try_pop(self, job)) {
+            leave_idle(self);
+            run_job(job);
+            continue;
+        }
+        {
+            unique_lock<mutex> lock(me.sleep_mtx);
+            me.wake_cv.wait(lock, [&]() { return me.woken || stopping; });
+            me.woken = false;
+        }
+        if (stopping) return; // El destructor solo detiene el pool sin trabajos pendientes
+        leave_idle(self);
+    }
+}
+
+// =================================================================
+// GRUPOS DE TRABAJOS
+// =================================================================
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool), state(make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::submit(function<void()> job) {
+    {
+        lock_guard<mutex> lock(state->mtx);
+        state->jobs.push_back(move(job));
+        state->unfinished++;
+    }
+    // Quien espera puede tomarlo antes que el pool
+    state->cv.notify_all();
+    // El pool recibe un aviso: ejecuta el próximo trabajo del grupo, si todavía queda alguno
+    shared_ptr<State> shared = state;
+    pool.submit([shared]() { run_next(*shared); });
+}
+
+bool TaskGroup::run_next(State& state) {
+    function<void()> job;
+    {
+        lock_guard<mutex> lock(state.mtx);
+        if (state.jobs.empty()) return false;
+        job = move(state.jobs.front());
+        state.jobs.pop_front();
+    }
+    job();
+    job = nullptr;
+    {
+        lock_guard<mutex> lock(state.mtx);
+        state.unfinished--;
+    }
+    state.cv.notify_all();
+    return true;
+}
+
+bool TaskGroup::run_pending() {
+    return pool.is_worker_thread() && run_next(*state);
+}
+
+void TaskGroup::wait() {
+    // Un hilo ajeno al pool solo espera: ejecutar trabajos sumaría un hilo más que -j
+    bool helps = pool.is_worker_thread();
+    while (true) {
+        if (helps && run_next(*state)) continue;
+        unique_lock<mutex> lock(state->mtx);
+        if (state->unfinished == 0) return;
+        state->cv.wait(lock, [&]() { return state->unfinished == 0 || (helps && !state->jobs.empty()); });
+    }
+}
+
+void parallel_for(ThreadPool* pool, size_t count, const function<void(size_t)>& task) {
+    if (!pool || pool->size() <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+    TaskGroup group(*pool);
+    for (size_t i = 0; i < count; ++i) {
+        group.submit([&task, i]() { task(i); });
+    }
+    group.wait();
+}
+
+// =================================================================
+// PRESUPUESTO DE BYTES EN VUELO
+// =================================================================
+
+size_t ByteBudget::acquire(size_t bytes) {
+    if (limit == 0) return 0;
+    bytes = min(bytes, limit);
+    unique_lock<mutex> lock(mtx);
+    cv.wait(lock, [&]() { return in_use + bytes <= limit; });
+    in_use += bytes;
+    return bytes;
+}
+
+void ByteBudget::release(size_t bytes) {
+    if (limit == 0 || bytes == 0) return;
+    {
+        lock_guard<mutex> lock(mtx);
+        in_use -= bytes;
+    }
+    cv.notify_all();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+/**
+ * Pool de hilos de tamaño fijo con robo de trabajo. Cada hilo tiene su
+ * propio deque: los trabajos que envía un trabajo en curso (por ejemplo,
+ * el recorrido de un árbol de directorios) van al deque de ese hilo, que
+ * los toma por el final (LIFO, con sus datos aún en caché), mientras que
+ * los hilos sin trabajo roban por el frente (los más antiguos). Los
+ * trabajos enviados desde fuera del pool pasan por una cola de entrada
+ * FIFO, así que si se envían ordenados de mayor a menor costo, los más
+ * grandes se ejecutan primero. Un hilo sin trabajo duerme en su propia
+ * variable de condición y cada envío despierta a lo sumo a uno.
+ */
+class ThreadPool {
+public:
+    /**
+     * Crea el pool e inicia sus hilos.
+     * @param threads Número de hilos (0 usa default_threads()).
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /**
+     * Espera a que terminen los trabajos pendientes y detiene los hilos.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Encola un trabajo para su ejecución.
+     * @param job Función a ejecutar en alguno de los hilos del pool.
+     */
+    void submit(std::function<void()> job);
+
+    /**
+     * Bloquea hasta que todos los trabajos enviados hayan terminado.
+     */
+    void wait();
+
+    /**
+     * @return Número de hilos del pool.
+     */
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    /**
+     * @return Número de hilos por defecto (hardware_concurrency, mínimo 1).
+     */
+    static unsigned default_threads();
+
+    /**
+     * @return true si el hilo actual es uno de los hilos de este pool.
+     */
+    bool is_worker_thread() const;
+
+private:
+    struct WorkerQueue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> jobs; // El dueño toma del final; los demás roban del frente
+        std::mutex sleep_mtx;
+        std::condition_variable wake_cv;
+        bool woken = false;
+    };
+
+    void worker_loop(unsigned self);
+    bool try_pop(unsigned self, std::function<void()>& job);
+    void run_job(std::function<void()>& job);
+    void wake_one();
+    void leave_idle(unsigned self);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex injector_mtx;
+    std::deque<std::function<void()>> injector; // Trabajos enviados desde fuera del pool (FIFO)
+
+    std::mutex idle_mtx;
+    std::vector<unsigned> idle;        // Hilos anotados para dormir
+    std::atomic<size_t> idle_count{0}; // Tamaño de idle (sin lock en el envío)
+
+    std::atomic<size_t> unfinished{0}; // Trabajos encolados o en ejecución
+    std::atomic<bool> stopping{false};
+    std::mutex done_mtx;
+    std::condition_variable done_cv;
+};
+
+/**
+ * Grupo de trabajos sobre un pool compartido (por ejemplo, el de un lote).
+ * wait() espera solo los trabajos del grupo, no los de otros llamadores del
+ * pool. Si quien espera es un hilo del mismo pool, ejecuta él mismo los
+ * trabajos del grupo que aún no empezaron: un trabajo del pool puede lanzar
+ * un grupo y esperarlo aunque los demás hilos estén ocupados.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool);
+
+    /**
+     * Espera a que terminen los trabajos del grupo.
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * Encola un trabajo del grupo en el pool.
+     */
+    void submit(std::function<void()> job);
+
+    /**
+     * Bloquea hasta que todos los trabajos del grupo hayan terminado.
+     */
+    void wait();
+
+    /**
+     * Ejecuta en el hilo actual un trabajo del grupo que aún no empezó, si
+     * el hilo es del pool (para esperar otra condición sin retener un hilo).
+     * @return true si ejecutó un trabajo.
+     */
+    bool run_pending();
+
+    /**
+     * @return Número de hilos del pool.
+     */
+    unsigned size() const { return pool.size(); }
+
+private:
+    struct State {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> jobs; // Trabajos sin empezar
+        size_t unfinished = 0;                  // Trabajos sin empezar o en ejecución
+    };
+
+    static bool run_next(State& state);
+
+    ThreadPool& pool;
+    // Compartido con los avisos encolados en el pool, que pueden ejecutarse después del grupo
+    std::shared_ptr<State> state;
+};
+
+/**
+ * Ejecuta task(i) para i en [0, count) repartiendo los índices en el pool.
+ * @param pool Pool donde se reparten; nulo ejecuta todo en el hilo actual.
+ */
+void parallel_for(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task);
+
+/**
+ * Presupuesto de bytes en vuelo compartido entre hilos.
+ * acquire() bloquea hasta que haya espacio; una solicitud mayor que el
+ * límite se recorta al límite para que pueda ejecutarse sola.
+ */
+class ByteBudget {
+public:
+    /**
+     * @param limit Bytes máximos en vuelo (0 = sin límite).
+     */
+    explicit ByteBudget(size_t limit) : limit(limit) {}
+
+    /**
+     * Reserva bytes del presupuesto, esperando si es necesario.
+     * @param bytes Bytes solicitados.
+     * @return Bytes efectivamente reservados (a pasar a release()).
+     */
+    size_t acquire(size_t bytes);
+
+    /**
+     * Devuelve bytes reservados con acquire().
+     * @param bytes Valor devuelto por acquire().
+     */
+    void release(size_t bytes);
+
+private:
+    size_t limit;
+    size_t in_use = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+};
@@ -0,0 +1,513 @@
+#include "uring.hpp"
+#include "arena.hpp"
+#include "metrics.hpp"
+#include "process.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Tamaño máximo de una lectura/escritura (el kernel limita cada operación a ~2 GiB)
+const size_t MAX_IO_CHUNK = size_t(1) << 30;
+
+// =================================================================
+// ANILLO IO_URING
+// =================================================================
+
+/**
+ * Anillo io_uring mínimo sobre las llamadas al sistema. Lo usa un solo hilo.
+ */
+class IoRing {
+public:
+    IoRing() = default;
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+    ~IoRing();
+
+    bool init(unsigned entries);
+
+    /**
+     * @return Una SQE vacía para preparar, o nullptr si la cola está llena.
+     */
+    io_uring_sqe* get_sqe();
+
+    /**
+     * Envía las SQE preparadas y espera al menos wait_nr completados.
+     * @return false si io_uring_enter falló.
+     */
+    bool submit(unsigned wait_nr);
+
+    /**
+     * Consume todas las CQE disponibles.
+     */
+    template <typename Fn>
+    void for_each_cqe(Fn fn) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & *cq_mask];
+            // Se libera la entrada antes de procesarla: fn puede preparar nuevas SQE
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+            fn(cqe);
+            tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    int ring_fd() const { return fd; }
+
+private:
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    void* cq_ptr = MAP_FAILED;
+    void* sqe_ptr = MAP_FAILED;
+    size_t sq_size = 0, cq_size = 0, sqe_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_entries = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned local_tail = 0; // Cola local: se publica en submit()
+    unsigned to_submit = 0;
+
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+};
+
+IoRing::~IoRing() {
+    if (sqe_ptr != MAP_FAILED) munmap(sqe_ptr, sqe_size);
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+    if (sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_size);
+    if (fd >= 0) close(fd);
+}
+
+bool IoRing::init(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) return false;
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_size = cq_size = max(sq_size, cq_size);
+
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) return false;
+    cq_ptr = single_mmap ? sq_ptr
+                         : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ptr == MAP_FAILED) return false;
+    sqe_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqe_ptr = mmap(nullptr, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqe_ptr == MAP_FAILED) return false;
+
+    char* sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    sqes = static_cast<io_uring_sqe*>(sqe_ptr);
+    local_tail = *sq_tail;
+
+    char* cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+io_uring_sqe* IoRing::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (local_tail - head >= sq_entries) return nullptr;
+    unsigned index = local_tail & *sq_mask;
+    sq_array[index] = index;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    local_tail++;
+    to_submit++;
+    return sqe;
+}
+
+bool IoRing::submit(unsigned wait_nr) {
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0,
+                           nullptr, 0);
+        if (ret >= 0) {
+            to_submit -= static_cast<unsigned>(min<long>(ret, to_submit));
+            return true;
+        }
+        if (errno != EINTR) return false;
+    }
+}
+
+// =================================================================
+// PIPELINE DE ARCHIVOS
+// =================================================================
+
+// Operación de una CQE (4 bits bajos de user_data; el resto es el índice del archivo)
+enum OpKind : uint64_t {
+    OP_OPEN_IN, OP_STATX, OP_READ, OP_CLOSE_IN, OP_OPEN_OUT, OP_WRITE, OP_CLOSE_OUT, OP_WAKE
+};
+const unsigned OP_BITS = 4;
+
+// Estado de un archivo en vuelo
+struct FileState {
+    const FileJob* job = nullptr;
+    int in_fd = -1;
+    int out_fd = -1;
+    struct statx stx;
+    unsigned pending = 0;  // Operaciones de apertura en vuelo (openat + statx)
+    bool failed = false;
+    FileData input;
+    size_t done = 0;       // Bytes leídos o escritos de la etapa actual
+    FileData storage;      // Buffer de la última etapa de cómputo
+    ByteView output;       // Resultado (apunta a input o a storage)
+    bool ok = false;       // Resultado del cómputo
+    FileStats stats;
+    uint64_t stage_start = 0;
+    uint64_t queued_at = 0;
+};
+
+/**
+ * Hilo de E/S: admite archivos mientras haya lugar en la cola y en el
+ * presupuesto de bytes, y avanza cada uno según sus completados. Los
+ * hilos del pool avisan el fin del cómputo por un eventfd que el anillo
+ * mantiene en lectura, así una sola espera cubre E/S y cómputo.
+ */
+class UringPipeline {
+public:
+    UringPipeline(const vector<FileJob>& jobs, const Config& config, TaskGroup& group)
+        : jobs(jobs), config(config), group(group), files(jobs.size()) {
+        // Cada archivo tiene a lo sumo dos operaciones en vuelo; una entrada más para el eventfd
+        max_active = max<size_t>(1, (max<unsigned>(config.queue_depth, 3) - 1) / 2);
+    }
+
+    ~UringPipeline() {
+        if (wake_fd >= 0) close(wake_fd);
+    }
+
+    bool init() {
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+        return wake_fd >= 0 && ring.init(static_cast<unsigned>(2 * max_active + 2));
+    }
+
+    bool run() {
+        arm_wake();
+        while (completed < jobs.size()) {
+            while (next < jobs.size() && active < max_active &&
+                   (config.max_inflight == 0 || inflight_bytes < config.max_inflight)) {
+                start(next++);
+            }
+            // Si este hilo es del pool, adelanta un cómputo pendiente: su aviso por el eventfd
+            // completa la espera, así el pipeline avanza aunque los demás hilos estén ocupados
+            group.run_pending();
+            if (!ring.submit(1)) {
+                cerr << "ERROR: io_uring_enter falló: " << strerror(errno) << endl;
+                return false;
+            }
+            ring.for_each_cqe([this](const io_uring_cqe& cqe) { handle(cqe); });
+        }
+        return true;
+    }
+
+    /**
+     * @return Archivos completados con error.
+     */
+    size_t failed_files() const { return failed; }
+
+private:
+    io_uring_sqe* sqe(OpKind kind, size_t index) {
+        io_uring_sqe* entry = ring.get_sqe();
+        while (entry == nullptr) {
+            // No debería ocurrir (la cola se dimensiona para el máximo en vuelo)
+            ring.submit(0);
+            entry = ring.get_sqe();
+        }
+        entry->user_data = (static_cast<uint64_t>(index) << OP_BITS) | kind;
+        return entry;
+    }
+
+    void arm_wake() {
+        io_uring_sqe* entry = sqe(OP_WAKE, 0);
+        entry->opcode = IORING_OP_READ;
+        entry->fd = wake_fd;
+        entry->addr = reinterpret_cast<uint64_t>(&wake_value);
+        entry->len = sizeof(wake_value);
+    }
+
+    void start(size_t index) {
+        auto file = make_unique<FileState>();
+        file->job = &jobs[index];
+        file->stage_start = stats_enabled() ? monotonic_ns() : 0;
+        log_progress(config, "  [HILO] Procesando: ", file->job->input, " -> ", file->job->output);
+
+        // Apertura y tamaño en paralelo
+        io_uring_sqe* open_sqe = sqe(OP_OPEN_IN, index);
+        open_sqe->opcode = IORING_OP_OPENAT;
+        open_sqe->fd = AT_FDCWD;
+        open_sqe->addr = reinterpret_cast<uint64_t>(file->job->input.c_str());
+        open_sqe->open_flags = O_RDONLY | O_CLOEXEC;
+
+        io_uring_sqe* stat_sqe = sqe(OP_STATX, index);
+        stat_sqe->opcode = IORING_OP_STATX;
+        stat_sqe->fd = AT_FDCWD;
+        stat_sqe->addr = reinterpret_cast<uint64_t>(file->job->input.c_str());
+        stat_sqe->len = STATX_SIZE;
+        stat_sqe->off = reinterpret_cast<uint64_t>(&file->stx);
+
+        file->pending = 2;
+        files[index] = move(file);
+        active++;
+    }
+
+    void handle(const io_uring_cqe& cqe) {
+        OpKind kind = static_cast<OpKind>(cqe.user_data & ((1u << OP_BITS) - 1));
+        size_t index = static_cast<size_t>(cqe.user_data >> OP_BITS);
+        if (kind == OP_WAKE) {
+            drain_computed();
+            arm_wake();
+            return;
+        }
+        if (kind == OP_CLOSE_IN) return; // Cierre sin espera: el archivo ya siguió adelante
+
+        FileState& file = *files[index];
+        switch (kind) {
+        case OP_OPEN_IN:
+            if (cqe.res >= 0) file.in_fd = cqe.res;
+            else file.failed = true;
+            if (--file.pending == 0) opened(index);
+            break;
+        case OP_STATX:
+            if (cqe.res < 0) file.failed = true;
+            if (--file.pending == 0) opened(index);
+            break;
+        case OP_READ:
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                issue_read(index);
+            } else if (cqe.res <= 0) {
+                // Error o fin de archivo antes del tamaño informado (el archivo se acortó)
+                read_failed(index);
+            } else {
+                file.done += static_cast<size_t>(cqe.res);
+                if (file.done < file.input.size()) issue_read(index);
+                else read_complete(index);
+            }
+            break;
+        case OP_OPEN_OUT:
+            if (cqe.res < 0) {
+                cerr << "ERROR: No se pudo abrir/crear el archivo de salida: " << file.job->output << endl;
+                finish(index, false);
+            } else {
+                file.out_fd = cqe.res;
+                file.done = 0;
+                if (file.output.empty()) issue_close_out(index);
+                else issue_write(index);
+            }
+            break;
+        case OP_WRITE:
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                issue_write(index);
+            } else if (cqe.res <= 0) {
+                file.failed = true;
+                issue_close_out(index);
+            } else {
+                file.done += static_cast<size_t>(cqe.res);
+                if (file.done < file.output.size()) issue_write(index);
+                else issue_close_out(index);
+            }
+            break;
+        case OP_CLOSE_OUT:
+            if (stats_enabled()) file.stats.stage_ns[static_cast<size_t>(Stage::Write)] += monotonic_ns() - file.stage_start;
+            finish(index, !file.failed && cqe.res >= 0);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void opened(size_t index) {
+        FileState& file = *files[index];
+        if (file.failed || file.stx.stx_size == 0) {
+            read_failed(index);
+            return;
+        }
+        file.input.resize(file.stx.stx_size);
+        inflight_bytes += file.input.size();
+        issue_read(index);
+    }
+
+    void issue_read(size_t index) {
+        FileState& file = *files[index];
+        io_uring_sqe* entry = sqe(OP_READ, index);
+        entry->opcode = IORING_OP_READ;
+        entry->fd = file.in_fd;
+        entry->addr = reinterpret_cast<uint64_t>(file.input.data() + file.done);
+        entry->len = static_cast<uint32_t>(min(file.input.size() - file.done, MAX_IO_CHUNK));
+        entry->off = file.done;
+    }
+
+    void issue_close(OpKind kind, size_t index, int fd) {
+        io_uring_sqe* entry = sqe(kind, index);
+        entry->opcode = IORING_OP_CLOSE;
+        entry->fd = fd;
+    }
+
+    void read_failed(size_t index) {
+        FileState& file = *files[index];
+        cerr << "  [HILO] ERROR: Falló la lectura o el archivo está vacío: " << file.job->input << endl;
+        if (file.in_fd >= 0) issue_close(OP_CLOSE_IN, index, file.in_fd);
+        file.in_fd = -1;
+        finish(index, false);
+    }
+
+    void read_complete(size_t index) {
+        FileState& file = *files[index];
+        issue_close(OP_CLOSE_IN, index, file.in_fd);
+        file.in_fd = -1;
+        file.stats.bytes_in = file.input.size();
+        if (stats_enabled()) {
+            file.stats.stage_ns[static_cast<size_t>(Stage::Read)] += monotonic_ns() - file.stage_start;
+            file.queued_at = monotonic_ns();
+        }
+
+        // El buffer pasa al pool; el hilo de E/S no lo toca hasta que vuelva por el eventfd
+        FileState* state = &file;
+        group.submit([this, state, index]() {
+            if (state->queued_at) state->stats.queue_ns = monotonic_ns() - state->queued_at;
+            state->ok = transform_buffer(state->job->input, state->input, config, nullptr, state->stats,
+                                         state->storage, state->output);
+            state->stats.arena_bytes = worker_arena().finish_file();
+            {
+                lock_guard<mutex> lock(computed_mtx);
+                computed.push_back(index);
+            }
+            uint64_t one = 1;
+            ssize_t written = write(wake_fd, &one, sizeof(one));
+            (void)written;
+        });
+    }
+
+    void drain_computed() {
+        vector<size_t> ready;
+        {
+            lock_guard<mutex> lock(computed_mtx);
+            ready.swap(computed);
+        }
+        for (size_t index : ready) {
+            FileState& file = *files[index];
+            if (!file.ok) {
+                finish(index, false);
+                continue;
+            }
+            file.stage_start = stats_enabled() ? monotonic_ns() : 0;
+            io_uring_sqe* entry = sqe(OP_OPEN_OUT, index);
+            entry->opcode = IORING_OP_OPENAT;
+            entry->fd = AT_FDCWD;
+            entry->addr = reinterpret_cast<uint64_t>(file.job->output.c_str());
+            entry->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+            entry->len = S_IRUSR | S_IWUSR;
+        }
+    }
+
+    void issue_write(size_t index) {
+        FileState& file = *files[index];
+        io_uring_sqe* entry = sqe(OP_WRITE, index);
+        entry->opcode = IORING_OP_WRITE;
+        entry->fd = file.out_fd;
+        entry->addr = reinterpret_cast<uint64_t>(file.output.data() + file.done);
+        entry->len = static_cast<uint32_t>(min(file.output.size() - file.done, MAX_IO_CHUNK));
+        entry->off = file.done;
+    }
+
+    void issue_close_out(size_t index) {
+        FileState& file = *files[index];
+        issue_close(OP_CLOSE_OUT, index, file.out_fd);
+        file.out_fd = -1;
+    }
+
+    void finish(size_t index, bool ok) {
+        unique_ptr<FileState> file = move(files[index]);
+        if (ok) {
+            file->stats.bytes_out = file->output.size();
+            log_progress(config, "  [HILO] Éxito. Resultado guardado en: ", file->job->output);
+        } else if (file->ok) {
+            // El cómputo terminó bien: falló la escritura
+            cerr << "  [HILO] ERROR: Falló la escritura en el archivo de salida: " << file->job->output << endl;
+        }
+        if (stats_enabled()) {
+            file->stats.ok = ok;
+            file->stats.path = file->job->input;
+            record_file_stats(move(file->stats));
+        }
+        inflight_bytes -= file->input.size();
+        active--;
+        completed++;
+        if (!ok) failed++;
+    }
+
+    const vector<FileJob>& jobs;
+    const Config& config;
+    TaskGroup& group;
+    // files se declara antes que ring: al destruir, el anillo se cierra primero
+    // (cancelando lo que quede en vuelo) y después se liberan los buffers
+    vector<unique_ptr<FileState>> files;
+    IoRing ring;
+    size_t max_active = 1;
+    size_t next = 0;
+    size_t active = 0;
+    size_t completed = 0;
+    size_t failed = 0;
+    size_t inflight_bytes = 0;
+
+    int wake_fd = -1;
+    uint64_t wake_value = 0;
+    mutex computed_mtx;
+    vector<size_t> computed;
+};
+
+} // namespace
+
+bool uring_available() {
+    IoRing ring;
+    if (!ring.init(4)) return false;
+
+    // Verificar que el kernel soporte todas las operaciones usadas
+    const size_t ops = 256;
+    vector<unsigned char> buffer(sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, ring.ring_fd(), IORING_REGISTER_PROBE, probe, ops) < 0) return false;
+    for (unsigned op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+    }
+    return true;
+}
+
+bool process_files_uring(const vector<FileJob>& jobs, const Config& config, TaskGroup& group,
+                         size_t& failed) {
+    UringPipeline pipeline(jobs, config, group);
+    if (!pipeline.init()) return false;
+    bool ok = pipeline.run();
+    // Con un error del anillo puede quedar cómputo en curso que referencia el pipeline
+    group.wait();
+    failed = pipeline.failed_files();
+    return ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "constantes.hpp"
+#include "thread_pool.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * Backend de E/S asíncrona con io_uring (Linux) para el modo directorio
+ * (--io-uring). Un hilo de E/S mantiene hasta config.queue_depth
+ * operaciones en vuelo: abre y consulta el tamaño de varios archivos a la
+ * vez, los lee completos, entrega cada buffer al pool de cómputo y escribe
+ * los resultados a medida que los hilos los devuelven. Así la lectura y la
+ * escritura se superponen con la compresión/encriptación.
+ *
+ * Se usan las llamadas al sistema directamente (io_uring_setup/enter y los
+ * anillos mapeados), sin liburing. Si el kernel no ofrece io_uring el
+ * llamador vuelve a la E/S POSIX.
+ */
+
+// Archivo a procesar: entrada y salida completas
+struct FileJob {
+    std::string input;
+    std::string output;
+};
+
+/**
+ * Indica si el kernel permite crear un anillo io_uring con las operaciones
+ * que usa el backend (openat, statx, read, write, close).
+ */
+bool uring_available();
+
+/**
+ * Procesa los archivos con E/S io_uring y cómputo en el pool.
+ * Los directorios de salida deben existir.
+ * @param jobs Archivos a procesar (se abren en este orden).
+ * @param config Parámetros de la operación (queue_depth, max_inflight, ...).
+ * @param group Grupo del pool donde se ejecuta el cómputo.
+ * @param failed Recibe el número de archivos que no se pudieron procesar.
+ * @return false si no se pudo crear el anillo o falló io_uring_enter; el
+ *         llamador puede volver a procesar los archivos con E/S POSIX.
+ */
+bool process_files_uring(const std::vector<FileJob>& jobs, const Config& config, TaskGroup& group,
+                         size_t& failed);